@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include "Batch.h"
+
+namespace BabaSolver
+{
+	// How many levels are searched at the same time by default.
+	static constexpr unsigned int DEFAULT_CONCURRENT_LEVEL_COUNT = 2;
+
+	// Solves one level of a batch with its parallel portion on thread_pool.
+	static BatchResult SolveBatchLevel(const BatchLevel& level, std::size_t index, ThreadPool& thread_pool)
+	{
+		BatchResult result;
+		result.index = index;
+		result.name = level.name;
+		auto start_time = std::chrono::steady_clock::now();
+
+		Solver solver(level.initial_state, level.options);
+		solver.SetThreadPool(&thread_pool);
+		SolverCallbacks callbacks;
+		// Each iteration starts from the result of the last one, so the solution is the moves of
+		// all the iterations.
+		callbacks.on_iteration_finished = [&result](int, const std::shared_ptr<GameState>& state)
+			{
+				result.moves += FormatMoves(*state);
+			};
+		solver.SetCallbacks(callbacks);
+		solver.Start();
+		if (level.time_budget.count() > 0 && !solver.WaitFor(level.time_budget))
+		{
+			solver.Cancel();
+			result.timed_out = true;
+		}
+		result.end_state = solver.Wait();
+		result.won = result.end_state && result.end_state->HaveWon();
+		result.stats = solver.Stats();
+		result.duration = std::chrono::steady_clock::now() - start_time;
+		return result;
+	}
+
+	std::vector<BatchResult> SolveBatch(const std::vector<BatchLevel>& levels, const BatchOptions& options,
+		const std::function<void(const BatchResult& result)>& on_result)
+	{
+		ThreadPool thread_pool(options.thread_count);
+		std::vector<BatchResult> results(levels.size());
+		std::atomic<std::size_t> next_level_index = 0;
+		std::mutex result_mutex;
+
+		// Each driver thread runs the sequential portions of one level at a time.
+		unsigned int driver_count = options.concurrent_level_count != 0 ? options.concurrent_level_count : DEFAULT_CONCURRENT_LEVEL_COUNT;
+		driver_count = std::max(1u, std::min<unsigned int>(driver_count, static_cast<unsigned int>(levels.size())));
+		std::vector<std::thread> drivers;
+		for (unsigned int i = 0; i < driver_count; ++i)
+		{
+			drivers.emplace_back([&levels, &results, &next_level_index, &result_mutex, &thread_pool, &on_result]()
+				{
+					while (true)
+					{
+						std::size_t index = next_level_index++;
+						if (index >= levels.size())
+							break;
+						BatchResult result = SolveBatchLevel(levels[index], index, thread_pool);
+						std::lock_guard<std::mutex> lock(result_mutex);
+						results[index] = result;
+						if (on_result)
+							on_result(results[index]);
+					}
+				});
+		}
+		for (std::thread& driver : drivers)
+		{
+			driver.join();
+		}
+		return results;
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,67 @@
+// Code for solving many levels in one process.
+//
+// The levels are solved a few at a time. Each level's sequential portion runs on its own thread,
+// and the parallel portions of all the levels share one ThreadPool, so the threads that a level no
+// longer needs (e.g. because it was won early) go to the other levels' searches. Each level can
+// have its own time budget, after which its search is cancelled.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+
+namespace BabaSolver
+{
+	// One level to solve in a batch.
+	struct BatchLevel
+	{
+		// The name of the level in the results (e.g. its file name).
+		std::string name;
+		std::shared_ptr<GameState> initial_state;
+		SolverOptions options;
+		// How long the level's search may take before it's cancelled. 0 means no limit.
+		std::chrono::nanoseconds time_budget{};
+	};
+
+	// The result of one level of a batch.
+	struct BatchResult
+	{
+		// The index of the level in the batch.
+		std::size_t index = 0;
+		std::string name;
+		// The winning game state, or the best leaf game state of the last iteration.
+		std::shared_ptr<GameState> end_state;
+		bool won = false;
+		// True if the search was cancelled because it went over its time budget.
+		bool timed_out = false;
+		// The moves of all iterations (see FormatMoves()). The moves of end_state only cover the
+		// last iteration.
+		std::string moves;
+		SolverStats stats;
+		std::chrono::nanoseconds duration{};
+	};
+
+	// Options for SolveBatch().
+	struct BatchOptions
+	{
+		// How many threads the shared pool has. 0 means one thread per hardware thread.
+		unsigned int thread_count = 0;
+		// How many levels are searched at the same time. Searching a few levels at once keeps the
+		// pool busy while the levels are in their sequential portions. 0 means 2.
+		unsigned int concurrent_level_count = 0;
+	};
+
+	// Solves the levels and returns their results in the same order as levels. on_result (if not
+	// empty) is called with each result as soon as its level is finished, from the batch's
+	// threads, but never concurrently.
+	std::vector<BatchResult> SolveBatch(const std::vector<BatchLevel>& levels, const BatchOptions& options,
+		const std::function<void(const BatchResult& result)>& on_result = nullptr);
+
+}  // namespace BabaSolver
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "GameState.h"
+
+#include "Bidirectional.h"
+
+namespace BabaSolver
+{
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	namespace
+	{
+		// What the two searches know about a game state.
+		struct Visit
+		{
+			// The number of moves from the initial game state, or -1 if the forward search hasn't
+			// reached the game state.
+			int forward_depth = -1;
+			// The game state that the forward search reached this one from, and the move.
+			std::shared_ptr<GameState> forward_parent;
+			Direction forward_move = Direction::NO_DIRECTION;
+			// The number of moves to a goal game state, or -1 if the backward search hasn't reached
+			// the game state.
+			int backward_depth = -1;
+			// The game state that the move leads to, one move closer to the goal.
+			std::shared_ptr<GameState> backward_child;
+			Direction backward_move = Direction::NO_DIRECTION;
+		};
+
+		// The table shared by the two searches. The move history of every game state in it is
+		// reset, so that GameStateHash and GameStateEqual only look at the positions of the game
+		// objects.
+		using VisitMap = std::unordered_map<std::shared_ptr<GameState>, Visit, GameStateHash, GameStateEqual>;
+
+		// The game state where the searches met with the fewest moves so far.
+		struct Meeting
+		{
+			std::shared_ptr<GameState> state;
+			int moves = std::numeric_limits<int>::max();
+
+			void Update(const std::shared_ptr<GameState>& visited_state, const Visit& visit)
+			{
+				if (visit.forward_depth == -1 || visit.backward_depth == -1 || visit.forward_depth + visit.backward_depth >= moves)
+					return;
+				state = visited_state;
+				moves = visit.forward_depth + visit.backward_depth;
+			}
+		};
+
+		// Returns the moves from the initial game state through meeting to a goal game state.
+		std::vector<Direction> PathThrough(const VisitMap& visits, const std::shared_ptr<GameState>& meeting)
+		{
+			std::vector<Direction> path;
+			for (const Visit* visit = &visits.at(meeting); visit->forward_depth > 0; visit = &visits.at(visit->forward_parent))
+				path.push_back(visit->forward_move);
+			std::reverse(path.begin(), path.end());
+			for (const Visit* visit = &visits.at(meeting); visit->backward_depth > 0; visit = &visits.at(visit->backward_child))
+				path.push_back(visit->backward_move);
+			return path;
+		}
+	}  // namespace
+
+	BidirectionalResult SearchBidirectional(const std::shared_ptr<GameState>& initial_state,
+		const std::vector<std::shared_ptr<GameState>>& goal_states, const BidirectionalOptions& options)
+	{
+		auto start_time = std::chrono::steady_clock::now();
+		BidirectionalResult result;
+		BidirectionalStats& stats = result.stats;
+		VisitMap visits;
+		Meeting meeting;
+
+		std::shared_ptr<GameState> start = std::make_shared<GameState>(*initial_state);
+		start->ResetContext();
+		visits[start].forward_depth = 0;
+		std::vector<std::shared_ptr<GameState>> forward_frontier = { start };
+		std::vector<std::shared_ptr<GameState>> backward_frontier;
+		for (const std::shared_ptr<GameState>& goal_state : goal_states)
+		{
+			std::shared_ptr<GameState> goal = std::make_shared<GameState>(*goal_state);
+			goal->ResetContext();
+			auto [it, inserted] = visits.try_emplace(goal);
+			if (it->second.backward_depth != -1)
+				continue;
+			it->second.backward_depth = 0;
+			backward_frontier.push_back(it->first);
+			meeting.Update(it->first, it->second);
+		}
+
+		// Expand one whole layer at a time, so that the first layer in which the searches meet has
+		// the shortest solution.
+		while (!meeting.state && !forward_frontier.empty() && !backward_frontier.empty()
+			&& stats.forward_depth + stats.backward_depth < options.max_moves)
+		{
+			if (options.max_states != 0 && visits.size() >= options.max_states)
+			{
+				stats.reached_state_limit = true;
+				break;
+			}
+			std::vector<std::shared_ptr<GameState>> next_frontier;
+			if (forward_frontier.size() <= backward_frontier.size())
+			{
+				for (const std::shared_ptr<GameState>& state : forward_frontier)
+				{
+					// The game is over once it's won.
+					if (state->HaveWon())
+						continue;
+					for (Direction direction : ALL_DIRECTIONS)
+					{
+						std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+						new_state->ResetContext();
+						if (new_state->CheckWhyImpossibleToWin() != LossReason::NONE)
+							continue;
+						auto [it, inserted] = visits.try_emplace(new_state);
+						Visit& visit = it->second;
+						if (visit.forward_depth != -1)
+							continue;
+						visit.forward_depth = stats.forward_depth + 1;
+						visit.forward_parent = state;
+						visit.forward_move = direction;
+						++stats.forward_states;
+						meeting.Update(it->first, visit);
+						next_frontier.push_back(it->first);
+					}
+				}
+				forward_frontier = std::move(next_frontier);
+				++stats.forward_depth;
+			}
+			else
+			{
+				for (const std::shared_ptr<GameState>& state : backward_frontier)
+				{
+					for (Direction direction : ALL_DIRECTIONS)
+					{
+						for (std::shared_ptr<GameState>& previous_state : state->UndoMove(direction))
+						{
+							if (previous_state->CheckWhyImpossibleToWin() != LossReason::NONE)
+								continue;
+							auto [it, inserted] = visits.try_emplace(std::move(previous_state));
+							Visit& visit = it->second;
+							if (visit.backward_depth != -1)
+								continue;
+							visit.backward_depth = stats.backward_depth + 1;
+							visit.backward_child = state;
+							visit.backward_move = direction;
+							++stats.backward_states;
+							meeting.Update(it->first, visit);
+							next_frontier.push_back(it->first);
+						}
+					}
+				}
+				backward_frontier = std::move(next_frontier);
+				++stats.backward_depth;
+			}
+		}
+
+		if (meeting.state)
+		{
+			result.found = true;
+			result.moves = PathThrough(visits, meeting.state);
+		}
+		stats.duration = std::chrono::steady_clock::now() - start_time;
+		return result;
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,67 @@
+// Code for searching from both ends: forward from the initial game state and backward from the
+// goal game states.
+//
+// The forward search's move tree grows at a rate of 4^n, so the end of a long solution is out of
+// its reach. When the goal is a well defined game state (e.g. the positions of the game objects
+// just before the key is pushed onto the door), SearchBidirectional() also searches backward from
+// it with GameState::UndoMove(), where the Babas pull the objects that they pushed. Both searches
+// are breadth first and record the game states they reach in one shared table, and a solution is
+// found when a game state is reached from both ends. Each search then only goes about half as
+// deep, which is far fewer game states than one search of the whole depth.
+//
+// The goal game states must have the exact positions of every game object, so the backward search
+// works best for a level's end phase, where the positions are known.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// Options for SearchBidirectional().
+	struct BidirectionalOptions
+	{
+		// The max number of moves of a solution (the forward and backward depths combined).
+		int max_moves = 30;
+		// The max number of game states in the shared table, or 0 for no limit. Each game state is
+		// kept until the search is over, so this bounds the memory used.
+		uint64_t max_states = 2'000'000;
+	};
+
+	// Statistics for a SearchBidirectional() call.
+	struct BidirectionalStats
+	{
+		// How many game states each search reached.
+		uint64_t forward_states = 0;
+		uint64_t backward_states = 0;
+		// How deep each search went.
+		int forward_depth = 0;
+		int backward_depth = 0;
+		// True if the search stopped because the table reached BidirectionalOptions::max_states.
+		bool reached_state_limit = false;
+		std::chrono::nanoseconds duration{};
+	};
+
+	// The result of SearchBidirectional().
+	struct BidirectionalResult
+	{
+		// True if one of the goal game states was reached.
+		bool found = false;
+		// The shortest moves from the initial game state to a goal game state, if found.
+		std::vector<Direction> moves;
+		BidirectionalStats stats;
+	};
+
+	// Searches for the shortest moves from initial_state to the positions of any of goal_states (see
+	// above), expanding whichever of the two searches has the smaller frontier. Both searches skip
+	// the game states from which the level can't be won, and the forward search doesn't continue
+	// after a win. moves may be longer than MAX_TURN_COUNT.
+	BidirectionalResult SearchBidirectional(const std::shared_ptr<GameState>& initial_state,
+		const std::vector<std::shared_ptr<GameState>>& goal_states, const BidirectionalOptions& options);
+
+}  // namespace BabaSolver
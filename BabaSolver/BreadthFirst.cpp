@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "GameState.h"
+
+#include "BreadthFirst.h"
+
+namespace BabaSolver
+{
+	BreadthFirstTree::BreadthFirstTree(std::shared_ptr<GameState> root)
+		: _nodes({ Node{ std::move(root), 0, Direction::NO_DIRECTION, 0 } })
+	{
+	}
+
+	void BreadthFirstTree::Add(std::shared_ptr<GameState> state, std::size_t parent, Direction move)
+	{
+		_nodes.push_back(Node{ std::move(state), parent, move, _nodes[parent].depth + 1 });
+	}
+
+	BreadthFirstTree::Node BreadthFirstTree::At(std::size_t index) const
+	{
+		return _nodes[index];
+	}
+
+	std::size_t BreadthFirstTree::Size() const
+	{
+		return _nodes.size();
+	}
+
+	std::vector<Direction> BreadthFirstTree::PathTo(std::size_t index) const
+	{
+		std::vector<Direction> path;
+		while (_nodes[index].parent != index)
+		{
+			path.push_back(_nodes[index].move);
+			index = _nodes[index].parent;
+		}
+		std::reverse(path.begin(), path.end());
+		return path;
+	}
+
+}  // namespace BabaSolver
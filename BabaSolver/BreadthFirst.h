@@ -0,0 +1,51 @@
+// The bookkeeping of the breadth-first searches of the planner and of the solution shortener.
+//
+// Both searches visit game states in the order they were reached and need the moves to some of
+// them afterwards, so each game state is stored with the index of the one it was reached from.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// The game states reached by a breadth-first search, in the order they were reached.
+	class BreadthFirstTree
+	{
+	public:
+		// A game state of the tree, and how it was reached.
+		struct Node
+		{
+			std::shared_ptr<GameState> state;
+			// The index of the node this one was reached from, or the node's own index for the
+			// root.
+			std::size_t parent;
+			Direction move;
+			int depth;
+		};
+
+		// Starts a tree at root (index 0).
+		explicit BreadthFirstTree(std::shared_ptr<GameState> root);
+
+		// Adds state, reached by applying move to the game state of the node at parent.
+		void Add(std::shared_ptr<GameState> state, std::size_t parent, Direction move);
+
+		// Returns the node at index. It's a copy, since Add() may reallocate the nodes while the
+		// caller expands it.
+		Node At(std::size_t index) const;
+
+		// Returns the number of nodes, including the root.
+		std::size_t Size() const;
+
+		// Returns the moves from the root to the node at index.
+		std::vector<Direction> PathTo(std::size_t index) const;
+
+	private:
+		std::vector<Node> _nodes;
+	};
+
+}  // namespace BabaSolver
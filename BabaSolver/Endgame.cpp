@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+#include "GameState.h"
+
+#include "Endgame.h"
+
+namespace BabaSolver
+{
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	static constexpr uint16_t KEY_BITMASK = 1 << static_cast<uint16_t>(GameObject::KEY);
+	static constexpr uint16_t IMMOVABLE_BITMASK = 1 << static_cast<uint16_t>(GameObject::IMMOVABLE);
+	static constexpr int DOOR_CELL = DOOR_I * GRID_WIDTH + DOOR_J;
+
+	namespace
+	{
+		// A move from one (Baba, key) position of a table to another.
+		struct Edge
+		{
+			uint32_t from;
+			uint32_t to;
+			Direction direction;
+		};
+
+		// Returns the index of a position in a table.
+		uint32_t PositionIndex(int baba_cell, int key_cell)
+		{
+			return static_cast<uint32_t>(baba_cell * GRID_CELL_COUNT + key_cell);
+		}
+
+		// Returns the offset of the next cell in direction.
+		int CellDelta(Direction direction)
+		{
+			switch (direction)
+			{
+			case Direction::UP:
+				return -GRID_WIDTH;
+			case Direction::RIGHT:
+				return 1;
+			case Direction::DOWN:
+				return GRID_WIDTH;
+			case Direction::LEFT:
+				return -1;
+			default:
+				return 0;
+			}
+		}
+	}  // namespace
+
+	std::size_t EndgameTablebase::ArrangementHash::operator()(const Arrangement& arrangement) const
+	{
+		return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(arrangement.data()),
+			arrangement.size() * sizeof(uint16_t)));
+	}
+
+	EndgameTablebase::EndgameTablebase(std::size_t max_tables) : _max_tables(max_tables), _mutex(), _tables(), _full(max_tables == 0) {}
+
+	std::optional<std::vector<Direction>> EndgameTablebase::FindWin(const GameState& state)
+	{
+		if (!state.BabasOnSameSpace())
+			return std::nullopt;
+		if (state.HaveWon())
+			return std::vector<Direction>();
+
+		Arrangement arrangement;
+		int key_cell = -1;
+		for (int cell = 0; cell < GRID_CELL_COUNT; ++cell)
+		{
+			uint16_t objects = state._grid[cell / GRID_WIDTH][cell % GRID_WIDTH];
+			if ((objects & KEY_BITMASK) != 0)
+				key_cell = cell;
+			arrangement[cell] = objects & ~KEY_BITMASK;
+		}
+
+		Entry* entry = FindOrAddEntry(arrangement);
+		if (entry == nullptr)
+			return std::nullopt;
+		const Table* table = entry->table.load(std::memory_order_acquire);
+		if (table == nullptr)
+		{
+			if (entry->claimed.exchange(true, std::memory_order_relaxed))
+				return std::nullopt;
+			entry->owned_table = ComputeTable(arrangement);
+			table = entry->owned_table.get();
+			entry->table.store(table, std::memory_order_release);
+		}
+
+		uint32_t index = PositionIndex(state._baba1.i * GRID_WIDTH + state._baba1.j, key_cell);
+		if (table->moves_to_win[index] == UNREACHABLE)
+			return std::nullopt;
+		std::vector<Direction> moves;
+		while (table->moves_to_win[index] != 0)
+		{
+			moves.push_back(table->best_move[index]);
+			index = table->next_index[index];
+		}
+		return moves;
+	}
+
+	std::size_t EndgameTablebase::TableCount() const
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		return _tables.size();
+	}
+
+	EndgameTablebase::Entry* EndgameTablebase::FindOrAddEntry(const Arrangement& arrangement)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(_mutex);
+			auto it = _tables.find(arrangement);
+			if (it != _tables.end())
+				return it->second.get();
+		}
+		if (_full.load(std::memory_order_relaxed))
+			return nullptr;
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		auto it = _tables.find(arrangement);
+		if (it != _tables.end())
+			return it->second.get();
+		if (_tables.size() >= _max_tables)
+			return nullptr;
+		Entry* entry = _tables.emplace(arrangement, std::make_unique<Entry>()).first->second.get();
+		if (_tables.size() >= _max_tables)
+			_full.store(true, std::memory_order_relaxed);
+		return entry;
+	}
+
+	std::unique_ptr<const EndgameTablebase::Table> EndgameTablebase::ComputeTable(const Arrangement& arrangement)
+	{
+		constexpr std::size_t POSITION_COUNT = static_cast<std::size_t>(GRID_CELL_COUNT) * GRID_CELL_COUNT;
+		std::unique_ptr<Table> table = std::make_unique<Table>();
+		table->moves_to_win.assign(POSITION_COUNT, UNREACHABLE);
+		table->best_move.assign(POSITION_COUNT, Direction::NO_DIRECTION);
+		table->next_index.assign(POSITION_COUNT, 0);
+
+		// Apply every move to every position with the game engine, and keep the moves that only
+		// move the Babas and the key.
+		std::vector<Edge> edges;
+		std::deque<uint32_t> queue;
+		uint16_t grid[GRID_HEIGHT][GRID_WIDTH];
+		for (int baba_cell = 0; baba_cell < GRID_CELL_COUNT; ++baba_cell)
+		{
+			if ((arrangement[baba_cell] & IMMOVABLE_BITMASK) != 0 || baba_cell == DOOR_CELL)
+				continue;
+			// The positions where the key is on the door have won.
+			uint32_t won_index = PositionIndex(baba_cell, DOOR_CELL);
+			table->moves_to_win[won_index] = 0;
+			queue.push_back(won_index);
+
+			Coordinate baba = { static_cast<int8_t>(baba_cell / GRID_WIDTH), static_cast<int8_t>(baba_cell % GRID_WIDTH) };
+			for (int key_cell = 0; key_cell < GRID_CELL_COUNT; ++key_cell)
+			{
+				if ((arrangement[key_cell] & IMMOVABLE_BITMASK) != 0 || key_cell == baba_cell || key_cell == DOOR_CELL)
+					continue;
+				std::copy(arrangement.begin(), arrangement.end(), &grid[0][0]);
+				grid[key_cell / GRID_WIDTH][key_cell % GRID_WIDTH] |= KEY_BITMASK;
+				GameState position(grid, baba, baba);
+				for (Direction direction : ALL_DIRECTIONS)
+				{
+					std::shared_ptr<GameState> next_position = position.ApplyMove(direction);
+					// The key either stayed or was pushed one cell.
+					int next_key_cell = (next_position->_grid[key_cell / GRID_WIDTH][key_cell % GRID_WIDTH] & KEY_BITMASK) != 0
+						? key_cell : key_cell + CellDelta(direction);
+					bool arrangement_changed = false;
+					for (int cell = 0; cell < GRID_CELL_COUNT && !arrangement_changed; ++cell)
+					{
+						uint16_t objects = next_position->_grid[cell / GRID_WIDTH][cell % GRID_WIDTH];
+						arrangement_changed = (objects & ~KEY_BITMASK) != arrangement[cell] || ((objects & KEY_BITMASK) != 0) != (cell == next_key_cell);
+					}
+					if (arrangement_changed)
+						continue;
+					int next_baba_cell = next_position->_baba1.i * GRID_WIDTH + next_position->_baba1.j;
+					uint32_t from = PositionIndex(baba_cell, key_cell);
+					uint32_t to = PositionIndex(next_baba_cell, next_key_cell);
+					if (from != to)
+						edges.push_back(Edge{ from, to, direction });
+				}
+			}
+		}
+
+		// Retrograde analysis: search backward from the won positions, so the first time a
+		// position is reached is with its fewest moves to the win.
+		std::sort(edges.begin(), edges.end(), [](const Edge& lhs, const Edge& rhs) { return lhs.to < rhs.to; });
+		while (!queue.empty())
+		{
+			uint32_t index = queue.front();
+			queue.pop_front();
+			if (table->moves_to_win[index] + 1 >= UNREACHABLE)
+				continue;
+			auto edge = std::lower_bound(edges.begin(), edges.end(), index, [](const Edge& lhs, uint32_t to) { return lhs.to < to; });
+			for (; edge != edges.end() && edge->to == index; ++edge)
+			{
+				if (table->moves_to_win[edge->from] != UNREACHABLE)
+					continue;
+				table->moves_to_win[edge->from] = table->moves_to_win[index] + 1;
+				table->best_move[edge->from] = edge->direction;
+				table->next_index[edge->from] = index;
+				queue.push_back(edge->from);
+			}
+		}
+		return table;
+	}
+
+}  // namespace BabaSolver
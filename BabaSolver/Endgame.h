@@ -0,0 +1,101 @@
+// Code for solving the end phase of a level with a tablebase instead of a search.
+//
+// Once both Babas are on the same space (the third milestone of CalculateScore()), they move as
+// one and can no longer die, and what's left is pushing the key onto the door. If the other game
+// objects stay where they are, the only things that change are the positions of the Babas and the
+// key: at most 324 * 324 game states. EndgameTablebase computes the moves-to-win of all of them at
+// once by retrograde analysis: it applies every move to every (Baba, key) position with the game
+// engine, then searches backward from the positions where the key is on the door. A search that
+// reaches the endgame then looks up the moves to the win instead of searching them move by move.
+//
+// A table is only valid for one arrangement of the other game objects, so one is computed the
+// first time the search reaches the endgame with each arrangement. The moves that push another
+// game object (e.g. a text block) change the arrangement, so the tables leave them out: a position
+// that can only win by pushing another game object has no entry, and the search goes on as usual.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// Moves-to-win tables for the endgame, computed on demand (see above). Thread-safe: lookups of
+	// computed tables only share a read lock, and a table is computed outside the lock by the
+	// first thread that needs it.
+	class EndgameTablebase
+	{
+	public:
+		// At most max_tables tables are computed. Each one takes about 600 KB and a few hundred
+		// milliseconds.
+		explicit EndgameTablebase(std::size_t max_tables);
+		EndgameTablebase(const EndgameTablebase&) = delete;
+		EndgameTablebase& operator=(const EndgameTablebase&) = delete;
+
+		// Returns the fewest moves that push the key onto the door from state without moving any
+		// other game object (none if state has already won). Returns std::nullopt if the Babas
+		// aren't on the same space, if there are no such moves, or if state's arrangement has no
+		// table yet and either max_tables tables were already started or another thread is
+		// computing it (the caller then searches on instead of waiting).
+		std::optional<std::vector<Direction>> FindWin(const GameState& state);
+
+		// Returns how many tables have been computed or started.
+		std::size_t TableCount() const;
+
+	private:
+		// The grid without the key, which identifies a table.
+		using Arrangement = std::array<uint16_t, GRID_CELL_COUNT>;
+
+		struct ArrangementHash
+		{
+			std::size_t operator()(const Arrangement& arrangement) const;
+		};
+
+		// The table of one arrangement, indexed by Baba cell * GRID_CELL_COUNT + key cell.
+		struct Table
+		{
+			// The number of moves to the win, or UNREACHABLE.
+			std::vector<uint8_t> moves_to_win;
+			// The first move of the fewest moves to the win, and the index that it leads to.
+			std::vector<Direction> best_move;
+			std::vector<uint32_t> next_index;
+		};
+
+		// The table of one arrangement, once it's computed.
+		struct Entry
+		{
+			// Set by the thread that computes the table.
+			std::atomic<bool> claimed = false;
+			// Published once computed. Tables are never removed, so the pointer stays valid.
+			std::atomic<const Table*> table = nullptr;
+			std::unique_ptr<const Table> owned_table;
+		};
+
+		static constexpr uint8_t UNREACHABLE = 255;
+
+		// Computes the table of an arrangement by retrograde analysis.
+		static std::unique_ptr<const Table> ComputeTable(const Arrangement& arrangement);
+
+		// Returns the entry of arrangement, adding it if there are fewer than _max_tables. Returns
+		// null if there's no entry and no room for one.
+		Entry* FindOrAddEntry(const Arrangement& arrangement);
+
+		std::size_t _max_tables;
+		// Guards _tables, but not the entries themselves, which are never removed.
+		mutable std::shared_mutex _mutex;
+		std::unordered_map<Arrangement, std::unique_ptr<Entry>, ArrangementHash> _tables;
+		// Set once _tables has _max_tables entries, so that lookups of other arrangements can
+		// return without taking the lock.
+		std::atomic<bool> _full;
+	};
+
+}  // namespace BabaSolver
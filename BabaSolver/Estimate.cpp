@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+
+#include "Estimate.h"
+
+namespace BabaSolver
+{
+	namespace
+	{
+		using GameStateSet = std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual>;
+
+		// One part of the move tree that the solver searches with one cache: the whole tree above
+		// the parallelism depth, or the subtree of one parallelism root.
+		struct Subtree
+		{
+			// The game states at the current depth that will be expanded.
+			std::vector<std::shared_ptr<GameState>> frontier;
+			GameStateSet cache;
+		};
+	}  // namespace
+
+	// The seed of the random probes. A fixed seed makes the estimate deterministic.
+	static constexpr uint64_t PROBE_SEED = 0xbaba;
+
+	// SuggestDepths() picks a parallelism depth with at least this many parallelism roots per
+	// worker thread, since subtrees vary a lot in size.
+	static constexpr double ROOTS_PER_WORKER = 8.0;
+
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	double TreeSizeEstimate::TotalNodes(int max_turn_depth) const
+	{
+		double total = 0.0;
+		for (int depth = 1; depth <= std::min(max_turn_depth, max_depth); ++depth)
+		{
+			total += nodes_generated[depth];
+		}
+		return total;
+	}
+
+	std::chrono::nanoseconds TreeSizeEstimate::EstimatedDuration(int max_turn_depth, unsigned int worker_count) const
+	{
+		double nanoseconds = TotalNodes(max_turn_depth) * nanoseconds_per_node / std::max(1u, worker_count);
+		return std::chrono::nanoseconds(static_cast<int64_t>(nanoseconds));
+	}
+
+	TreeSizeEstimate EstimateTreeSize(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, int max_depth,
+		uint64_t exact_state_limit)
+	{
+		TreeSizeEstimate estimate;
+		estimate.max_depth = std::min(max_depth, MAX_TURN_COUNT);
+
+		// Search the top of the tree breadth first, like the solver would (see SolveOneIteration()).
+		std::shared_ptr<GameState> root = std::make_shared<GameState>(*initial_state);
+		root->ResetContext();
+		std::vector<Subtree> subtrees(1);
+		subtrees[0].frontier.push_back(root);
+		subtrees[0].cache.insert(root);
+		double cache_hit_rate = 0.0;
+		uint64_t exact_node_count = 0;
+		auto start_time = std::chrono::steady_clock::now();
+		for (int depth = 1; depth <= estimate.max_depth; ++depth)
+		{
+			uint64_t frontier_size = 0;
+			for (const Subtree& subtree : subtrees)
+			{
+				frontier_size += subtree.frontier.size();
+			}
+			if (frontier_size * 4 > exact_state_limit)
+				break;
+
+			uint64_t generated = 0;
+			uint64_t cache_hits = 0;
+			for (Subtree& subtree : subtrees)
+			{
+				std::vector<std::shared_ptr<GameState>> next_frontier;
+				for (const std::shared_ptr<GameState>& state : subtree.frontier)
+				{
+					for (Direction direction : ALL_DIRECTIONS)
+					{
+						std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+						++generated;
+						// The solver stops at the first win, so winning states are never expanded.
+						if (new_state->HaveWon())
+							continue;
+						if (depth <= options.max_cache_depth && !subtree.cache.insert(new_state).second)
+						{
+							++cache_hits;
+							continue;
+						}
+						if (!new_state->CheckIfPossibleToWin() || depth >= estimate.max_depth)
+							continue;
+						next_frontier.push_back(new_state);
+					}
+				}
+				subtree.frontier = std::move(next_frontier);
+			}
+			estimate.nodes_generated[depth] = static_cast<double>(generated);
+			estimate.exact_depth = depth;
+			exact_node_count += generated;
+			cache_hit_rate = generated == 0 ? 0.0 : static_cast<double>(cache_hits) / generated;
+
+			// Below the parallelism depth, each parallelism root's subtree is searched with its own
+			// cache. The copy of the shared cache that each one starts with only has game states
+			// above the parallelism depth, which can't match deeper game states, so it's left out.
+			if (depth == options.parallelism_depth)
+			{
+				std::vector<Subtree> root_subtrees(subtrees[0].frontier.size());
+				for (std::size_t i = 0; i < root_subtrees.size(); ++i)
+				{
+					root_subtrees[i].frontier.push_back(subtrees[0].frontier[i]);
+				}
+				subtrees = std::move(root_subtrees);
+			}
+		}
+		auto exact_duration = std::chrono::steady_clock::now() - start_time;
+		if (exact_node_count > 0)
+		{
+			estimate.nanoseconds_per_node = std::chrono::duration<double, std::nano>(exact_duration).count() / exact_node_count;
+		}
+
+		std::vector<std::shared_ptr<GameState>> frontier;
+		for (const Subtree& subtree : subtrees)
+		{
+			frontier.insert(frontier.end(), subtree.frontier.begin(), subtree.frontier.end());
+		}
+		if (estimate.exact_depth >= estimate.max_depth || frontier.empty())
+			return estimate;
+
+		// Probe the rest of the tree.
+		int probe_count = std::max(1, options.estimate_probe_count);
+		std::mt19937_64 rng(PROBE_SEED);
+		std::uniform_int_distribution<std::size_t> random_frontier_index(0, frontier.size() - 1);
+		std::array<double, MAX_TURN_COUNT + 1> node_sums{};
+		std::vector<std::shared_ptr<GameState>> children;
+		for (int probe = 0; probe < probe_count; ++probe)
+		{
+			std::shared_ptr<GameState> state = frontier[random_frontier_index(rng)];
+			// How many game states at the current depth the probe's game state stands for.
+			double weight = static_cast<double>(frontier.size());
+			for (int depth = estimate.exact_depth + 1; depth <= estimate.max_depth; ++depth)
+			{
+				node_sums[depth] += 4 * weight;
+				if (depth == estimate.max_depth)
+					break;
+				children.clear();
+				for (Direction direction : ALL_DIRECTIONS)
+				{
+					std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+					if (!new_state->HaveWon() && new_state->CheckIfPossibleToWin())
+						children.push_back(new_state);
+				}
+				if (children.empty())
+					break;
+				double branching_factor = static_cast<double>(children.size());
+				if (depth <= options.max_cache_depth)
+					branching_factor *= 1.0 - cache_hit_rate;
+				weight *= branching_factor;
+				state = children[std::uniform_int_distribution<std::size_t>(0, children.size() - 1)(rng)];
+			}
+		}
+		for (int depth = estimate.exact_depth + 1; depth <= estimate.max_depth; ++depth)
+		{
+			estimate.nodes_generated[depth] = node_sums[depth] / probe_count;
+		}
+		return estimate;
+	}
+
+	DepthSuggestion SuggestDepths(const TreeSizeEstimate& estimate, std::chrono::nanoseconds time_budget, unsigned int worker_count)
+	{
+		DepthSuggestion suggestion;
+		// Even if nothing fits in the budget, suggest searching one move deep.
+		suggestion.max_turn_depth = 1;
+		for (int depth = 2; depth <= estimate.max_depth; ++depth)
+		{
+			if (estimate.EstimatedDuration(depth, worker_count) > time_budget)
+				break;
+			suggestion.max_turn_depth = depth;
+		}
+		suggestion.estimated_nodes = estimate.TotalNodes(suggestion.max_turn_depth);
+		suggestion.estimated_duration = estimate.EstimatedDuration(suggestion.max_turn_depth, worker_count);
+		suggestion.parallelism_depth = SuggestParallelismDepth(estimate, suggestion.max_turn_depth, worker_count);
+		return suggestion;
+	}
+
+	int SuggestParallelismDepth(const TreeSizeEstimate& estimate, int max_turn_depth, unsigned int worker_count)
+	{
+		// Every game state that survives at the parallelism depth becomes a parallelism root, and
+		// each surviving game state generates 4 game states at the next depth.
+		for (int depth = 1; depth < max_turn_depth; ++depth)
+		{
+			if (estimate.nodes_generated[depth + 1] / 4 >= ROOTS_PER_WORKER * std::max(1u, worker_count))
+				return depth;
+		}
+		return std::max(1, max_turn_depth - 1);
+	}
+
+}  // namespace BabaSolver
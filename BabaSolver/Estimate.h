@@ -0,0 +1,80 @@
+// Code for estimating the size of the move tree that the solver will search, before searching it.
+//
+// The estimate has two parts:
+// * The top of the move tree is searched breadth first with the same cache and pruning as the
+//   solver (one shared cache down to the parallelism depth, and one cache per parallelism root
+//   below it), until a depth has too many game states to search cheaply. The counts for these
+//   depths are exact.
+// * Below that depth, the size of the tree is estimated with Knuth's random probes. Each probe
+//   starts at a random game state of the last exact depth and walks down the tree, picking a random
+//   surviving child at each depth. The product of the numbers of surviving children along the walk
+//   is an unbiased estimate of the number of game states at each depth of a tree. Probes can't see
+//   the cache, so at depths that the solver caches, the number of surviving children is scaled by
+//   the cache hit rate of the last exact depth. Cache hit rates grow with the depth, so the
+//   estimate tends to be too high for deep searches.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "GameState.h"
+#include "Solver.h"
+
+namespace BabaSolver
+{
+	// Above this many game states at one depth, EstimateTreeSize() switches from searching the
+	// tree to probing it.
+	inline constexpr uint64_t DEFAULT_EXACT_STATE_LIMIT = 50'000;
+
+	// The estimated size of a move tree.
+	struct TreeSizeEstimate
+	{
+		// Estimated number of game states generated at each depth (see
+		// DepthStats::nodes_generated), indexed by the turn count relative to the initial state.
+		std::array<double, MAX_TURN_COUNT + 1> nodes_generated{};
+		// The deepest depth for which nodes_generated is exact.
+		int exact_depth = 0;
+		// The deepest depth that was estimated.
+		int max_depth = 0;
+		// The measured time to generate one game state (including the cache insert and pruning
+		// checks) on one thread.
+		double nanoseconds_per_node = 0.0;
+
+		// Returns the estimated number of game states generated by a search down to max_turn_depth.
+		double TotalNodes(int max_turn_depth) const;
+
+		// Returns the estimated time of a search down to max_turn_depth on worker_count threads.
+		std::chrono::nanoseconds EstimatedDuration(int max_turn_depth, unsigned int worker_count) const;
+	};
+
+	// Estimates the size of the move tree that Solve() searches from initial_state with the given
+	// options, down to max_depth (which may be deeper than options.max_turn_depth).
+	// options.estimate_probe_count probes are used below the exact depths. The probes use a fixed
+	// random seed, so the estimate is deterministic.
+	TreeSizeEstimate EstimateTreeSize(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, int max_depth,
+		uint64_t exact_state_limit = DEFAULT_EXACT_STATE_LIMIT);
+
+	// Depths suggested by SuggestDepths().
+	struct DepthSuggestion
+	{
+		int max_turn_depth = 0;
+		int parallelism_depth = 0;
+		// The estimated number of game states generated and time of the search with these depths.
+		double estimated_nodes = 0.0;
+		std::chrono::nanoseconds estimated_duration{};
+	};
+
+	// Suggests the deepest max_turn_depth whose search is estimated to fit in time_budget on
+	// worker_count threads, and the shallowest parallelism_depth that gives each worker thread
+	// several parallelism roots to balance the load with. The estimate must have been made with
+	// the parallelism depth that will be used, since it changes how much the caches prune.
+	DepthSuggestion SuggestDepths(const TreeSizeEstimate& estimate, std::chrono::nanoseconds time_budget, unsigned int worker_count);
+
+	// Returns the shallowest parallelism depth (less than max_turn_depth if possible) that gives
+	// each of the worker_count worker threads several parallelism roots to balance the load with.
+	int SuggestParallelismDepth(const TreeSizeEstimate& estimate, int max_turn_depth, unsigned int worker_count);
+
+}  // namespace BabaSolver
@@ -7,18 +7,17 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stack>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
 #include "GameState.h"
+#include "Hash.h"
 
 namespace BabaSolver
 {
-	static constexpr int8_t DOOR_I = 12;
-	static constexpr int8_t DOOR_J = 4;
-
 	static constexpr int8_t BABA_DEAD = -1;
 
 	static char GameObjectToChar(GameObject obj)
@@ -100,6 +99,59 @@ namespace BabaSolver
 	static GameObject ALWAYS_MOVABLE_OBJECTS[] = {
 		GameObject::KEY, GameObject::ROCK_TEXT, GameObject::IS_TEXT, GameObject::PUSH_TEXT };
 
+	namespace
+	{
+		// A candidate for the game state before a move, while GameState::UndoMove() undoes the
+		// moves of the Babas one at a time.
+		struct UndoCandidate
+		{
+			uint16_t grid[GRID_HEIGHT][GRID_WIDTH];
+			Coordinate baba1;
+			Coordinate baba2;
+		};
+
+		// Adds to candidates the ways that one of the Babas (Baba #2 if second_baba is true) may
+		// have moved by (delta_i, delta_j) to reach after: not at all (e.g. it walked into a
+		// wall), or from the cell behind it while pushing the objects in 0 or more of the cells
+		// in front of it. Rocks are only pushed when "ROCK IS PUSH" is active before the move, so
+		// the objects are pulled back both with and without the rocks. Some candidates aren't
+		// valid; GameState::UndoMove() replays the move to check them.
+		void AddUndoCandidates(const UndoCandidate& after, bool second_baba, int8_t delta_i, int8_t delta_j,
+			std::vector<UndoCandidate>& candidates)
+		{
+			candidates.push_back(after);
+			Coordinate baba = second_baba ? after.baba2 : after.baba1;
+			Coordinate from = { static_cast<int8_t>(baba.i - delta_i), static_cast<int8_t>(baba.j - delta_j) };
+			if (from.i < 0 || from.i >= GRID_HEIGHT || from.j < 0 || from.j >= GRID_WIDTH)
+				return;
+
+			const uint16_t rock_bitmask = 1 << static_cast<uint16_t>(GameObject::ROCK);
+			for (uint16_t pull_bitmask : { MOVABLE_OBJECT_BITMASK, static_cast<uint16_t>(MOVABLE_OBJECT_BITMASK | rock_bitmask) })
+			{
+				UndoCandidate candidate = after;
+				(second_baba ? candidate.baba2 : candidate.baba1) = from;
+				if (pull_bitmask == MOVABLE_OBJECT_BITMASK)
+					candidates.push_back(candidate);
+				// Pull the objects of one more cell back by one cell for each candidate.
+				int8_t prev_i = baba.i;
+				int8_t prev_j = baba.j;
+				int8_t i = baba.i + delta_i;
+				int8_t j = baba.j + delta_j;
+				while (i >= 0 && i < GRID_HEIGHT && j >= 0 && j < GRID_WIDTH && (candidate.grid[i][j] & pull_bitmask) != 0)
+				{
+					uint16_t pulled = candidate.grid[i][j] & pull_bitmask;
+					candidate.grid[i][j] &= ~pulled;
+					candidate.grid[prev_i][prev_j] |= pulled;
+					candidates.push_back(candidate);
+					prev_i = i;
+					prev_j = j;
+					i += delta_i;
+					j += delta_j;
+				}
+			}
+		}
+	}  // namespace
+
 	GameState::GameState(uint16_t grid[GRID_HEIGHT][GRID_WIDTH], Coordinate baba1, Coordinate baba2)
 		: _baba1(baba1), _baba2(baba2), _turn(0), _key({ -1, -1 }), _is_text({ -1, -1 }), _rock_is_push_active()
 	{
@@ -160,6 +212,64 @@ namespace BabaSolver
 		return new_state;
 	}
 
+	std::vector<std::shared_ptr<GameState>> GameState::UndoMove(Direction direction) const
+	{
+		std::vector<std::shared_ptr<GameState>> previous_states;
+		if (!AllBabasAlive())
+			return previous_states;
+		int8_t delta_i = direction == Direction::UP ? -1 : direction == Direction::DOWN ? 1 : 0;
+		int8_t delta_j = direction == Direction::LEFT ? -1 : direction == Direction::RIGHT ? 1 : 0;
+		if (delta_i == 0 && delta_j == 0)
+		{
+			// Programmer error
+			std::cerr << "Invalid direction in GameState::UndoMove(): " << static_cast<uint32_t>(direction) << std::endl;
+			std::abort();
+		}
+
+		// Baba #1 moves first, so Baba #2's move is undone first.
+		UndoCandidate after;
+		std::copy(&_grid[0][0], &_grid[0][0] + GRID_CELL_COUNT, &after.grid[0][0]);
+		after.baba1 = _baba1;
+		after.baba2 = _baba2;
+		std::vector<UndoCandidate> baba2_candidates;
+		AddUndoCandidates(after, true, delta_i, delta_j, baba2_candidates);
+		std::vector<UndoCandidate> candidates;
+		for (const UndoCandidate& baba2_candidate : baba2_candidates)
+			AddUndoCandidates(baba2_candidate, false, delta_i, delta_j, candidates);
+
+		// Keep the candidates from which the move leads back to this game state.
+		std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual> seen_states;
+		for (UndoCandidate& candidate : candidates)
+		{
+			std::shared_ptr<GameState> state = std::make_shared<GameState>(candidate.grid, candidate.baba1, candidate.baba2);
+			if (!state->AllBabasAlive() || state->HaveWon())
+				continue;
+			std::shared_ptr<GameState> next_state = state->ApplyMove(direction);
+			if (next_state->_baba1.i != _baba1.i || next_state->_baba1.j != _baba1.j || next_state->_baba2.i != _baba2.i
+				|| next_state->_baba2.j != _baba2.j || !std::equal(&_grid[0][0], &_grid[0][0] + GRID_CELL_COUNT, &next_state->_grid[0][0]))
+				continue;
+			if (seen_states.insert(state).second)
+				previous_states.push_back(state);
+		}
+		return previous_states;
+	}
+
+	std::shared_ptr<GameState> GameState::ApplyMoves(const std::vector<Direction>& moves) const
+	{
+		if (_turn + moves.size() > MAX_TURN_COUNT)
+		{
+			// Programmer error
+			std::cerr << "Too many moves in GameState::ApplyMoves(): " << moves.size() << std::endl;
+			std::abort();
+		}
+		std::shared_ptr<GameState> state = std::make_shared<GameState>(*this);
+		for (Direction direction : moves)
+		{
+			state = state->ApplyMove(direction);
+		}
+		return state;
+	}
+
 	bool GameState::HaveWon() const
 	{
 		// Optimization: The Door's coordinates are hard-coded because it doesn't move.
@@ -167,21 +277,26 @@ namespace BabaSolver
 	}
 
 	bool GameState::CheckIfPossibleToWin() const
+	{
+		return CheckWhyImpossibleToWin() == LossReason::NONE;
+	}
+
+	LossReason GameState::CheckWhyImpossibleToWin() const
 	{
 		if (!AllBabasAlive())
-			return false;
+			return LossReason::DEAD_BABA;
 
 		// If any of the text objects are *not* on the upper right platform or to the right of it,
 		// then it's impossible to win.
 		if (_is_text.i <= 2 || _is_text.i >= 8 || _is_text.j <= 9)
-			return false;
+			return LossReason::TEXT_OUT_OF_REGION;
 
 		for (int8_t i = 0; i <= 2; ++i)
 		{
 			for (int8_t j = 10; j <= 17; ++j)
 			{
 				if (CellContainsGameObject(_grid[i][j], GameObject::ROCK_TEXT) || CellContainsGameObject(_grid[i][j], GameObject::PUSH_TEXT))
-					return false;
+					return LossReason::TEXT_OUT_OF_REGION;
 			}
 		}
 		for (int8_t i = 8; i <= 10; ++i)
@@ -189,7 +304,7 @@ namespace BabaSolver
 			for (int8_t j = 10; j <= 17; ++j)
 			{
 				if (CellContainsGameObject(_grid[i][j], GameObject::ROCK_TEXT) || CellContainsGameObject(_grid[i][j], GameObject::PUSH_TEXT))
-					return false;
+					return LossReason::TEXT_OUT_OF_REGION;
 			}
 		}
 		for (int8_t i = 3; i <= 7; ++i)
@@ -197,16 +312,16 @@ namespace BabaSolver
 			for (int8_t j = 7; j <= 9; ++j)
 			{
 				if (CellContainsGameObject(_grid[i][j], GameObject::ROCK_TEXT) || CellContainsGameObject(_grid[i][j], GameObject::PUSH_TEXT))
-					return false;
+					return LossReason::TEXT_OUT_OF_REGION;
 			}
 		}
-		return true;
+		return LossReason::NONE;
 	}
 
 	int GameState::CalculateScore() const
 	{
 		if (!CheckIfPossibleToWin())
-			return -1'000'000;
+			return IMPOSSIBLE_TO_WIN_SCORE;
 
 		// First milestone: The three rocks are moved in between the two upper platforms. This
 		// creates a "bridge" between the two platforms.
@@ -214,13 +329,7 @@ namespace BabaSolver
 		int8_t rock_row = -1;
 		for (int8_t i = 3; i <= 7; ++i)
 		{
-			int rock_count = 0;
-			for (int8_t j = 7; j <= 9; ++j)
-			{
-				if (CellContainsGameObject(_grid[i][j], GameObject::ROCK))
-					++rock_count;
-			}
-			switch (rock_count)
+			switch (CountRocksInRow(i))
 			{
 			case 1:
 				score += 100;
@@ -244,17 +353,9 @@ namespace BabaSolver
 		if (rock_row != -1)
 		{
 			if (!CheckIfTextCanBeAlignedWithRocks(rock_row))
-				return -1;
+				return TEXT_CANNOT_BE_ALIGNED_SCORE;
 
-			int text_aligned_count = 0;
-			if (_is_text.i == rock_row)
-				++text_aligned_count;
-			for (int8_t j = 10; j <= 17; ++j)
-			{
-				if (CellContainsGameObject(_grid[rock_row][j], GameObject::ROCK_TEXT) || CellContainsGameObject(_grid[rock_row][j], GameObject::PUSH_TEXT))
-					++text_aligned_count;
-			}
-			switch (text_aligned_count)
+			switch (CountTextAlignedWithRow(rock_row))
 			{
 			case 1:
 				score += 1'000;
@@ -283,7 +384,55 @@ namespace BabaSolver
 		return score;
 	}
 
-	void GameState::PrintGrid() const
+	int GameState::CountRocksInBridgeRow() const
+	{
+		int max_rock_count = 0;
+		for (int8_t i = 3; i <= 7; ++i)
+			max_rock_count = std::max(max_rock_count, CountRocksInRow(i));
+		return max_rock_count;
+	}
+
+	int8_t GameState::RockBridgeRow() const
+	{
+		for (int8_t i = 3; i <= 7; ++i)
+		{
+			if (CountRocksInRow(i) == 3)
+				return i;
+		}
+		return -1;
+	}
+
+	bool GameState::TextAlignedWithRockBridge() const
+	{
+		int8_t rock_row = RockBridgeRow();
+		return rock_row != -1 && !_rock_is_push_active && CountTextAlignedWithRow(rock_row) == 3;
+	}
+
+	int GameState::CountTextAlignedWithRow(int8_t row) const
+	{
+		int text_aligned_count = 0;
+		if (_is_text.i == row)
+			++text_aligned_count;
+		for (int8_t j = 10; j <= 17; ++j)
+		{
+			if (CellContainsGameObject(_grid[row][j], GameObject::ROCK_TEXT) || CellContainsGameObject(_grid[row][j], GameObject::PUSH_TEXT))
+				++text_aligned_count;
+		}
+		return text_aligned_count;
+	}
+
+	int GameState::CountRocksInRow(int8_t row) const
+	{
+		int rock_count = 0;
+		for (int8_t j = 7; j <= 9; ++j)
+		{
+			if (CellContainsGameObject(_grid[row][j], GameObject::ROCK))
+				++rock_count;
+		}
+		return rock_count;
+	}
+
+	void GameState::PrintGrid(std::ostream& out) const
 	{
 		GameObject objects_by_priority[] = {
 				GameObject::IMMOVABLE,
@@ -296,15 +445,15 @@ namespace BabaSolver
 				GameObject::TILE,
 		};
 		std::string perimeter(GRID_WIDTH + 2, 'X');
-		std::cout << perimeter << '\n';
+		out << perimeter << '\n';
 		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
 		{
-			std::cout << 'X';
+			out << 'X';
 			for (int8_t j = 0; j < GRID_WIDTH; ++j)
 			{
 				if ((i == _baba1.i && j == _baba1.j) || (i == _baba2.i && j == _baba2.j))
 				{
-					std::cout << 'B';
+					out << 'B';
 					continue;
 				}
 
@@ -313,7 +462,7 @@ namespace BabaSolver
 				{
 					if (CellContainsGameObject(_grid[i][j], obj))
 					{
-						std::cout << GameObjectToChar(obj);
+						out << GameObjectToChar(obj);
 						found_obj = true;
 						break;
 					}
@@ -323,7 +472,7 @@ namespace BabaSolver
 
 				if (CellIsEmpty(_grid[i][j]))
 				{
-					std::cout << ' ';
+					out << ' ';
 				}
 				else
 				{
@@ -332,29 +481,29 @@ namespace BabaSolver
 					std::abort();
 				}
 			}
-			std::cout << "X\n";
+			out << "X\n";
 		}
-		std::cout << perimeter << std::endl;
+		out << perimeter << std::endl;
 	}
 
-	void GameState::PrintMoves() const
+	void GameState::PrintMoves(std::ostream& out) const
 	{
-		std::cout << static_cast<uint32_t>(_turn) << " moves:";
+		out << static_cast<uint32_t>(_turn) << " moves:";
 		for (int i = 0; i < _turn; ++i)
 		{
 			switch (_moves[i])
 			{
 			case Direction::UP:
-				std::cout << " U";
+				out << " U";
 				break;
 			case Direction::RIGHT:
-				std::cout << " R";
+				out << " R";
 				break;
 			case Direction::DOWN:
-				std::cout << " D";
+				out << " D";
 				break;
 			case Direction::LEFT:
-				std::cout << " L";
+				out << " L";
 				break;
 			default:
 				// Should not be able to reach this code.
@@ -362,7 +511,7 @@ namespace BabaSolver
 				std::abort();
 			}
 		}
-		std::cout << std::endl;
+		out << std::endl;
 	}
 
 	void GameState::MoveBaba(Coordinate& baba, Direction direction)
@@ -547,65 +696,106 @@ namespace BabaSolver
 		return true;
 	}
 
-	static uint16_t CombineUInt8s(uint8_t n1, uint8_t n2)
-	{
-		return (static_cast<uint16_t>(n1) << 8) | n2;
-	}
-
-	static uint32_t CombineUInt16s(uint16_t n1, uint16_t n2)
+	std::size_t GameStateHash::operator()(const std::shared_ptr<GameState>& state) const
 	{
-		return (static_cast<uint32_t>(n1) << 16) | n2;
+#if BABA_SOLVER_HASH == BABA_SOLVER_HASH_LEGACY
+		return static_cast<std::size_t>(LegacyHash(*state));
+#elif BABA_SOLVER_HASH == BABA_SOLVER_HASH_ZOBRIST
+		return static_cast<std::size_t>(ZobristHash(*state));
+#elif BABA_SOLVER_HASH == BABA_SOLVER_HASH_WYHASH
+		return static_cast<std::size_t>(WyHash(*state));
+#elif BABA_SOLVER_HASH == BABA_SOLVER_HASH_XXH64
+		return static_cast<std::size_t>(Xxh64Hash(*state));
+#else
+#error "Invalid value for BABA_SOLVER_HASH"
+#endif
 	}
 
-	static uint64_t CombineUInt32s(uint32_t n1, uint32_t n2)
+	bool GameStateEqual::operator()(const std::shared_ptr<GameState>& lhs, const std::shared_ptr<GameState>& rhs) const
 	{
-		return (static_cast<uint64_t>(n1) << 32) | n2;
+		// TODO: Instead of checking _turn for equality here, we should check that a GameState at a
+		// lower _turn number has already been cached.
+		if (lhs->_turn != rhs->_turn) return false;
+		if (lhs->_baba1.i != rhs->_baba1.i || lhs->_baba1.j != rhs->_baba1.j) return false;
+		if (lhs->_baba2.i != rhs->_baba2.i || lhs->_baba2.j != rhs->_baba2.j) return false;
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				if (lhs->_grid[i][j] != rhs->_grid[i][j])
+					return false;
+			}
+		}
+		return true;
 	}
 
-	static std::size_t ApplyHash(uint32_t to_apply, std::size_t current_hash)
+	bool IsNoOpMove(const GameState& parent_state, const GameState& new_state)
 	{
-		// Note: I forgot where I got this code from, but it was on Stack Overflow somewhere. I have
-		// no idea how good or bad it is.
-		// TODO: Check how effective this hashing code is.
-		to_apply = ((to_apply >> 16) ^ to_apply) * 0x45d9f3b;
-		to_apply = ((to_apply >> 16) ^ to_apply) * 0x45d9f3b;
-		to_apply = (to_apply >> 16) ^ to_apply;
-		current_hash ^= static_cast<std::size_t>(to_apply) + 0x9e3779b9 + (current_hash << 6) + (current_hash >> 2);
-		return current_hash;
+		// Game objects only move when a Baba moves, so if neither Baba moved (or died), then
+		// nothing changed.
+		return new_state._baba1.i == parent_state._baba1.i && new_state._baba1.j == parent_state._baba1.j &&
+			new_state._baba2.i == parent_state._baba2.i && new_state._baba2.j == parent_state._baba2.j;
 	}
 
-	std::size_t GameStateHash::operator()(const std::shared_ptr<GameState>& state) const
+	std::optional<std::vector<Direction>> ParseMoves(const std::string& moves_str)
 	{
-		std::size_t hash = static_cast<std::size_t>(state->_turn) * 37;
-		uint32_t babas = CombineUInt16s(CombineUInt8s(state->_baba1.i, state->_baba1.j),
-			CombineUInt8s(state->_baba2.i, state->_baba2.j));
-		hash = ApplyHash(babas, hash);
-		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		std::vector<Direction> moves;
+		moves.reserve(moves_str.size());
+		for (char c : moves_str)
 		{
-			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			switch (c)
 			{
-				hash = ApplyHash(state->_grid[i][j], hash);
+			case 'U':
+				moves.push_back(Direction::UP);
+				break;
+			case 'R':
+				moves.push_back(Direction::RIGHT);
+				break;
+			case 'D':
+				moves.push_back(Direction::DOWN);
+				break;
+			case 'L':
+				moves.push_back(Direction::LEFT);
+				break;
+			default:
+				return std::nullopt;
 			}
 		}
-		return hash;
+		return moves;
 	}
 
-	bool GameStateEqual::operator()(const std::shared_ptr<GameState>& lhs, const std::shared_ptr<GameState>& rhs) const
+	std::string FormatMoves(const std::vector<Direction>& moves)
 	{
-		// TODO: Instead of checking _turn for equality here, we should check that a GameState at a
-		// lower _turn number has already been cached.
-		if (lhs->_turn != rhs->_turn) return false;
-		if (lhs->_baba1.i != rhs->_baba1.i || lhs->_baba1.j != rhs->_baba1.j) return false;
-		if (lhs->_baba2.i != rhs->_baba2.i || lhs->_baba2.j != rhs->_baba2.j) return false;
-		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		std::string moves_str;
+		moves_str.reserve(moves.size());
+		for (Direction direction : moves)
 		{
-			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			switch (direction)
 			{
-				if (lhs->_grid[i][j] != rhs->_grid[i][j])
-					return false;
+			case Direction::UP:
+				moves_str += 'U';
+				break;
+			case Direction::RIGHT:
+				moves_str += 'R';
+				break;
+			case Direction::DOWN:
+				moves_str += 'D';
+				break;
+			case Direction::LEFT:
+				moves_str += 'L';
+				break;
+			default:
+				// Should not be able to reach this code.
+				std::cerr << "Invalid direction in FormatMoves(): " << static_cast<uint32_t>(direction) << std::endl;
+				std::abort();
 			}
 		}
-		return true;
+		return moves_str;
+	}
+
+	std::string FormatMoves(const GameState& state)
+	{
+		return FormatMoves(std::vector<Direction>(state._moves, state._moves + state._turn));
 	}
 
 	std::shared_ptr<GameState> FloatiestPlatformsLevel()
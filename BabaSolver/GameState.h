@@ -11,6 +11,7 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stack>
 #include <string>
 #include <unordered_set>
@@ -25,6 +26,9 @@ namespace BabaSolver
 	inline constexpr int8_t GRID_HEIGHT = 18;
 	inline constexpr int8_t GRID_WIDTH = 18;
 	inline constexpr int16_t GRID_CELL_COUNT = GRID_HEIGHT * GRID_WIDTH;
+	// The location of the door. The door can't move, so every level has its door here.
+	inline constexpr int8_t DOOR_I = 12;
+	inline constexpr int8_t DOOR_J = 4;
 
 	// Coordinate represents a point in a GameState's grid.
 	struct Coordinate
@@ -57,6 +61,19 @@ namespace BabaSolver
 		PUSH_TEXT,
 	};
 
+	// Represents the reason why it's impossible to reach a winning state from a GameState.
+	enum class LossReason : uint8_t
+	{
+		NONE,  // Special, used to indicate that it's still possible to win
+		DEAD_BABA,
+		TEXT_OUT_OF_REGION,
+	};
+
+	// The score of a GameState from which it's impossible to win.
+	inline constexpr int IMPOSSIBLE_TO_WIN_SCORE = -1'000'000;
+	// The score of a GameState whose text blocks can't be aligned with the rock bridge.
+	inline constexpr int TEXT_CANNOT_BE_ALIGNED_SCORE = -1;
+
 	// GameState is the object for storing and manipulating game states. A GameState contains a 2D
 	// grid of GameObjects representing the state of the game. A GameState also contains
 	// "contextual" member variables, e.g. the turn count and which moves have been done to get to
@@ -103,6 +120,16 @@ namespace BabaSolver
 		// *not* modify this GameState.
 		std::shared_ptr<GameState> ApplyMove(Direction direction) const;
 
+		// Applies the given moves in order and returns the resulting GameState. Does *not* modify
+		// this GameState.
+		std::shared_ptr<GameState> ApplyMoves(const std::vector<Direction>& moves) const;
+
+		// Returns every game state from which ApplyMove(direction) leads to the positions of this
+		// GameState, i.e. the reverse of ApplyMove(), where the Babas pull the objects that they
+		// pushed. The returned game states have their "context" reset. Game states with a dead Baba
+		// and winning game states are left out, since no search continues from them.
+		std::vector<std::shared_ptr<GameState>> UndoMove(Direction direction) const;
+
 		// Returns true if this GameState is a winning state, false otherwise.
 		bool HaveWon() const;
 
@@ -110,15 +137,33 @@ namespace BabaSolver
 		// otherwise.
 		bool CheckIfPossibleToWin() const;
 
+		// Same as CheckIfPossibleToWin(), but returns the reason why it's impossible to win (or
+		// LossReason::NONE if it's still possible to win).
+		LossReason CheckWhyImpossibleToWin() const;
+
 		// Calculates the "score" of this GameState, which represents how likely the GameState will
 		// lead a winning game state.
 		int CalculateScore() const;
 
-		// Prints the state of the grid to stdout.
-		void PrintGrid() const;
+		// The following methods check the milestones that CalculateScore() rewards (see
+		// Planner.h). The last milestone is the key on the door (HaveWon()).
+
+		// Returns the most rocks in one row between the two upper platforms (0 to 3).
+		int CountRocksInBridgeRow() const;
+		// Returns the row of the "bridge" of three rocks between the two upper platforms (the first
+		// milestone), or -1 if there's no bridge.
+		int8_t RockBridgeRow() const;
+		// Returns true if the three text blocks are in the row of the rock bridge and "ROCK IS
+		// PUSH" is broken (the second milestone), so the Babas can walk over the rocks.
+		bool TextAlignedWithRockBridge() const;
+		// Checks if the Babas are in the same cell of the grid (the third milestone).
+		bool BabasOnSameSpace() const;
+
+		// Prints the state of the grid to out.
+		void PrintGrid(std::ostream& out = std::cout) const;
 
-		// Prints the history of moves to stdout.
-		void PrintMoves() const;
+		// Prints the history of moves to out.
+		void PrintMoves(std::ostream& out = std::cout) const;
 
 	private:
 		// Moves the given Baba in the given direction, applying all the relevant game rules (e.g.
@@ -140,9 +185,6 @@ namespace BabaSolver
 		// Checks if all Babas are alive.
 		bool AllBabasAlive() const;
 
-		// Checks if the Babas are in the same cell of the grid.
-		bool BabasOnSameSpace() const;
-
 		// Checks if the "ROCK IS PUSH" text blocks are intact (and thus the rule is active).
 		bool CheckRockIsPushIntact() const;
 
@@ -150,6 +192,12 @@ namespace BabaSolver
 		// This is used as an optimization for pruning paths in the move tree that won't lead to a
 		// winning game state.
 		bool CheckIfTextCanBeAlignedWithRocks(int8_t rock_row) const;
+
+		// Returns how many of the three text blocks are in the given row to the right of the rocks.
+		int CountTextAlignedWithRow(int8_t row) const;
+
+		// Returns how many rocks are in the given row between the two upper platforms.
+		int CountRocksInRow(int8_t row) const;
 	};
 
 	// Function object for hashing GameStates for a hash map.
@@ -164,6 +212,20 @@ namespace BabaSolver
 		bool operator()(const std::shared_ptr<GameState>& lhs, const std::shared_ptr<GameState>& rhs) const;
 	};
 
+	// Returns true if new_state was created by applying a move to parent_state and the move didn't
+	// change anything (e.g. both Babas walked into walls).
+	bool IsNoOpMove(const GameState& parent_state, const GameState& new_state);
+
+	// Parses a string of moves, e.g. "UDLR" -> {UP, DOWN, LEFT, RIGHT}. Returns std::nullopt if the
+	// string contains a character other than 'U', 'R', 'D', or 'L'.
+	std::optional<std::vector<Direction>> ParseMoves(const std::string& moves_str);
+
+	// Formats moves as a string that ParseMoves() accepts, e.g. "UDLR".
+	std::string FormatMoves(const std::vector<Direction>& moves);
+
+	// Formats the history of moves of state as a string that ParseMoves() accepts.
+	std::string FormatMoves(const GameState& state);
+
 	// Creates the Floatiest Platforms level.
 	std::shared_ptr<GameState> FloatiestPlatformsLevel();
 
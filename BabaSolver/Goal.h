@@ -0,0 +1,87 @@
+// Goals and heuristics for the solver's search.
+//
+// The solver searches for a game state that reaches its goal, and when an iteration doesn't reach
+// it, continues from the leaf game state that its heuristic scores the highest. By default the
+// goal is the win (GameState::HaveWon()) and the heuristic is GameState::CalculateScore(), but any
+// type with the same member functions can be used instead, e.g. to search for a subgoal of a
+// level, for an exact game state, or for a goal that only a test cares about:
+//
+//   struct MyGoal { bool IsReached(const GameState& state) const; };
+//   struct MyHeuristic { int Score(const GameState& state) const; };
+//
+// They are template parameters of the search (see SolverSearch.h) instead of std::functions, so
+// that the calls in the hot loop are inlined. They are called from several threads at once, so
+// they must not modify shared state. The search still prunes the game states from which the
+// level can't be won (see GameState::CheckIfPossibleToWin()), whatever the goal.
+
+#pragma once
+
+#include <cstring>
+#include <utility>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// The default goal: the level is won.
+	struct WinGoal
+	{
+		bool IsReached(const GameState& state) const
+		{
+			return state.HaveWon();
+		}
+	};
+
+	// The default heuristic: the level-specific score of GameState::CalculateScore().
+	struct ScoreHeuristic
+	{
+		int Score(const GameState& state) const
+		{
+			return state.CalculateScore();
+		}
+	};
+
+	// The goal of reaching the positions of a given game state's game objects, whatever moves lead
+	// there.
+	class ReachStateGoal
+	{
+	public:
+		explicit ReachStateGoal(const GameState& target) : _target(target) {}
+
+		bool IsReached(const GameState& state) const
+		{
+			return state._baba1.i == _target._baba1.i && state._baba1.j == _target._baba1.j
+				&& state._baba2.i == _target._baba2.i && state._baba2.j == _target._baba2.j
+				&& std::memcmp(state._grid, _target._grid, sizeof(state._grid)) == 0;
+		}
+
+	private:
+		GameState _target;
+	};
+
+	// A goal defined by a function object that takes a const GameState& and returns a bool, e.g.
+	// PredicateGoal{ [](const GameState& state) { return state.BabasOnSameSpace(); } }.
+	template <typename Predicate>
+	struct PredicateGoal
+	{
+		Predicate predicate;
+
+		bool IsReached(const GameState& state) const
+		{
+			return predicate(state);
+		}
+	};
+
+	// A heuristic defined by a function object that takes a const GameState& and returns an int.
+	template <typename Function>
+	struct FunctionHeuristic
+	{
+		Function function;
+
+		int Score(const GameState& state) const
+		{
+			return function(state);
+		}
+	};
+
+}  // namespace BabaSolver
@@ -0,0 +1,341 @@
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "GameState.h"
+
+#include "Hash.h"
+
+namespace BabaSolver
+{
+	// The size of the packed state variables: 8 bytes for the turn and the Babas (padded with
+	// zeros), then the grid.
+	static constexpr std::size_t PACKED_STATE_SIZE = 8 + sizeof(uint16_t) * GRID_CELL_COUNT;
+
+	// Packs the state variables of the given GameState into out.
+	static void PackState(const GameState& state, uint8_t out[PACKED_STATE_SIZE])
+	{
+		out[0] = state._turn;
+		out[1] = static_cast<uint8_t>(state._baba1.i);
+		out[2] = static_cast<uint8_t>(state._baba1.j);
+		out[3] = static_cast<uint8_t>(state._baba2.i);
+		out[4] = static_cast<uint8_t>(state._baba2.j);
+		out[5] = 0;
+		out[6] = 0;
+		out[7] = 0;
+		std::memcpy(out + 8, &state._grid[0][0], sizeof(uint16_t) * GRID_CELL_COUNT);
+	}
+
+	static uint64_t Read64(const uint8_t* p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	const char* HashFunctionName(HashFunction hash_function)
+	{
+		switch (hash_function)
+		{
+		case HashFunction::LEGACY: return "legacy";
+		case HashFunction::ZOBRIST: return "zobrist";
+		case HashFunction::WYHASH: return "wyhash";
+		case HashFunction::XXH64: return "xxh64";
+		}
+		// Should not be able to reach this point.
+		std::cerr << "Invalid hash function in HashFunctionName(): " << static_cast<uint32_t>(hash_function) << std::endl;
+		std::abort();
+	}
+
+	uint64_t HashGameState(const GameState& state, HashFunction hash_function)
+	{
+		switch (hash_function)
+		{
+		case HashFunction::LEGACY: return LegacyHash(state);
+		case HashFunction::ZOBRIST: return ZobristHash(state);
+		case HashFunction::WYHASH: return WyHash(state);
+		case HashFunction::XXH64: return Xxh64Hash(state);
+		}
+		// Should not be able to reach this point.
+		std::cerr << "Invalid hash function in HashGameState(): " << static_cast<uint32_t>(hash_function) << std::endl;
+		std::abort();
+	}
+
+	// Legacy
+
+	static uint16_t CombineUInt8s(uint8_t n1, uint8_t n2)
+	{
+		return (static_cast<uint16_t>(n1) << 8) | n2;
+	}
+
+	static uint32_t CombineUInt16s(uint16_t n1, uint16_t n2)
+	{
+		return (static_cast<uint32_t>(n1) << 16) | n2;
+	}
+
+	static std::size_t ApplyHash(uint32_t to_apply, std::size_t current_hash)
+	{
+		// Note: I forgot where I got this code from, but it was on Stack Overflow somewhere. I have
+		// no idea how good or bad it is. See BabaSolverBenchmark --suite=hash for how it compares
+		// with the other hash functions.
+		to_apply = ((to_apply >> 16) ^ to_apply) * 0x45d9f3b;
+		to_apply = ((to_apply >> 16) ^ to_apply) * 0x45d9f3b;
+		to_apply = (to_apply >> 16) ^ to_apply;
+		current_hash ^= static_cast<std::size_t>(to_apply) + 0x9e3779b9 + (current_hash << 6) + (current_hash >> 2);
+		return current_hash;
+	}
+
+	uint64_t LegacyHash(const GameState& state)
+	{
+		std::size_t hash = static_cast<std::size_t>(state._turn) * 37;
+		uint32_t babas = CombineUInt16s(CombineUInt8s(state._baba1.i, state._baba1.j),
+			CombineUInt8s(state._baba2.i, state._baba2.j));
+		hash = ApplyHash(babas, hash);
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				hash = ApplyHash(state._grid[i][j], hash);
+			}
+		}
+		return hash;
+	}
+
+	// Zobrist
+
+	// The random numbers for Zobrist hashing. Baba locations are indexed by cell, with one extra
+	// entry for a dead Baba.
+	struct ZobristTable
+	{
+		uint64_t cells[GRID_CELL_COUNT][16];
+		uint64_t baba1[GRID_CELL_COUNT + 1];
+		uint64_t baba2[GRID_CELL_COUNT + 1];
+		uint64_t turn[256];
+	};
+
+	static uint64_t SplitMix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	static ZobristTable CreateZobristTable()
+	{
+		ZobristTable table{};
+		uint64_t seed = 0xbaba5eed;
+		for (auto& cell : table.cells)
+		{
+			for (uint64_t& value : cell)
+			{
+				value = SplitMix64(seed);
+			}
+		}
+		for (uint64_t& value : table.baba1)
+		{
+			value = SplitMix64(seed);
+		}
+		for (uint64_t& value : table.baba2)
+		{
+			value = SplitMix64(seed);
+		}
+		for (uint64_t& value : table.turn)
+		{
+			value = SplitMix64(seed);
+		}
+		return table;
+	}
+
+	static const ZobristTable ZOBRIST_TABLE = CreateZobristTable();
+
+	static int BabaIndex(Coordinate baba)
+	{
+		return baba.i < 0 ? GRID_CELL_COUNT : baba.i * GRID_WIDTH + baba.j;
+	}
+
+	uint64_t ZobristHash(const GameState& state)
+	{
+		uint64_t hash = ZOBRIST_TABLE.turn[state._turn] ^ ZOBRIST_TABLE.baba1[BabaIndex(state._baba1)]
+			^ ZOBRIST_TABLE.baba2[BabaIndex(state._baba2)];
+		const uint16_t* grid = &state._grid[0][0];
+		for (int16_t cell_index = 0; cell_index < GRID_CELL_COUNT; ++cell_index)
+		{
+			uint16_t cell = grid[cell_index];
+			while (cell != 0)
+			{
+				hash ^= ZOBRIST_TABLE.cells[cell_index][std::countr_zero(cell)];
+				cell &= cell - 1;
+			}
+		}
+		return hash;
+	}
+
+	// wyhash (https://github.com/wangyi-fudan/wyhash), final version 4.
+
+	static const uint64_t WYHASH_SECRET[4] = {
+		0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+	// Sets *a and *b to the low and high halves of the 128-bit product a * b.
+	static void WyMum(uint64_t* a, uint64_t* b)
+	{
+#if defined(__SIZEOF_INT128__)
+		__uint128_t product = static_cast<__uint128_t>(*a) * *b;
+		*a = static_cast<uint64_t>(product);
+		*b = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		*a = _umul128(*a, *b, b);
+#else
+		uint64_t ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+		uint64_t carry = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		carry += lo < t;
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+		*a = lo;
+		*b = hi;
+#endif
+	}
+
+	static uint64_t WyMix(uint64_t a, uint64_t b)
+	{
+		WyMum(&a, &b);
+		return a ^ b;
+	}
+
+	uint64_t WyHash(const GameState& state)
+	{
+		uint8_t packed[PACKED_STATE_SIZE];
+		PackState(state, packed);
+
+		// The packed state is always longer than 48 bytes, so only wyhash's path for long inputs
+		// is needed.
+		static_assert(PACKED_STATE_SIZE > 48);
+		const uint8_t* p = packed;
+		std::size_t length = PACKED_STATE_SIZE;
+		uint64_t seed = WyMix(WYHASH_SECRET[0], WYHASH_SECRET[1]);
+		std::size_t remaining = length;
+		uint64_t see1 = seed;
+		uint64_t see2 = seed;
+		do
+		{
+			seed = WyMix(Read64(p) ^ WYHASH_SECRET[1], Read64(p + 8) ^ seed);
+			see1 = WyMix(Read64(p + 16) ^ WYHASH_SECRET[2], Read64(p + 24) ^ see1);
+			see2 = WyMix(Read64(p + 32) ^ WYHASH_SECRET[3], Read64(p + 40) ^ see2);
+			p += 48;
+			remaining -= 48;
+		} while (remaining >= 48);
+		seed ^= see1 ^ see2;
+		while (remaining > 16)
+		{
+			seed = WyMix(Read64(p) ^ WYHASH_SECRET[1], Read64(p + 8) ^ seed);
+			p += 16;
+			remaining -= 16;
+		}
+		uint64_t a = Read64(p + remaining - 16) ^ WYHASH_SECRET[1];
+		uint64_t b = Read64(p + remaining - 8) ^ seed;
+		WyMum(&a, &b);
+		return WyMix(a ^ WYHASH_SECRET[0] ^ length, b ^ WYHASH_SECRET[1]);
+	}
+
+	// XXH64 (https://github.com/Cyan4973/xxHash)
+
+	static constexpr uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ull;
+	static constexpr uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ull;
+	static constexpr uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+	static uint64_t Xxh64Round(uint64_t acc, uint64_t input)
+	{
+		acc += input * XXH_PRIME64_2;
+		acc = std::rotl(acc, 31);
+		return acc * XXH_PRIME64_1;
+	}
+
+	static uint64_t Xxh64MergeRound(uint64_t acc, uint64_t value)
+	{
+		acc ^= Xxh64Round(0, value);
+		return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+	}
+
+	uint64_t Xxh64(const void* data, std::size_t length, uint64_t seed)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		const uint8_t* end = p + length;
+		uint64_t hash;
+		if (length >= 32)
+		{
+			uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+			uint64_t v2 = seed + XXH_PRIME64_2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - XXH_PRIME64_1;
+			do
+			{
+				v1 = Xxh64Round(v1, Read64(p));
+				v2 = Xxh64Round(v2, Read64(p + 8));
+				v3 = Xxh64Round(v3, Read64(p + 16));
+				v4 = Xxh64Round(v4, Read64(p + 24));
+				p += 32;
+			} while (end - p >= 32);
+			hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+			hash = Xxh64MergeRound(hash, v1);
+			hash = Xxh64MergeRound(hash, v2);
+			hash = Xxh64MergeRound(hash, v3);
+			hash = Xxh64MergeRound(hash, v4);
+		}
+		else
+		{
+			hash = seed + XXH_PRIME64_5;
+		}
+		hash += length;
+
+		while (end - p >= 8)
+		{
+			hash ^= Xxh64Round(0, Read64(p));
+			hash = std::rotl(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+			p += 8;
+		}
+		if (end - p >= 4)
+		{
+			hash ^= static_cast<uint64_t>(Read32(p)) * XXH_PRIME64_1;
+			hash = std::rotl(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+			p += 4;
+		}
+		while (p < end)
+		{
+			hash ^= *p * XXH_PRIME64_5;
+			hash = std::rotl(hash, 11) * XXH_PRIME64_1;
+			++p;
+		}
+
+		hash ^= hash >> 33;
+		hash *= XXH_PRIME64_2;
+		hash ^= hash >> 29;
+		hash *= XXH_PRIME64_3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	uint64_t Xxh64Hash(const GameState& state)
+	{
+		uint8_t packed[PACKED_STATE_SIZE];
+		PackState(state, packed);
+		return Xxh64(packed, PACKED_STATE_SIZE, 0);
+	}
+
+}  // namespace BabaSolver
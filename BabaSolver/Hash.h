@@ -0,0 +1,62 @@
+// Hash functions for GameStates.
+//
+// All the hash functions hash the state variables of a GameState (the grid, the Babas, and the
+// turn count) and ignore the move history, so they agree with GameStateEqual. GameStateHash uses
+// the hash function selected at build time with BABA_SOLVER_HASH. The others are kept so that
+// BabaSolverBenchmark --suite=hash can compare them on real game states.
+
+#pragma once
+
+#include <cstdint>
+
+#include "GameState.h"
+
+// The values BABA_SOLVER_HASH can be set to, e.g. "/DBABA_SOLVER_HASH=BABA_SOLVER_HASH_ZOBRIST".
+#define BABA_SOLVER_HASH_LEGACY 1
+#define BABA_SOLVER_HASH_ZOBRIST 2
+#define BABA_SOLVER_HASH_WYHASH 3
+#define BABA_SOLVER_HASH_XXH64 4
+
+// Defaults to wyhash, which had the best speed with no measurable loss in quality of the hash
+// functions in BabaSolverBenchmark --suite=hash.
+#ifndef BABA_SOLVER_HASH
+#define BABA_SOLVER_HASH BABA_SOLVER_HASH_WYHASH
+#endif
+
+namespace BabaSolver
+{
+	enum class HashFunction : uint8_t
+	{
+		LEGACY,
+		ZOBRIST,
+		WYHASH,
+		XXH64,
+	};
+
+	inline constexpr HashFunction ALL_HASH_FUNCTIONS[] = {
+		HashFunction::LEGACY, HashFunction::ZOBRIST, HashFunction::WYHASH, HashFunction::XXH64 };
+
+	// Returns the name of the given hash function, e.g. "wyhash".
+	const char* HashFunctionName(HashFunction hash_function);
+
+	// Hashes the given GameState with the given hash function.
+	uint64_t HashGameState(const GameState& state, HashFunction hash_function);
+
+	// The original hash function: a 32-bit integer mix of each value, combined with the Boost
+	// hash_combine formula.
+	uint64_t LegacyHash(const GameState& state);
+
+	// XORs together a fixed random number for each (cell, GameObject) pair in the grid, each
+	// Baba's location, and the turn count.
+	uint64_t ZobristHash(const GameState& state);
+
+	// wyhash (final version 4) of the packed state variables.
+	uint64_t WyHash(const GameState& state);
+
+	// XXH64 of the packed state variables.
+	uint64_t Xxh64Hash(const GameState& state);
+
+	// XXH64 of an arbitrary buffer. Exposed for testing against the reference test vectors.
+	uint64_t Xxh64(const void* data, std::size_t length, uint64_t seed);
+
+}  // namespace BabaSolver
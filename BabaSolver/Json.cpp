@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "Json.h"
+
+namespace BabaSolver
+{
+	namespace
+	{
+		// A recursive descent JSON parser. Errors are reported through error, and parsing stops at
+		// the first one.
+		class JsonParser
+		{
+		public:
+			JsonParser(const std::string& text, std::string& error) : _text(text), _pos(0), _error(error) {}
+
+			std::optional<JsonValue> ParseDocument()
+			{
+				std::optional<JsonValue> value = ParseValue(0);
+				SkipWhitespace();
+				if (value && _pos != _text.size())
+					return Fail("Unexpected text after the JSON value");
+				return value;
+			}
+
+		private:
+			// Nesting deeper than this is rejected, so that malicious input can't overflow the stack.
+			static constexpr int MAX_DEPTH = 64;
+
+			std::nullopt_t Fail(const std::string& message)
+			{
+				_error = message + " at offset " + std::to_string(_pos);
+				return std::nullopt;
+			}
+
+			void SkipWhitespace()
+			{
+				while (_pos < _text.size() && (_text[_pos] == ' ' || _text[_pos] == '\t' || _text[_pos] == '\n' || _text[_pos] == '\r'))
+					++_pos;
+			}
+
+			bool Consume(const char* literal)
+			{
+				std::string s(literal);
+				if (_text.compare(_pos, s.size(), s) != 0)
+					return false;
+				_pos += s.size();
+				return true;
+			}
+
+			std::optional<JsonValue> ParseValue(int depth)
+			{
+				if (depth > MAX_DEPTH)
+					return Fail("JSON nested too deeply");
+				SkipWhitespace();
+				if (_pos >= _text.size())
+					return Fail("Unexpected end of JSON");
+				JsonValue value;
+				char c = _text[_pos];
+				if (c == '{')
+					return ParseObject(depth);
+				if (c == '[')
+					return ParseArray(depth);
+				if (c == '"')
+				{
+					std::optional<std::string> s = ParseString();
+					if (!s)
+						return std::nullopt;
+					value.type = JsonValue::Type::STRING;
+					value.string = std::move(*s);
+					return value;
+				}
+				if (Consume("true") || Consume("false"))
+				{
+					value.type = JsonValue::Type::BOOLEAN;
+					value.boolean = c == 't';
+					return value;
+				}
+				if (Consume("null"))
+					return value;
+				if (c == '-' || (c >= '0' && c <= '9'))
+					return ParseNumber();
+				return Fail(std::string("Unexpected character '") + c + "'");
+			}
+
+			std::optional<JsonValue> ParseObject(int depth)
+			{
+				JsonValue value;
+				value.type = JsonValue::Type::OBJECT;
+				++_pos;
+				SkipWhitespace();
+				if (_pos < _text.size() && _text[_pos] == '}')
+				{
+					++_pos;
+					return value;
+				}
+				while (true)
+				{
+					SkipWhitespace();
+					if (_pos >= _text.size() || _text[_pos] != '"')
+						return Fail("Expected an object key");
+					std::optional<std::string> key = ParseString();
+					if (!key)
+						return std::nullopt;
+					SkipWhitespace();
+					if (_pos >= _text.size() || _text[_pos] != ':')
+						return Fail("Expected ':'");
+					++_pos;
+					std::optional<JsonValue> element = ParseValue(depth + 1);
+					if (!element)
+						return std::nullopt;
+					value.keys.push_back(std::move(*key));
+					value.elements.push_back(std::move(*element));
+					SkipWhitespace();
+					if (_pos < _text.size() && _text[_pos] == ',')
+					{
+						++_pos;
+						continue;
+					}
+					if (_pos < _text.size() && _text[_pos] == '}')
+					{
+						++_pos;
+						return value;
+					}
+					return Fail("Expected ',' or '}'");
+				}
+			}
+
+			std::optional<JsonValue> ParseArray(int depth)
+			{
+				JsonValue value;
+				value.type = JsonValue::Type::ARRAY;
+				++_pos;
+				SkipWhitespace();
+				if (_pos < _text.size() && _text[_pos] == ']')
+				{
+					++_pos;
+					return value;
+				}
+				while (true)
+				{
+					std::optional<JsonValue> element = ParseValue(depth + 1);
+					if (!element)
+						return std::nullopt;
+					value.elements.push_back(std::move(*element));
+					SkipWhitespace();
+					if (_pos < _text.size() && _text[_pos] == ',')
+					{
+						++_pos;
+						continue;
+					}
+					if (_pos < _text.size() && _text[_pos] == ']')
+					{
+						++_pos;
+						return value;
+					}
+					return Fail("Expected ',' or ']'");
+				}
+			}
+
+			// Parses a number of the JSON grammar: an optional '-', an integer without leading zeros,
+			// then an optional fraction and exponent. Hex, "inf" and "nan" are rejected, unlike
+			// std::strtod(), and the conversion doesn't depend on the locale.
+			std::optional<JsonValue> ParseNumber()
+			{
+				std::size_t start = _pos;
+				auto skip_digits = [this]()
+					{
+						std::size_t digits_start = _pos;
+						while (_pos < _text.size() && _text[_pos] >= '0' && _text[_pos] <= '9')
+							++_pos;
+						return _pos - digits_start;
+					};
+				if (_text[_pos] == '-')
+					++_pos;
+				if (_pos < _text.size() && _text[_pos] == '0')
+					++_pos;
+				else if (skip_digits() == 0)
+					return Fail("Invalid number");
+				if (_pos < _text.size() && _text[_pos] == '.')
+				{
+					++_pos;
+					if (skip_digits() == 0)
+						return Fail("Invalid number");
+				}
+				if (_pos < _text.size() && (_text[_pos] == 'e' || _text[_pos] == 'E'))
+				{
+					++_pos;
+					if (_pos < _text.size() && (_text[_pos] == '+' || _text[_pos] == '-'))
+						++_pos;
+					if (skip_digits() == 0)
+						return Fail("Invalid number");
+				}
+				// The number must end here, e.g. "0x10" and "01" aren't numbers followed by more text.
+				if (_pos < _text.size() && (std::isalnum(static_cast<unsigned char>(_text[_pos])) != 0 || _text[_pos] == '.'))
+					return Fail("Invalid number");
+
+				JsonValue value;
+				value.type = JsonValue::Type::NUMBER;
+				std::from_chars_result result = std::from_chars(_text.data() + start, _text.data() + _pos, value.number);
+				if (result.ec != std::errc() || result.ptr != _text.data() + _pos)
+					return Fail("Invalid number");
+				return value;
+			}
+
+			// Parses a string starting at the opening quote. Escaped code points are written as
+			// UTF-8 (surrogate pairs aren't combined).
+			std::optional<std::string> ParseString()
+			{
+				std::string s;
+				++_pos;
+				while (_pos < _text.size())
+				{
+					char c = _text[_pos++];
+					if (c == '"')
+						return s;
+					if (c != '\\')
+					{
+						s += c;
+						continue;
+					}
+					if (_pos >= _text.size())
+						break;
+					char escaped = _text[_pos++];
+					switch (escaped)
+					{
+					case '"': s += '"'; break;
+					case '\\': s += '\\'; break;
+					case '/': s += '/'; break;
+					case 'b': s += '\b'; break;
+					case 'f': s += '\f'; break;
+					case 'n': s += '\n'; break;
+					case 'r': s += '\r'; break;
+					case 't': s += '\t'; break;
+					case 'u':
+					{
+						if (_pos + 4 > _text.size()
+							|| !std::all_of(_text.begin() + _pos, _text.begin() + _pos + 4, [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; }))
+						{
+							Fail("Invalid \\u escape");
+							return std::nullopt;
+						}
+						uint32_t code_point = static_cast<uint32_t>(std::strtoul(_text.substr(_pos, 4).c_str(), nullptr, 16));
+						_pos += 4;
+						if (code_point < 0x80)
+						{
+							s += static_cast<char>(code_point);
+						}
+						else if (code_point < 0x800)
+						{
+							s += static_cast<char>(0xc0 | (code_point >> 6));
+							s += static_cast<char>(0x80 | (code_point & 0x3f));
+						}
+						else
+						{
+							s += static_cast<char>(0xe0 | (code_point >> 12));
+							s += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+							s += static_cast<char>(0x80 | (code_point & 0x3f));
+						}
+						break;
+					}
+					default:
+						Fail("Invalid escape");
+						return std::nullopt;
+					}
+				}
+				Fail("Unterminated string");
+				return std::nullopt;
+			}
+
+			const std::string& _text;
+			std::size_t _pos;
+			std::string& _error;
+		};
+	}  // namespace
+
+	const JsonValue* JsonValue::Find(const std::string& key) const
+	{
+		if (type != Type::OBJECT)
+			return nullptr;
+		for (std::size_t i = 0; i < keys.size(); ++i)
+		{
+			if (keys[i] == key)
+				return &elements[i];
+		}
+		return nullptr;
+	}
+
+	std::optional<JsonValue> ParseJson(const std::string& text, std::string& error)
+	{
+		return JsonParser(text, error).ParseDocument();
+	}
+
+	std::string JsonString(const std::string& s)
+	{
+		std::string quoted = "\"";
+		for (char c : s)
+		{
+			switch (c)
+			{
+			case '"': quoted += "\\\""; break;
+			case '\\': quoted += "\\\\"; break;
+			case '\n': quoted += "\\n"; break;
+			case '\r': quoted += "\\r"; break;
+			case '\t': quoted += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+					quoted += escaped;
+				}
+				else
+				{
+					quoted += c;
+				}
+			}
+		}
+		return quoted + "\"";
+	}
+
+}  // namespace BabaSolver
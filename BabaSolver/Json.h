@@ -0,0 +1,45 @@
+// A small JSON reader and string escaping, for the solver server's requests and responses (see
+// Server.h).
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace BabaSolver
+{
+	// A parsed JSON value.
+	struct JsonValue
+	{
+		enum class Type
+		{
+			NUL,
+			BOOLEAN,
+			NUMBER,
+			STRING,
+			ARRAY,
+			OBJECT,
+		};
+
+		Type type = Type::NUL;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		// The elements of an array, or the values of an object's members.
+		std::vector<JsonValue> elements;
+		// The keys of an object's members, in the same order as elements.
+		std::vector<std::string> keys;
+
+		// Returns the value of the object member with the given key, or null if this isn't an
+		// object or has no such member.
+		const JsonValue* Find(const std::string& key) const;
+	};
+
+	// Parses text as one JSON value. Returns std::nullopt and sets error if text isn't valid JSON.
+	std::optional<JsonValue> ParseJson(const std::string& text, std::string& error);
+
+	// Returns s as a quoted JSON string, e.g. a"b -> "a\"b".
+	std::string JsonString(const std::string& s);
+
+}  // namespace BabaSolver
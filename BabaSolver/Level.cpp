@@ -0,0 +1,233 @@
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GameState.h"
+
+#include "Level.h"
+
+namespace BabaSolver
+{
+	// The characters of the game objects in the objects layer, except for Babas (which aren't part
+	// of the grid).
+	static constexpr struct
+	{
+		char c;
+		GameObject obj;
+	} OBJECT_CHARS[] = {
+		{ 'X', GameObject::IMMOVABLE },
+		{ 'R', GameObject::ROCK },
+		{ 'D', GameObject::DOOR },
+		{ 'K', GameObject::KEY },
+		{ '1', GameObject::ROCK_TEXT },
+		{ '2', GameObject::IS_TEXT },
+		{ '3', GameObject::PUSH_TEXT },
+	};
+
+	static constexpr char NO_OBJECT_CHAR = '.';
+	// Baba #1 moves before Baba #2, which matters when they push the same game object.
+	static constexpr char BABA1_CHAR = 'B';
+	static constexpr char BABA2_CHAR = 'b';
+	static constexpr char TILE_CHAR = '^';
+	static constexpr char NO_TILE_CHAR = '.';
+
+	static uint16_t Bit(GameObject obj)
+	{
+		return static_cast<uint16_t>(1 << static_cast<uint16_t>(obj));
+	}
+
+	// Reads the next line that isn't a comment or empty into line. Returns false at the end of in.
+	static bool ReadLine(std::istream& in, std::string& line)
+	{
+		while (std::getline(in, line))
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (!line.empty() && line[0] != '#')
+				return true;
+		}
+		return false;
+	}
+
+	// Reads the header line and the GRID_HEIGHT rows of one layer. Returns false and sets error if
+	// they're missing or have the wrong width.
+	static bool ReadLayer(std::istream& in, const std::string& header, std::vector<std::string>& rows, std::string& error)
+	{
+		std::string line;
+		if (!ReadLine(in, line) || line != header)
+		{
+			error = "Expected \"" + header + "\"";
+			return false;
+		}
+		rows.clear();
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			if (!ReadLine(in, line))
+			{
+				error = "Expected " + std::to_string(GRID_HEIGHT) + " rows after \"" + header + "\", got " + std::to_string(i);
+				return false;
+			}
+			if (line.size() != static_cast<std::size_t>(GRID_WIDTH))
+			{
+				error = "Row " + std::to_string(i) + " after \"" + header + "\" has " + std::to_string(line.size())
+					+ " cells instead of " + std::to_string(GRID_WIDTH);
+				return false;
+			}
+			rows.push_back(line);
+		}
+		return true;
+	}
+
+	std::shared_ptr<GameState> ParseLevel(std::istream& in, std::string& error)
+	{
+		std::vector<std::string> tile_rows;
+		std::vector<std::string> object_rows;
+		if (!ReadLayer(in, "tiles:", tile_rows, error) || !ReadLayer(in, "objects:", object_rows, error))
+			return nullptr;
+		std::string line;
+		if (ReadLine(in, line))
+		{
+			error = "Unexpected line after the objects: \"" + line + "\"";
+			return nullptr;
+		}
+
+		uint16_t grid[GRID_HEIGHT][GRID_WIDTH]{};
+		std::vector<Coordinate> baba1s;
+		std::vector<Coordinate> baba2s;
+		int key_count = 0;
+		int is_text_count = 0;
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				std::string cell_name = "(" + std::to_string(i) + ", " + std::to_string(j) + ")";
+				char tile_char = tile_rows[i][j];
+				if (tile_char == TILE_CHAR)
+				{
+					grid[i][j] |= Bit(GameObject::TILE);
+				}
+				else if (tile_char != NO_TILE_CHAR)
+				{
+					error = "Invalid tile '" + std::string(1, tile_char) + "' at " + cell_name;
+					return nullptr;
+				}
+
+				char object_char = object_rows[i][j];
+				if (object_char == NO_OBJECT_CHAR)
+					continue;
+				if (object_char == BABA1_CHAR || object_char == BABA2_CHAR)
+				{
+					(object_char == BABA1_CHAR ? baba1s : baba2s).push_back(Coordinate{ i, j });
+					continue;
+				}
+				bool found = false;
+				for (const auto& object : OBJECT_CHARS)
+				{
+					if (object.c == object_char)
+					{
+						grid[i][j] |= Bit(object.obj);
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+				{
+					error = "Invalid game object '" + std::string(1, object_char) + "' at " + cell_name;
+					return nullptr;
+				}
+				if (object_char == 'D' && (i != DOOR_I || j != DOOR_J))
+				{
+					error = "The door must be at (" + std::to_string(DOOR_I) + ", " + std::to_string(DOOR_J) + "), not " + cell_name;
+					return nullptr;
+				}
+				key_count += object_char == 'K';
+				is_text_count += object_char == '2';
+			}
+		}
+		if (baba1s.size() != 1 || baba2s.size() != 1)
+		{
+			error = "A level must have exactly one Baba #1 ('B') and one Baba #2 ('b'), not " + std::to_string(baba1s.size())
+				+ " and " + std::to_string(baba2s.size());
+			return nullptr;
+		}
+		if ((grid[DOOR_I][DOOR_J] & Bit(GameObject::DOOR)) == 0)
+		{
+			error = "A level must have a door at (" + std::to_string(DOOR_I) + ", " + std::to_string(DOOR_J) + ")";
+			return nullptr;
+		}
+		if (key_count != 1 || is_text_count != 1)
+		{
+			error = "A level must have exactly one key and one \"IS\" text block, not " + std::to_string(key_count)
+				+ " and " + std::to_string(is_text_count);
+			return nullptr;
+		}
+		return std::make_shared<GameState>(grid, baba1s[0], baba2s[0]);
+	}
+
+	bool WriteLevel(const GameState& state, std::ostream& out)
+	{
+		std::vector<std::string> tile_rows(GRID_HEIGHT, std::string(GRID_WIDTH, NO_TILE_CHAR));
+		std::vector<std::string> object_rows(GRID_HEIGHT, std::string(GRID_WIDTH, NO_OBJECT_CHAR));
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				uint16_t cell = state._grid[i][j];
+				if ((cell & Bit(GameObject::TILE)) != 0)
+					tile_rows[i][j] = TILE_CHAR;
+				for (const auto& object : OBJECT_CHARS)
+				{
+					if ((cell & Bit(object.obj)) == 0)
+						continue;
+					if (object_rows[i][j] != NO_OBJECT_CHAR)
+						return false;
+					object_rows[i][j] = object.c;
+				}
+			}
+		}
+		for (auto [baba, baba_char] : { std::make_pair(state._baba1, BABA1_CHAR), std::make_pair(state._baba2, BABA2_CHAR) })
+		{
+			// A level needs two living Babas.
+			if (baba.i < 0 || object_rows[baba.i][baba.j] != NO_OBJECT_CHAR)
+				return false;
+			object_rows[baba.i][baba.j] = baba_char;
+		}
+
+		out << "tiles:\n";
+		for (const std::string& row : tile_rows)
+		{
+			out << row << '\n';
+		}
+		out << "objects:\n";
+		for (const std::string& row : object_rows)
+		{
+			out << row << '\n';
+		}
+		return true;
+	}
+
+	std::shared_ptr<GameState> LoadLevel(const std::string& name_or_path, std::string& error)
+	{
+		if (name_or_path == "floatiest")
+			return FloatiestPlatformsLevel();
+		if (name_or_path == "test")
+			return TestLevel();
+		std::ifstream file(name_or_path);
+		if (!file)
+		{
+			error = "Unable to open level file: " + name_or_path;
+			return nullptr;
+		}
+		std::shared_ptr<GameState> level = ParseLevel(file, error);
+		if (!level)
+			error = name_or_path + ": " + error;
+		return level;
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,51 @@
+// Code for reading and writing levels as text, so that levels other than the built-in ones can be
+// solved.
+//
+// A level file has two 18x18 layers: the tiles (the platforms), and the game objects on top of
+// them. Lines starting with '#' are comments. For example:
+//
+//   # The Floatiest Platforms
+//   tiles:
+//   ..................
+//   ..................
+//   ..................
+//   ..^^^^^...^^^^^...
+//   ... (18 lines in total)
+//   objects:
+//   XXX....XXX........
+//   ... (18 lines in total)
+//
+// Tiles: '^' is a tile and '.' is no tile.
+// Objects: '.' is nothing, 'B' and 'b' are Baba #1 and Baba #2 (Baba #1 moves first), 'X' is an
+// immovable object, 'R' is a rock, 'D' is the door, 'K' is the key, and '1', '2' and '3' are the
+// "ROCK", "IS" and "PUSH" text blocks.
+//
+// The game engine was written for The Floatiest Platforms, so a level must have both Babas, the
+// door must be at (DOOR_I, DOOR_J), and there must be exactly one key and one "IS" text block.
+// The pruning and scoring heuristics also assume the layout of The Floatiest Platforms, so they
+// may miss solutions of levels that are laid out differently.
+
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// Reads a level from in. Returns null and sets error if the level is invalid.
+	std::shared_ptr<GameState> ParseLevel(std::istream& in, std::string& error);
+
+	// Writes state's grid and Babas to out in the format that ParseLevel() reads. Returns false
+	// (and writes nothing) if a cell has more than one game object besides its tile, which the
+	// format can't represent (e.g. a Baba standing on a rock), or if a Baba is dead.
+	bool WriteLevel(const GameState& state, std::ostream& out);
+
+	// Loads a built-in level by name ("floatiest" or "test") or a level file by path. Returns null
+	// and sets error if the level can't be loaded.
+	std::shared_ptr<GameState> LoadLevel(const std::string& name_or_path, std::string& error);
+
+}  // namespace BabaSolver
@@ -1,4 +1,5 @@
-// BabaSolver solves the level "The Floatiest Platforms" in the game Baba Is You.
+// BabaSolver solves the level "The Floatiest Platforms" in the game Baba Is You, or other levels
+// loaded from level files (see Level.h).
 //
 // The algorithm is a brute force algorithm, calculating all the moves you can make and printing out
 // the first one that succeeds in beating the level. Various optimizations and heuristics prune the
@@ -9,11 +10,30 @@
 // * Tune the flag parameters based on your computer's hardware (CPU speed, number of cores/threads,
 //   amount of memory). Some flags trade CPU for more memory usage and vice versa.
 
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "Batch.h"
+#include "Bidirectional.h"
+#include "Estimate.h"
+#include "GameState.h"
+#include "Level.h"
+#include "Perft.h"
+#include "Planner.h"
+#include "Server.h"
+#include "Shorten.h"
 #include "Solver.h"
+#include "Tuner.h"
 
 static void PrintHelp()
 {
@@ -28,12 +48,231 @@ Flags:
   --max_turn_depth       The max depth in the move tree the algorithm will go in one iteration. The number of moves calculated grows exponentially with this value.
   --parallelism_depth    The depth in the move tree at which the algorithm switches from single-threaded to multi-threaded. A higher value means higher parallelism (up to the limits of the computer's CPU), which generally leads to a faster time to complete at the expense of more CPU and memory usage.
   --max_cache_depth      The max depth in the move tree at which to cache game states. A higher value trades CPU usage for memory usage.
+  --max_cache_mb         The max estimated size (in megabytes) of the caches of game states. 0 (the default) means no limit.
+  --thread_count         How many worker threads to use for the multi-threaded portion of the algorithm. 0 (the default) means one thread per hardware thread.
   --print_every_n_moves  How often (in number of moves) to print a debug log to stdout.
+  --estimate_probe_count How many random probes to use to estimate the size of the move tree before each iteration. The estimate is used to print an ETA. 0 disables the estimate.
+  --trace_file           If set, writes a timeline of what each thread was doing to this file in the Chrome trace event format. Open it in chrome://tracing or https://ui.perfetto.dev.
+  --solution_cache       If set, results are saved to this file, and a level that was already solved is answered by replaying its saved moves instead of searching. A winning result is used with any options; other results only with the same options.
+  --transposition_file   If set, game states that can't lead to a win are recorded in a memory-mapped table in this file, which is kept between runs, so a later run (e.g. with a higher --max_turn_depth) skips what earlier runs searched. The table may be larger than RAM.
+  --transposition_mb     The size (in megabytes) of the --transposition_file table if the file doesn't exist yet. Defaults to 1024.
+  --anytime              Keeps searching after a win for shorter wins, printing each shorter win and better leaf game state as soon as it's found, and stops after the given number of seconds with the best result so far.
+  --time_limit           The max number of seconds of the whole search. Each iteration gets an equal share of the time that's left, and searches less deep if the tree size estimate says it won't fit. At the limit, the search stops with the best result so far. 0 (the default) means no limit.
+  --memory_limit         The max memory (in megabytes) of the process. Near the limit the caches stop growing, and at the limit the search stops with the best result so far instead of running out of memory. 0 (the default) means no limit.
+  --max_endgame_tables   If above 0, once the Babas are on the same space, the moves that push the key onto the door are looked up in a table computed for the positions of the other game objects (see Endgame.h) instead of being searched. Each table takes about 600 KB and is computed the first time the search needs it; at most this many are computed. 0 (the default) disables the tablebase. Turns off --transposition_file, whose entries don't count the wins from the tablebase.
+  --shorten_depth        After a win, searches for shortcuts of up to this many moves between the game states of the solution and prints the shortened solution. 0 disables shortening. Defaults to 8.
+  --plan                 Instead of solving the level with the solver, reaches the milestones of the level's plan one at a time with breadth-first searches of up to the given number of moves each, backtracking to other ways of reaching a milestone when the next one can't be reached (see Planner.h). The Floatiest Platforms has six milestones; other levels only have the win.
+  --bidirectional        Instead of solving the level with the solver, searches for the shortest moves of up to the given number to the game state of --goal_level or --goal_moves, forward from the level and backward from the goal at the same time (see Bidirectional.h). Each direction only goes about half as deep.
+  --goal_level           The goal game state of --bidirectional, as a level file (see Level.h for the format), e.g. the level's end phase with every game object in a known position.
+  --goal_moves           The goal game state of --bidirectional, as moves from the level, e.g. a long solution minus its last move, to find the shortest way to the end of it.
+  --perft                Instead of solving the level, counts the game states at each depth of the move tree up to the given depth, with and without removing duplicate game states. Useful for validating and benchmarking changes to the game engine.
+  --suggest_depths       Instead of solving the level, estimates the size of the move tree and suggests a max_turn_depth and parallelism_depth that fit in the given number of seconds.
+  --autotune             Before solving the level, runs short calibration searches and picks the max_turn_depth, parallelism_depth and max_cache_depth that search the deepest in the given number of seconds (for all iterations).
+  --autotune_memory_mb   The memory budget (in megabytes) of the caches for --autotune. 0 (the default) means no limit.
+  --from_moves           Moves to replay before searching, e.g. "LLLLD". The search starts from the game state after them, so a promising partial solution can be continued without searching it again (a --transposition_file is reused as usual). The printed solution includes these moves, so they must not go on after a win.
+  --level                The level to solve: "floatiest" (the default), "test", or the path to a level file (see Level.h for the format).
+  --batch                Instead of solving one level, solves the levels listed in this file. Each line has a level (like --level) and optionally a time budget in seconds, e.g. "levels/floatiest_platforms.txt 60". The levels share one pool of --thread_count threads, and each result is printed as soon as its level is finished.
+  --batch_concurrent_levels How many levels of --batch to search at the same time. 0 (the default) means 2.
+  --serve                Instead of solving a level, runs a server that takes solve requests as JSON lines on a Unix domain socket at this path (see Server.h for the protocol). The searches share one pool of --thread_count threads, and the other flags are the defaults of each search.
   --help                 Prints this help message.
 )";
 	std::cout << help << std::endl;
 }
 
+// Runs perft on the level and prints the results.
+static void RunPerft(const std::shared_ptr<BabaSolver::GameState>& level, int max_depth, unsigned int thread_count)
+{
+	for (bool dedup : { false, true })
+	{
+		BabaSolver::PerftResult result = BabaSolver::Perft(level, max_depth, dedup, thread_count);
+		std::cout << "Perft " << (dedup ? "with" : "without") << " dedup:\n";
+		std::cout << "  Depth           Nodes        Wins       No-op   Dead Baba\n";
+		for (int depth = 1; depth <= max_depth; ++depth)
+		{
+			const BabaSolver::PerftDepthCounts& counts = result.depths[depth];
+			std::cout << "  " << std::setw(5) << depth << std::setw(16) << counts.nodes << std::setw(12) << counts.wins
+				<< std::setw(12) << counts.noop_moves << std::setw(12) << counts.dead_baba << "\n";
+		}
+		uint64_t total_nodes = result.TotalNodes();
+		auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(result.duration).count();
+		std::cout << "  Total nodes: " << total_nodes << "\n";
+		std::cout << "  Total time: " << duration_ms << " milliseconds\n";
+		std::cout << "  Time per node: " << (result.duration.count() / total_nodes) << " nanoseconds\n";
+		std::cout << std::endl;
+	}
+}
+
+// Estimates the size of the level's move tree and prints the depths that fit in the time budget.
+static void RunSuggestDepths(const std::shared_ptr<BabaSolver::GameState>& level, const BabaSolver::SolverOptions& options,
+	int64_t time_budget_seconds)
+{
+	unsigned int worker_count = options.thread_count != 0 ? options.thread_count : std::thread::hardware_concurrency();
+	BabaSolver::TreeSizeEstimate estimate = BabaSolver::EstimateTreeSize(level, options, BabaSolver::MAX_TURN_COUNT);
+	std::cout << "Estimated move tree (exact down to depth " << estimate.exact_depth << ", "
+		<< std::fixed << std::setprecision(0) << estimate.nanoseconds_per_node << " nanoseconds per move, " << worker_count << " threads):\n";
+	std::cout << "  Depth     Moves at depth        Total moves     Time (s)\n";
+	for (int depth = 1; depth <= estimate.max_depth; ++depth)
+	{
+		double seconds = std::chrono::duration<double>(estimate.EstimatedDuration(depth, worker_count)).count();
+		std::cout << "  " << std::setw(5) << depth << std::setw(19) << estimate.nodes_generated[depth] << std::setw(19)
+			<< estimate.TotalNodes(depth) << std::setw(13) << std::setprecision(1) << seconds << std::setprecision(0) << "\n";
+	}
+	BabaSolver::DepthSuggestion suggestion = BabaSolver::SuggestDepths(estimate, std::chrono::seconds(time_budget_seconds), worker_count);
+	std::cout << "Suggested flags for a " << time_budget_seconds << " second budget: --max_turn_depth=" << suggestion.max_turn_depth
+		<< " --parallelism_depth=" << suggestion.parallelism_depth << " (~" << suggestion.estimated_nodes << " moves, ~"
+		<< std::setprecision(1) << std::chrono::duration<double>(suggestion.estimated_duration).count() << " seconds per iteration)"
+		<< std::defaultfloat << std::endl;
+}
+
+// Tunes options for the level and prints the calibration searches and the picked options.
+static void RunAutotune(const std::shared_ptr<BabaSolver::GameState>& level, BabaSolver::SolverOptions& options,
+	int64_t time_budget_seconds, uint64_t memory_budget_mb)
+{
+	std::cout << "Auto-tuning for " << time_budget_seconds << " seconds"
+		<< (memory_budget_mb == 0 ? std::string() : " and " + std::to_string(memory_budget_mb) + " MB of cache") << "..." << std::endl;
+	BabaSolver::TuningResult result = BabaSolver::TuneOptions(
+		level, options, std::chrono::seconds(time_budget_seconds), memory_budget_mb * 1024 * 1024);
+	std::cout << "Calibration searches:\n";
+	std::cout << "  Depth  Cache depth        Moves    Estimated    Time (ms)  Cache hits  Largest cache (MB)\n";
+	for (const BabaSolver::CalibrationResult& calibration : result.calibrations)
+	{
+		std::cout << "  " << std::setw(5) << calibration.max_turn_depth << std::setw(13) << calibration.max_cache_depth << std::setw(13) << calibration.nodes_generated
+			<< std::fixed << std::setprecision(0) << std::setw(13) << calibration.estimated_nodes << std::setw(13)
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(calibration.duration).count() << std::setw(11)
+			<< std::setprecision(1) << 100 * calibration.cache_hit_rate << "%" << std::setw(20)
+			<< calibration.max_local_cache_bytes / (1024.0 * 1024.0) << std::defaultfloat << "\n";
+	}
+	options = result.options;
+	std::cout << (result.won ? "A calibration search won. " : "") << "Tuned options: --max_turn_depth=" << options.max_turn_depth
+		<< " --parallelism_depth=" << options.parallelism_depth << " --max_cache_depth=" << options.max_cache_depth
+		<< " (~" << std::fixed << std::setprecision(0) << result.estimated_nodes << " moves, ~" << std::setprecision(1)
+		<< std::chrono::duration<double>(result.estimated_duration).count() << " seconds and ~"
+		<< result.estimated_memory_bytes / (1024.0 * 1024.0) << " MB of cache per iteration)" << std::defaultfloat << std::endl;
+}
+
+// Solves the levels listed in batch_path (see --batch) with the given options and prints each
+// result as soon as its level is finished. Returns false if the list or a level can't be loaded.
+static bool RunBatch(const std::string& batch_path, const BabaSolver::SolverOptions& options, unsigned int concurrent_level_count)
+{
+	std::ifstream batch_file(batch_path);
+	if (!batch_file)
+	{
+		std::cout << "Unable to open batch file: " << batch_path << std::endl;
+		return false;
+	}
+	std::vector<BabaSolver::BatchLevel> levels;
+	std::string line;
+	while (std::getline(batch_file, line))
+	{
+		std::istringstream line_stream(line);
+		std::string level_name;
+		if (!(line_stream >> level_name) || level_name[0] == '#')
+			continue;
+		BabaSolver::BatchLevel level;
+		level.name = level_name;
+		level.options = options;
+		double time_budget_seconds = 0.0;
+		if (line_stream >> time_budget_seconds)
+			level.time_budget = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(time_budget_seconds));
+		std::string error;
+		level.initial_state = BabaSolver::LoadLevel(level_name, error);
+		if (!level.initial_state)
+		{
+			std::cout << error << std::endl;
+			return false;
+		}
+		levels.push_back(level);
+	}
+
+	BabaSolver::BatchOptions batch_options;
+	batch_options.thread_count = options.thread_count;
+	batch_options.concurrent_level_count = concurrent_level_count;
+	std::size_t finished_count = 0;
+	std::size_t won_count = 0;
+	auto start_time = std::chrono::steady_clock::now();
+	BabaSolver::SolveBatch(levels, batch_options, [&finished_count, &won_count, &levels](const BabaSolver::BatchResult& result)
+		{
+			++finished_count;
+			won_count += result.won;
+			std::cout << "[" << finished_count << "/" << levels.size() << "] " << result.name << ": "
+				<< (result.won ? "WIN" : result.timed_out ? "timed out" : "did not win") << " in " << std::fixed << std::setprecision(1)
+				<< std::chrono::duration<double>(result.duration).count() << std::defaultfloat << " seconds, "
+				<< result.stats.Totals().nodes_generated << " moves simulated, " << result.moves.size() << " moves: " << result.moves << std::endl;
+		});
+	std::cout << "Won " << won_count << " of " << levels.size() << " levels in " << std::fixed << std::setprecision(1)
+		<< std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() << std::defaultfloat << " seconds" << std::endl;
+	return true;
+}
+
+// Shortens a solution of the level and prints the result.
+static void RunShorten(const std::shared_ptr<BabaSolver::GameState>& level, const std::vector<BabaSolver::Direction>& solution,
+	const BabaSolver::ShortenOptions& options)
+{
+	BabaSolver::ShortenStats stats;
+	std::vector<BabaSolver::Direction> shortened = BabaSolver::ShortenSolution(level, solution, options, &stats);
+	std::cout << "Shortened solution (" << shortened.size() << " moves): " << BabaSolver::FormatMoves(shortened) << "\n";
+	std::cout << "  " << stats.shortcuts << " shortcuts in " << stats.passes << " passes, " << stats.states_searched
+		<< " game states searched, " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration).count() << " ms" << std::endl;
+}
+
+// Plans the milestones from start_state (the level after move_prefix) and prints the plan, and the
+// shortened plan if it wins.
+static void RunPlan(const std::shared_ptr<BabaSolver::GameState>& level, const std::vector<BabaSolver::Direction>& move_prefix,
+	const std::shared_ptr<BabaSolver::GameState>& start_state, const std::vector<BabaSolver::Milestone>& milestones, int max_stage_moves,
+	const BabaSolver::ShortenOptions& shorten_options)
+{
+	BabaSolver::PlannerOptions options;
+	options.max_stage_moves = max_stage_moves;
+	BabaSolver::PlanResult result = BabaSolver::PlanMilestones(start_state, milestones, options);
+	std::cout << "Milestones:\n";
+	for (std::size_t i = 0; i < milestones.size(); ++i)
+	{
+		std::cout << "  " << std::left << std::setw(42) << milestones[i].name << std::right;
+		if (i < result.stage_moves.size())
+			std::cout << result.stage_moves[i] << " moves\n";
+		else
+			std::cout << (result.completed ? "skipped (the level was won)" : "not reached") << "\n";
+	}
+	std::cout << "  " << result.stats.stage_searches << " stage searches, " << result.stats.backtracks << " backtracks, "
+		<< result.stats.states_searched << " game states searched, "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(result.stats.duration).count() << " ms" << std::endl;
+	std::vector<BabaSolver::Direction> solution = move_prefix;
+	solution.insert(solution.end(), result.moves.begin(), result.moves.end());
+	if (!result.completed)
+	{
+		std::cout << "Did not win. Moves to the last milestone reached (" << solution.size() << " moves): "
+			<< BabaSolver::FormatMoves(solution) << std::endl;
+		return;
+	}
+	std::cout << "Solution (" << solution.size() << " moves): " << BabaSolver::FormatMoves(solution) << std::endl;
+	if (shorten_options.max_shortcut_moves > 0)
+		RunShorten(level, solution, shorten_options);
+}
+
+// Searches from start_state (the level after move_prefix) to goal from both ends and prints the
+// moves.
+static void RunBidirectional(const std::vector<BabaSolver::Direction>& move_prefix, const std::shared_ptr<BabaSolver::GameState>& start_state,
+	const std::shared_ptr<BabaSolver::GameState>& goal, int max_moves)
+{
+	BabaSolver::BidirectionalOptions options;
+	options.max_moves = max_moves;
+	BabaSolver::BidirectionalResult result = BabaSolver::SearchBidirectional(start_state, { goal }, options);
+	const BabaSolver::BidirectionalStats& stats = result.stats;
+	std::cout << "Forward search: " << stats.forward_states << " game states, " << stats.forward_depth << " moves deep\n";
+	std::cout << "Backward search: " << stats.backward_states << " game states, " << stats.backward_depth << " moves deep\n";
+	std::cout << "  " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration).count() << " ms"
+		<< (stats.reached_state_limit ? ", stopped at the game state limit" : "") << std::endl;
+	if (!result.found)
+	{
+		std::cout << "Did not reach the goal in " << max_moves << " moves" << std::endl;
+		return;
+	}
+	std::vector<BabaSolver::Direction> moves = move_prefix;
+	moves.insert(moves.end(), result.moves.begin(), result.moves.end());
+	std::cout << (goal->HaveWon() ? "Solution (" : "Moves to the goal (") << moves.size() << " moves): "
+		<< BabaSolver::FormatMoves(moves) << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
 	std::cout << "Baba Is You solver" << std::endl;
@@ -44,7 +283,47 @@ int main(int argc, char* argv[])
 	std::regex max_turn_depth_regex("--max_turn_depth=(\\d+)");
 	std::regex parallelism_depth_regex("--parallelism_depth=(\\d+)");
 	std::regex max_cache_depth_regex("--max_cache_depth=(\\d+)");
+	std::regex thread_count_regex("--thread_count=(\\d+)");
 	std::regex print_every_n_moves_regex("--print_every_n_moves=(\\d+)");
+	std::regex max_cache_mb_regex("--max_cache_mb=(\\d+)");
+	std::regex estimate_probe_count_regex("--estimate_probe_count=(\\d+)");
+	std::regex suggest_depths_regex("--suggest_depths=(\\d+)");
+	std::regex autotune_regex("--autotune=(\\d+)");
+	std::regex autotune_memory_mb_regex("--autotune_memory_mb=(\\d+)");
+	std::regex trace_file_regex("--trace_file=(.+)");
+	std::regex solution_cache_regex("--solution_cache=(.+)");
+	std::regex transposition_file_regex("--transposition_file=(.+)");
+	std::regex transposition_mb_regex("--transposition_mb=(\\d+)");
+	std::regex anytime_regex("--anytime=(\\d+)");
+	std::regex time_limit_regex("--time_limit=(\\d+)");
+	std::regex memory_limit_regex("--memory_limit=(\\d+)");
+	std::regex max_endgame_tables_regex("--max_endgame_tables=(\\d+)");
+	std::regex shorten_depth_regex("--shorten_depth=(\\d+)");
+	std::regex perft_regex("--perft=(\\d+)");
+	std::regex plan_regex("--plan=(\\d+)");
+	std::regex bidirectional_regex("--bidirectional=(\\d+)");
+	std::regex goal_level_regex("--goal_level=(.+)");
+	std::regex goal_moves_regex("--goal_moves=(.+)");
+	std::regex level_regex("--level=(.+)");
+	std::regex from_moves_regex("--from_moves=(.+)");
+	std::regex batch_regex("--batch=(.+)");
+	std::regex batch_concurrent_levels_regex("--batch_concurrent_levels=(\\d+)");
+	std::regex serve_regex("--serve=(.+)");
+	int perft_depth = 0;
+	int plan_stage_moves = 0;
+	int bidirectional_max_moves = 0;
+	std::string goal_level_name;
+	std::optional<std::vector<BabaSolver::Direction>> goal_moves;
+	int64_t anytime_seconds = 0;
+	BabaSolver::ShortenOptions shorten_options;
+	std::string level_name = "floatiest";
+	std::vector<BabaSolver::Direction> from_moves;
+	std::string batch_path;
+	unsigned int batch_concurrent_levels = 0;
+	std::string socket_path;
+	int64_t suggest_depths_seconds = 0;
+	int64_t autotune_seconds = 0;
+	uint64_t autotune_memory_mb = 0;
 	for (int i = 1; i < argc; ++i)
 	{
 		std::string flag_str(argv[i]);
@@ -74,17 +353,274 @@ int main(int argc, char* argv[])
 			options.max_cache_depth = std::stoi(matches[1]);
 			continue;
 		}
+		if (std::regex_match(flag_str, matches, thread_count_regex))
+		{
+			options.thread_count = std::stoi(matches[1]);
+			continue;
+		}
 		if (std::regex_match(flag_str, matches, print_every_n_moves_regex))
 		{
 			options.print_every_n_moves = std::stoi(matches[1]);
 			continue;
 		}
+		if (std::regex_match(flag_str, matches, max_cache_mb_regex))
+		{
+			options.max_cache_bytes = std::stoull(matches[1]) * 1024 * 1024;
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, estimate_probe_count_regex))
+		{
+			options.estimate_probe_count = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, suggest_depths_regex))
+		{
+			suggest_depths_seconds = std::stoll(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, autotune_regex))
+		{
+			autotune_seconds = std::stoll(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, autotune_memory_mb_regex))
+		{
+			autotune_memory_mb = std::stoull(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, trace_file_regex))
+		{
+			options.trace_file = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, solution_cache_regex))
+		{
+			options.solution_cache_file = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, transposition_file_regex))
+		{
+			options.transposition_file = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, transposition_mb_regex))
+		{
+			options.transposition_table_bytes = std::stoull(matches[1]) * 1024 * 1024;
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, anytime_regex))
+		{
+			anytime_seconds = std::stoll(matches[1]);
+			options.anytime = anytime_seconds > 0;
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, time_limit_regex))
+		{
+			options.time_limit = std::chrono::seconds(std::stoll(matches[1]));
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, memory_limit_regex))
+		{
+			options.memory_limit_bytes = std::stoull(matches[1]) * 1024 * 1024;
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, max_endgame_tables_regex))
+		{
+			options.max_endgame_tables = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, shorten_depth_regex))
+		{
+			shorten_options.max_shortcut_moves = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, perft_regex))
+		{
+			perft_depth = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, plan_regex))
+		{
+			plan_stage_moves = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, bidirectional_regex))
+		{
+			bidirectional_max_moves = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, goal_level_regex))
+		{
+			goal_level_name = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, goal_moves_regex))
+		{
+			goal_moves = BabaSolver::ParseMoves(matches[1]);
+			if (!goal_moves)
+			{
+				std::cout << "Invalid --goal_moves: " << matches[1] << std::endl;
+				return 1;
+			}
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, level_regex))
+		{
+			level_name = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, from_moves_regex))
+		{
+			std::optional<std::vector<BabaSolver::Direction>> moves = BabaSolver::ParseMoves(matches[1]);
+			if (!moves)
+			{
+				std::cout << "Invalid --from_moves: " << matches[1] << std::endl;
+				return 1;
+			}
+			from_moves = *moves;
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, batch_regex))
+		{
+			batch_path = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, batch_concurrent_levels_regex))
+		{
+			batch_concurrent_levels = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, serve_regex))
+		{
+			socket_path = matches[1];
+			continue;
+		}
 		std::cout << "Invalid argument: " << flag_str << std::endl;
 		PrintHelp();
 		return 1;
 	}
 
-	// Run solver.
-	BabaSolver::SolveFloatiestPlatforms(options);
+	if (!socket_path.empty())
+	{
+		BabaSolver::ServerOptions server_options;
+		server_options.thread_count = options.thread_count;
+		server_options.solver_options = options;
+		BabaSolver::Server server(server_options);
+		std::string error;
+		if (!server.Start(socket_path, error))
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		std::cout << "Listening on " << socket_path << std::endl;
+		server.Wait();
+		return 0;
+	}
+
+	if (!batch_path.empty())
+		return RunBatch(batch_path, options, batch_concurrent_levels) ? 0 : 1;
+
+	std::string level_error;
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::LoadLevel(level_name, level_error);
+	if (!level)
+	{
+		std::cout << level_error << std::endl;
+		return 1;
+	}
+
+	// Searches start from the game state after --from_moves, while the solution and its shortened
+	// version are relative to the level.
+	std::shared_ptr<BabaSolver::GameState> start_state = level;
+	if (!from_moves.empty())
+	{
+		std::string prefix_error;
+		start_state = BabaSolver::ReplayPrefix(level, from_moves, prefix_error);
+		if (!start_state)
+		{
+			std::cout << prefix_error << std::endl;
+			return 1;
+		}
+		std::cout << "Starting from the game state after " << from_moves.size() << " moves:" << std::endl;
+		start_state->PrintGrid(std::cout);
+	}
+
+	if (perft_depth > 0)
+	{
+		if (perft_depth > BabaSolver::MAX_TURN_COUNT)
+		{
+			std::cout << "--perft must be at most MAX_TURN_COUNT (" << BabaSolver::MAX_TURN_COUNT << ")" << std::endl;
+			return 1;
+		}
+		RunPerft(start_state, perft_depth, options.thread_count);
+		return 0;
+	}
+
+	if (plan_stage_moves > 0)
+	{
+		std::vector<BabaSolver::Milestone> milestones =
+			level_name == "floatiest" ? BabaSolver::FloatiestPlatformsMilestones() : BabaSolver::WinMilestones();
+		RunPlan(level, from_moves, start_state, milestones, plan_stage_moves, shorten_options);
+		return 0;
+	}
+
+	if (bidirectional_max_moves > 0)
+	{
+		if (goal_level_name.empty() == !goal_moves)
+		{
+			std::cout << "--bidirectional needs either a --goal_level or --goal_moves" << std::endl;
+			return 1;
+		}
+		std::shared_ptr<BabaSolver::GameState> goal = goal_moves ? BabaSolver::ReplayMoves(level, *goal_moves)
+			: BabaSolver::LoadLevel(goal_level_name, level_error);
+		if (!goal)
+		{
+			std::cout << level_error << std::endl;
+			return 1;
+		}
+		RunBidirectional(from_moves, start_state, goal, bidirectional_max_moves);
+		return 0;
+	}
+
+	if (suggest_depths_seconds > 0)
+	{
+		RunSuggestDepths(start_state, options, suggest_depths_seconds);
+		return 0;
+	}
+
+	if (autotune_seconds > 0)
+		RunAutotune(start_state, options, autotune_seconds, autotune_memory_mb);
+
+	// Run solver. Each iteration starts from the result of the last one, so the solution is the
+	// moves of all the iterations.
+	BabaSolver::Solver solver(start_state, options);
+	solver.SetLog(&std::cout);
+	std::vector<BabaSolver::Direction> solution = from_moves;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_iteration_finished = [&solution](int, const std::shared_ptr<BabaSolver::GameState>& state)
+		{
+			solution.insert(solution.end(), state->_moves, state->_moves + state->_turn);
+		};
+	solver.SetCallbacks(callbacks);
+	solver.Start();
+	if (anytime_seconds > 0 && !solver.WaitFor(std::chrono::seconds(anytime_seconds)))
+	{
+		std::cout << "Reached the --anytime deadline, stopping with the best result so far" << std::endl;
+		solver.Cancel();
+	}
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Wait();
+	BabaSolver::SolverStats stats = solver.Stats();
+	if (stats.reduced_depth_iterations > 0)
+	{
+		std::cout << stats.reduced_depth_iterations << " of " << stats.iteration_count << " iterations searched less deep to fit in --time_limit (down to a depth of "
+			<< stats.min_reduced_turn_depth << ")" << std::endl;
+	}
+	if (stats.memory.caches_frozen)
+		std::cout << "The caches stopped growing near --memory_limit, so " << stats.memory.uncached_states << " game states weren't cached" << std::endl;
+	if (end_state && end_state->HaveWon())
+	{
+		std::cout << "Solution (" << solution.size() << " moves): " << BabaSolver::FormatMoves(solution) << std::endl;
+		if (shorten_options.max_shortcut_moves > 0)
+			RunShorten(level, solution, shorten_options);
+	}
 	return 0;
 }
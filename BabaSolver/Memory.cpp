@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Memory.h"
+
+namespace BabaSolver
+{
+#ifdef _WIN32
+
+	uint64_t GetPeakRssBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.PeakWorkingSetSize;
+	}
+
+	uint64_t GetCurrentRssBytes()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.WorkingSetSize;
+	}
+
+	bool ResetPeakRss()
+	{
+		return false;
+	}
+
+#else
+
+	uint64_t GetPeakRssBytes()
+	{
+		// The "VmHWM" ("high water mark") line of /proc/self/status holds the peak resident set
+		// size in kB.
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line))
+		{
+			if (line.rfind("VmHWM:", 0) == 0)
+				return std::stoull(line.substr(6)) * 1024;
+		}
+		return 0;
+	}
+
+	uint64_t GetCurrentRssBytes()
+	{
+		// The second field of /proc/self/statm is the resident set size in pages. It's shorter to
+		// parse than /proc/self/status.
+		std::ifstream statm("/proc/self/statm");
+		uint64_t size_pages = 0;
+		uint64_t resident_pages = 0;
+		if (!(statm >> size_pages >> resident_pages))
+			return 0;
+		return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+
+	bool ResetPeakRss()
+	{
+		// Writing "5" to /proc/self/clear_refs resets VmHWM (Linux 4.0+).
+		std::ofstream clear_refs("/proc/self/clear_refs");
+		clear_refs << "5";
+		clear_refs.flush();
+		return static_cast<bool>(clear_refs);
+	}
+
+#endif
+
+}  // namespace BabaSolver
@@ -0,0 +1,22 @@
+// Code for measuring the memory usage of the process.
+
+#pragma once
+
+#include <cstdint>
+
+namespace BabaSolver
+{
+	// Returns the peak resident set size (i.e. the max amount of physical memory used) of this
+	// process in bytes, or 0 if it can't be determined.
+	uint64_t GetPeakRssBytes();
+
+	// Returns the current resident set size of this process in bytes, or 0 if it can't be
+	// determined. Cheap enough to call many times a second.
+	uint64_t GetCurrentRssBytes();
+
+	// Resets the peak resident set size of this process to the current resident set size, so that
+	// GetPeakRssBytes() only measures what happens afterwards. Returns false if the operating
+	// system doesn't support this (e.g. on Windows).
+	bool ResetPeakRss();
+
+}  // namespace BabaSolver
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "GameState.h"
+
+#include "Perft.h"
+
+namespace BabaSolver
+{
+	// The depth at which the perft without dedup splits the move tree into subtrees for the worker
+	// threads. 4^3 = 64 subtrees is enough to keep all the threads of a typical computer busy.
+	static constexpr int PERFT_SPLIT_DEPTH = 3;
+
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	uint64_t PerftResult::TotalNodes() const
+	{
+		uint64_t total = 0;
+		for (std::size_t depth = 1; depth < depths.size(); ++depth)
+		{
+			total += depths[depth].nodes;
+		}
+		return total;
+	}
+
+	// Adds new_state to counts. This does not count no-op moves.
+	static void CountState(const GameState& new_state, PerftDepthCounts& counts)
+	{
+		++counts.nodes;
+		if (new_state.HaveWon())
+			++counts.wins;
+		if (new_state.CheckWhyImpossibleToWin() == LossReason::DEAD_BABA)
+			++counts.dead_baba;
+	}
+
+	// Adds new_state (created by applying a move to parent_state) to counts.
+	static void CountMove(const GameState& parent_state, const GameState& new_state, PerftDepthCounts& counts)
+	{
+		CountState(new_state, counts);
+		if (IsNoOpMove(parent_state, new_state))
+			++counts.noop_moves;
+	}
+
+	static void AddCounts(const std::vector<PerftDepthCounts>& from, std::vector<PerftDepthCounts>& to)
+	{
+		for (std::size_t depth = 0; depth < from.size(); ++depth)
+		{
+			to[depth].nodes += from[depth].nodes;
+			to[depth].wins += from[depth].wins;
+			to[depth].noop_moves += from[depth].noop_moves;
+			to[depth].dead_baba += from[depth].dead_baba;
+		}
+	}
+
+	// Calls fn(worker_index, item_index) for every item_index in [0, item_count), distributing the
+	// items between worker threads. Each worker repeatedly takes the next unprocessed item.
+	static void ForEachItemInParallel(std::size_t item_count, unsigned int worker_count,
+		const std::function<void(unsigned int worker_index, std::size_t item_index)>& fn)
+	{
+		std::atomic<std::size_t> next_item_index = 0;
+		std::vector<std::thread> workers;
+		for (unsigned int worker_index = 0; worker_index < worker_count; ++worker_index)
+		{
+			workers.emplace_back([&next_item_index, item_count, worker_index, &fn]()
+				{
+					while (true)
+					{
+						std::size_t item_index = next_item_index++;
+						if (item_index >= item_count)
+							break;
+						fn(worker_index, item_index);
+					}
+				});
+		}
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	// Counts every node of the subtree below state, which is at the given depth.
+	static void CountSubtree(const std::shared_ptr<GameState>& state, int depth, int max_depth, std::vector<PerftDepthCounts>& counts)
+	{
+		for (Direction direction : ALL_DIRECTIONS)
+		{
+			std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+			CountMove(*state, *new_state, counts[depth + 1]);
+			// The game is over once it's won, so winning states are leaves.
+			if (new_state->HaveWon() || depth + 1 >= max_depth)
+				continue;
+			CountSubtree(new_state, depth + 1, max_depth, counts);
+		}
+	}
+
+	static void PerftWithoutDedup(const std::shared_ptr<GameState>& initial_state, int max_depth, unsigned int worker_count,
+		std::vector<PerftDepthCounts>& counts)
+	{
+		// Expand the top of the tree breadth first on this thread, then search the subtrees below
+		// the split depth on the worker threads.
+		int split_depth = std::min(max_depth, PERFT_SPLIT_DEPTH);
+		std::shared_ptr<GameState> root = std::make_shared<GameState>(*initial_state);
+		root->ResetContext();
+		std::vector<std::shared_ptr<GameState>> frontier = { root };
+		for (int depth = 1; depth <= split_depth; ++depth)
+		{
+			std::vector<std::shared_ptr<GameState>> next_frontier;
+			for (const std::shared_ptr<GameState>& state : frontier)
+			{
+				for (Direction direction : ALL_DIRECTIONS)
+				{
+					std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+					CountMove(*state, *new_state, counts[depth]);
+					if (!new_state->HaveWon())
+						next_frontier.push_back(new_state);
+				}
+			}
+			frontier = std::move(next_frontier);
+		}
+		if (split_depth == max_depth)
+			return;
+
+		// Each worker writes to its own counts, so no lock is needed.
+		std::vector<std::vector<PerftDepthCounts>> worker_counts(worker_count, std::vector<PerftDepthCounts>(counts.size()));
+		ForEachItemInParallel(frontier.size(), worker_count, [&frontier, split_depth, max_depth, &worker_counts](unsigned int worker_index, std::size_t item_index)
+			{
+				CountSubtree(frontier[item_index], split_depth, max_depth, worker_counts[worker_index]);
+			});
+		for (const std::vector<PerftDepthCounts>& local_counts : worker_counts)
+		{
+			AddCounts(local_counts, counts);
+		}
+	}
+
+	static void PerftWithDedup(const std::shared_ptr<GameState>& initial_state, int max_depth, unsigned int worker_count,
+		std::vector<PerftDepthCounts>& counts)
+	{
+		using StateSet = std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual>;
+
+		// The move history is reset on every game state so that GameStateHash and GameStateEqual
+		// only look at the positions of the game objects.
+		std::shared_ptr<GameState> root = std::make_shared<GameState>(*initial_state);
+		root->ResetContext();
+		StateSet seen_states;
+		seen_states.insert(root);
+
+		// Search the tree breadth first, one depth at a time. The workers only read seen_states
+		// while they generate the next depth, and the new game states are merged into seen_states
+		// on this thread afterwards.
+		std::vector<std::shared_ptr<GameState>> frontier = { root };
+		for (int depth = 1; depth <= max_depth && !frontier.empty(); ++depth)
+		{
+			std::vector<StateSet> worker_states(worker_count);
+			ForEachItemInParallel(frontier.size(), worker_count, [&frontier, &seen_states, &worker_states](unsigned int worker_index, std::size_t item_index)
+				{
+					const std::shared_ptr<GameState>& state = frontier[item_index];
+					// The game is over once it's won, so winning states are leaves.
+					if (state->HaveWon())
+						return;
+					for (Direction direction : ALL_DIRECTIONS)
+					{
+						std::shared_ptr<GameState> new_state = state->ApplyMove(direction);
+						new_state->ResetContext();
+						if (seen_states.count(new_state) == 0)
+							worker_states[worker_index].insert(new_state);
+					}
+				});
+
+			std::vector<std::shared_ptr<GameState>> next_frontier;
+			for (const StateSet& states : worker_states)
+			{
+				for (const std::shared_ptr<GameState>& new_state : states)
+				{
+					if (!seen_states.insert(new_state).second)
+						continue;
+					CountState(*new_state, counts[depth]);
+					next_frontier.push_back(new_state);
+				}
+			}
+			frontier = std::move(next_frontier);
+		}
+	}
+
+	PerftResult Perft(const std::shared_ptr<GameState>& initial_state, int max_depth, bool dedup, unsigned int thread_count)
+	{
+		if (!dedup && max_depth > MAX_TURN_COUNT)
+		{
+			// Programmer error
+			std::cerr << "max_depth must be at most MAX_TURN_COUNT in Perft() without dedup: " << max_depth << std::endl;
+			std::abort();
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+		unsigned int worker_count = thread_count != 0 ? thread_count : std::thread::hardware_concurrency();
+		worker_count = std::max(1u, worker_count);
+
+		PerftResult result;
+		result.depths.resize(max_depth + 1);
+		result.depths[0].nodes = 1;
+		if (dedup)
+			PerftWithDedup(initial_state, max_depth, worker_count, result.depths);
+		else
+			PerftWithoutDedup(initial_state, max_depth, worker_count, result.depths);
+
+		auto end_time = std::chrono::steady_clock::now();
+		result.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+		return result;
+	}
+
+}  // namespace BabaSolver
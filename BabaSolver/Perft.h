@@ -0,0 +1,55 @@
+// Code for counting the nodes of the move tree ("perft", short for "performance test").
+//
+// Perft walks the full move tree up to a given depth without any of the solver's pruning
+// heuristics and counts the game states at each depth. The counts only depend on the game rules,
+// so they are a correctness oracle for optimizations of the game engine: an optimization that
+// changes any count changes the semantics of the game. Since perft does little besides applying
+// moves, it's also a benchmark of the raw throughput of the game engine.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// Counts for one depth of the move tree.
+	struct PerftDepthCounts
+	{
+		// How many game states are at this depth.
+		uint64_t nodes = 0;
+		// How many of the game states are winning states. Winning states are leaves of the tree.
+		uint64_t wins = 0;
+		// How many of the game states were reached by a move that didn't change anything.
+		uint64_t noop_moves = 0;
+		// How many of the game states have a dead Baba.
+		uint64_t dead_baba = 0;
+	};
+
+	// The result of a perft run.
+	struct PerftResult
+	{
+		// Counts indexed by depth. Index 0 is the initial state.
+		std::vector<PerftDepthCounts> depths;
+		// How long the perft run took.
+		std::chrono::nanoseconds duration{};
+
+		// Returns the total number of game states at depth 1 and deeper.
+		uint64_t TotalNodes() const;
+	};
+
+	// Counts the game states at each depth of the move tree, up to and including max_depth, using
+	// thread_count worker threads (0 means one thread per hardware thread).
+	//
+	// If dedup is false, every node of the move tree is counted, so a game state that can be
+	// reached by several move sequences is counted several times. If dedup is true, each distinct
+	// game state (ignoring the move history) is counted once, at the smallest depth at which it can
+	// be reached. A no-op move leads back to an already counted game state, so with dedup,
+	// noop_moves is always 0. Without dedup, max_depth must be at most MAX_TURN_COUNT.
+	PerftResult Perft(const std::shared_ptr<GameState>& initial_state, int max_depth, bool dedup, unsigned int thread_count);
+
+}  // namespace BabaSolver
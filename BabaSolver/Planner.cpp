@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "BreadthFirst.h"
+#include "GameState.h"
+
+#include "Planner.h"
+
+namespace BabaSolver
+{
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	namespace
+	{
+		// A game state that reached a stage's milestone, and the moves of the stage.
+		struct StageEnd
+		{
+			std::shared_ptr<GameState> state;
+			std::vector<Direction> moves;
+		};
+
+		// Searches breadth first from start for up to options.alternatives_per_stage game states
+		// that reach milestone (or win), shallowest first.
+		std::vector<StageEnd> SearchStage(const std::shared_ptr<GameState>& start, const Milestone& milestone,
+			const PlannerOptions& options, PlannerStats& stats)
+		{
+			std::vector<StageEnd> ends;
+			BreadthFirstTree tree(start);
+			// The move history of every game state is reset, so that GameStateHash and
+			// GameStateEqual only look at the positions of the game objects.
+			std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual> seen_states = { start };
+			for (std::size_t k = 0; k < tree.Size(); ++k)
+			{
+				BreadthFirstTree::Node node = tree.At(k);
+				if (node.state->HaveWon() || milestone.is_reached(*node.state))
+				{
+					ends.push_back(StageEnd{ node.state, tree.PathTo(k) });
+					if (ends.size() >= static_cast<std::size_t>(std::max(1, options.alternatives_per_stage)))
+						break;
+					continue;
+				}
+				if (node.depth >= options.max_stage_moves || node.state->CheckWhyImpossibleToWin() != LossReason::NONE)
+					continue;
+				if (options.max_states_per_stage != 0 && tree.Size() >= options.max_states_per_stage)
+					continue;
+				for (Direction direction : ALL_DIRECTIONS)
+				{
+					std::shared_ptr<GameState> new_state = node.state->ApplyMove(direction);
+					new_state->ResetContext();
+					if (!seen_states.insert(new_state).second)
+						continue;
+					tree.Add(new_state, k, direction);
+				}
+			}
+			++stats.stage_searches;
+			stats.states_searched += tree.Size() - 1;
+			return ends;
+		}
+
+		// Depth-first search over the stages: plans the milestones from stage on, starting at
+		// state. stage_ends holds the ends of the earlier stages. Returns true once the plan is
+		// completed, in which case result has its moves.
+		bool PlanFrom(const std::shared_ptr<GameState>& state, std::size_t stage, const std::vector<Milestone>& milestones,
+			const PlannerOptions& options, std::vector<StageEnd>& stage_ends, PlanResult& result)
+		{
+			// Keep the plan that reached the most milestones, in case none is completed.
+			bool completed = stage == milestones.size() || state->HaveWon();
+			if (completed || stage_ends.size() > result.stage_moves.size())
+			{
+				result.completed = completed;
+				result.moves.clear();
+				result.stage_moves.clear();
+				for (const StageEnd& end : stage_ends)
+				{
+					result.moves.insert(result.moves.end(), end.moves.begin(), end.moves.end());
+					result.stage_moves.push_back(static_cast<int>(end.moves.size()));
+				}
+			}
+			if (completed)
+				return true;
+
+			std::vector<StageEnd> ends = SearchStage(state, milestones[stage], options, result.stats);
+			for (std::size_t i = 0; i < ends.size(); ++i)
+			{
+				if (i > 0)
+					++result.stats.backtracks;
+				stage_ends.push_back(ends[i]);
+				if (PlanFrom(ends[i].state, stage + 1, milestones, options, stage_ends, result))
+					return true;
+				stage_ends.pop_back();
+			}
+			return false;
+		}
+	}  // namespace
+
+	std::vector<Milestone> FloatiestPlatformsMilestones()
+	{
+		// The rock bridge is too far from the start for one shallow search, so it's split into the
+		// steps that CalculateScore() rewards on the way to it.
+		return {
+			Milestone{ "A rock between the platforms", [](const GameState& state) { return state.CountRocksInBridgeRow() >= 1; } },
+			Milestone{ "Two rocks in a row between the platforms", [](const GameState& state) { return state.CountRocksInBridgeRow() >= 2; } },
+			Milestone{ "Rock bridge", [](const GameState& state) { return state.RockBridgeRow() != -1; } },
+			Milestone{ "Text aligned with the bridge", [](const GameState& state) { return state.TextAlignedWithRockBridge(); } },
+			Milestone{ "Babas together", [](const GameState& state) { return state.BabasOnSameSpace(); } },
+			Milestone{ "Key on the door", [](const GameState& state) { return state.HaveWon(); } },
+		};
+	}
+
+	std::vector<Milestone> WinMilestones()
+	{
+		return { Milestone{ "Key on the door", [](const GameState& state) { return state.HaveWon(); } } };
+	}
+
+	PlanResult PlanMilestones(const std::shared_ptr<GameState>& initial_state, const std::vector<Milestone>& milestones,
+		const PlannerOptions& options)
+	{
+		auto start_time = std::chrono::steady_clock::now();
+		std::shared_ptr<GameState> state = std::make_shared<GameState>(*initial_state);
+		state->ResetContext();
+		PlanResult result;
+		std::vector<StageEnd> stage_ends;
+		PlanFrom(state, 0, milestones, options, stage_ends, result);
+		result.stats.duration = std::chrono::steady_clock::now() - start_time;
+		return result;
+	}
+
+}  // namespace BabaSolver
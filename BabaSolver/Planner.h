@@ -0,0 +1,88 @@
+// Code for solving a level as a sequence of milestones instead of one deep search.
+//
+// CalculateScore() encodes a plan for The Floatiest Platforms as milestones: build the rock bridge,
+// align the text blocks with it, bring the Babas together, and move the key to the door. The
+// solver only uses the plan to pick the best leaf game state of each iteration. PlanMilestones()
+// instead searches for each milestone as a goal of its own, in order: each stage is a breadth-first
+// search from the game state where the last stage ended, for the game states that reach the
+// stage's milestone in the fewest moves. Since each stage only needs a few moves, it's a shallow
+// search instead of part of one 4^n tree.
+//
+// The first game state that reaches a milestone isn't always one from which the next milestone
+// can be reached (e.g. the Babas end up on the wrong side of the bridge), so each stage keeps a few
+// alternative game states. If a later stage can't reach its milestone, the planner backtracks and
+// continues from the next alternative.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// A subgoal of a plan.
+	struct Milestone
+	{
+		std::string name;
+		// Returns true if the game state has reached the milestone.
+		std::function<bool(const GameState& state)> is_reached;
+	};
+
+	// Returns the milestones of The Floatiest Platforms, which CalculateScore() rewards: the rock
+	// bridge (in three steps), the text blocks aligned with it, the Babas together, and the win.
+	std::vector<Milestone> FloatiestPlatformsMilestones();
+
+	// Returns a plan with only one milestone, the win, for levels without known milestones. The
+	// planner is then a breadth-first search for the shortest win.
+	std::vector<Milestone> WinMilestones();
+
+	// Options for PlanMilestones().
+	struct PlannerOptions
+	{
+		// The max number of moves of one stage.
+		int max_stage_moves = 30;
+		// The max number of game states of one stage's search, or 0 for no limit. Each game state
+		// is kept until the stage's search is over, so this bounds the memory used.
+		uint64_t max_states_per_stage = 1'000'000;
+		// How many game states that reach a stage's milestone are kept to backtrack to.
+		int alternatives_per_stage = 3;
+	};
+
+	// Statistics for a PlanMilestones() call.
+	struct PlannerStats
+	{
+		// How many stage searches were run, including the ones that were backtracked from.
+		int stage_searches = 0;
+		// How many times a stage continued from an alternative game state after a later stage
+		// failed.
+		int backtracks = 0;
+		// How many game states the stage searches generated.
+		uint64_t states_searched = 0;
+		std::chrono::nanoseconds duration{};
+	};
+
+	// The result of PlanMilestones().
+	struct PlanResult
+	{
+		// True if the last milestone was reached (or the level was won on the way).
+		bool completed = false;
+		// The moves from the initial game state to the end of the plan. If the plan wasn't
+		// completed, the moves of the plan that reached the most milestones.
+		std::vector<Direction> moves;
+		// How many moves each reached milestone took, in order.
+		std::vector<int> stage_moves;
+		PlannerStats stats;
+	};
+
+	// Reaches the milestones in order from initial_state, backtracking to alternative game states
+	// when a stage fails (see above). moves may be longer than MAX_TURN_COUNT.
+	PlanResult PlanMilestones(const std::shared_ptr<GameState>& initial_state, const std::vector<Milestone>& milestones,
+		const PlannerOptions& options);
+
+}  // namespace BabaSolver
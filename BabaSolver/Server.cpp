@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "GameState.h"
+#include "Json.h"
+#include "Level.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include "Server.h"
+
+namespace BabaSolver
+{
+	// Requests longer than this are rejected, and the connection is closed.
+	static constexpr std::size_t MAX_REQUEST_BYTES = 1 << 20;
+
+	// One client connection. Responses may be sent from several threads (the connection's reader
+	// and the searches' threads), so sends are serialized.
+	struct Server::Connection
+	{
+		int fd;
+		std::mutex send_mutex;
+		// Set when the connection's reader thread is about to return.
+		std::atomic<bool> reader_finished;
+
+		explicit Connection(int fd) : fd(fd), send_mutex(), reader_finished(false) {}
+
+		~Connection()
+		{
+#ifndef _WIN32
+			close(fd);
+#endif
+		}
+
+		// Sends one JSON line. Errors are ignored: the reader notices when the client is gone.
+		void Send(const std::string& json)
+		{
+#ifndef _WIN32
+			std::string line = json + "\n";
+			std::lock_guard<std::mutex> lock(send_mutex);
+			std::size_t sent = 0;
+			while (sent < line.size())
+			{
+				ssize_t result = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+				if (result < 0 && errno == EINTR)
+					continue;
+				if (result <= 0)
+					return;
+				sent += static_cast<std::size_t>(result);
+			}
+#endif
+		}
+	};
+
+	// One search requested by a client.
+	struct Server::Search
+	{
+		std::string id;
+		std::shared_ptr<Connection> connection;
+		// The game state to search from: the level after move_prefix.
+		std::shared_ptr<GameState> level;
+		// The "from_moves" of the request, which the moves of the responses start with.
+		std::string move_prefix;
+		SolverOptions options;
+		// 0 means no limit.
+		std::chrono::nanoseconds time_budget{};
+		std::atomic<bool> cancelled = false;
+		// The running solver, or null if the search isn't running. Guarded by Server::_mutex.
+		Solver* solver = nullptr;
+	};
+
+	// Returns the start of a response to the request with the given ID, e.g. {"id": "a", "type": "queued".
+	static std::string ResponseStart(const std::string& id, const char* type)
+	{
+		return "{\"id\": " + JsonString(id) + ", \"type\": \"" + type + "\"";
+	}
+
+	static std::string ErrorResponse(const std::string& id, const std::string& message)
+	{
+		return ResponseStart(id, "error") + ", \"message\": " + JsonString(message) + "}";
+	}
+
+	static int64_t Milliseconds(std::chrono::nanoseconds duration)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+	}
+
+	// The max "time_budget_seconds" of a solve request (a year), which keeps it in the range of a
+	// std::chrono::nanoseconds.
+	static constexpr double MAX_TIME_BUDGET_SECONDS = 365.0 * 24 * 60 * 60;
+
+	// The largest integer up to which a JSON number (a double) holds every integer exactly.
+	static constexpr int64_t MAX_EXACT_INTEGER = int64_t{ 1 } << 53;
+
+	// Returns the value of the option key if it's an integer in [0, max]. Otherwise returns
+	// std::nullopt and sets error.
+	static std::optional<int64_t> IntegerOption(const std::string& key, const JsonValue& value, int64_t max, std::string& error)
+	{
+		// The comparisons are false for NaN, so it's rejected too.
+		if (value.type != JsonValue::Type::NUMBER || !(value.number >= 0 && value.number <= static_cast<double>(max))
+			|| value.number != std::floor(value.number))
+		{
+			error = "Option \"" + key + "\" must be an integer from 0 to " + std::to_string(max);
+			return std::nullopt;
+		}
+		return static_cast<int64_t>(value.number);
+	}
+
+	// Applies the "options" of a solve request to options. Returns false and sets error if an
+	// option is unknown or out of range.
+	static bool ApplyRequestOptions(const JsonValue& request_options, SolverOptions& options, std::chrono::nanoseconds& time_budget,
+		std::string& error)
+	{
+		constexpr int64_t MAX_INT = std::numeric_limits<int>::max();
+		if (request_options.type != JsonValue::Type::OBJECT)
+		{
+			error = "\"options\" must be an object";
+			return false;
+		}
+		for (std::size_t i = 0; i < request_options.keys.size(); ++i)
+		{
+			const std::string& key = request_options.keys[i];
+			const JsonValue& value = request_options.elements[i];
+			if (key == "anytime")
+			{
+				if (value.type != JsonValue::Type::BOOLEAN)
+				{
+					error = "Option \"anytime\" must be a boolean";
+					return false;
+				}
+				options.anytime = value.boolean;
+				continue;
+			}
+			if (key == "time_budget_seconds")
+			{
+				if (value.type != JsonValue::Type::NUMBER || !std::isfinite(value.number) || value.number < 0
+					|| value.number > MAX_TIME_BUDGET_SECONDS)
+				{
+					error = "Option \"time_budget_seconds\" must be a number from 0 to " + std::to_string(static_cast<int64_t>(MAX_TIME_BUDGET_SECONDS));
+					return false;
+				}
+				time_budget = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(value.number));
+				continue;
+			}
+
+			int64_t max;
+			if (key == "max_turn_depth" || key == "parallelism_depth" || key == "max_cache_depth")
+				max = MAX_TURN_COUNT;
+			else if (key == "iteration_count" || key == "estimate_probe_count" || key == "max_endgame_tables")
+				max = MAX_INT;
+			else if (key == "max_cache_mb")
+				max = std::numeric_limits<int64_t>::max() / (1024 * 1024);
+			else if (key == "print_every_n_moves")
+				max = MAX_EXACT_INTEGER;
+			else
+			{
+				error = "Unknown option \"" + key + "\"";
+				return false;
+			}
+			std::optional<int64_t> number = IntegerOption(key, value, max, error);
+			if (!number)
+				return false;
+			if (key == "iteration_count")
+				options.iteration_count = static_cast<int>(*number);
+			else if (key == "max_turn_depth")
+				options.max_turn_depth = static_cast<int>(*number);
+			else if (key == "parallelism_depth")
+				options.parallelism_depth = static_cast<int>(*number);
+			else if (key == "max_cache_depth")
+				options.max_cache_depth = static_cast<int>(*number);
+			else if (key == "max_cache_mb")
+				options.max_cache_bytes = static_cast<uint64_t>(*number) * 1024 * 1024;
+			else if (key == "print_every_n_moves")
+				options.print_every_n_moves = std::max<uint64_t>(1, static_cast<uint64_t>(*number));
+			else if (key == "estimate_probe_count")
+				options.estimate_probe_count = static_cast<int>(*number);
+			else
+				options.max_endgame_tables = static_cast<int>(*number);
+		}
+		if (options.parallelism_depth > options.max_turn_depth)
+		{
+			error = "parallelism_depth (" + std::to_string(options.parallelism_depth) + ") must be at most max_turn_depth ("
+				+ std::to_string(options.max_turn_depth) + ")";
+			return false;
+		}
+		return true;
+	}
+
+	Server::Server(const ServerOptions& options)
+		: _options(options), _thread_pool(options.thread_count), _socket_path(), _listen_fd(-1), _accept_thread(), _search_threads(),
+		_mutex(), _condition(), _stopping(false), _stopped(false), _readers(), _queue(), _running()
+	{
+	}
+
+	Server::~Server()
+	{
+		Stop();
+	}
+
+	bool Server::Start(const std::string& socket_path, std::string& error)
+	{
+#ifdef _WIN32
+		error = "The server isn't supported on Windows";
+		return false;
+#else
+		sockaddr_un address{};
+		if (socket_path.size() >= sizeof(address.sun_path))
+		{
+			error = "The socket path is too long: " + socket_path;
+			return false;
+		}
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+		_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (_listen_fd < 0)
+		{
+			error = std::string("Unable to create a socket: ") + std::strerror(errno);
+			return false;
+		}
+		unlink(socket_path.c_str());
+		if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(_listen_fd, SOMAXCONN) != 0)
+		{
+			error = "Unable to listen on " + socket_path + ": " + std::strerror(errno);
+			close(_listen_fd);
+			_listen_fd = -1;
+			return false;
+		}
+		_socket_path = socket_path;
+
+		_accept_thread = std::thread([this]() { AcceptLoop(); });
+		for (unsigned int i = 0; i < std::max(1u, _options.concurrent_search_count); ++i)
+		{
+			_search_threads.emplace_back([this]() { SearchLoop(); });
+		}
+		return true;
+#endif
+	}
+
+	void Server::Wait()
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping; });
+		}
+		Stop();
+	}
+
+	void Server::Stop()
+	{
+		std::vector<std::pair<std::shared_ptr<Connection>, std::thread>> readers;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_stopped)
+				return;
+			_stopped = true;
+			_stopping = true;
+#ifndef _WIN32
+			// Wake up the accept() and recv() calls of the other threads.
+			if (_listen_fd >= 0)
+				shutdown(_listen_fd, SHUT_RDWR);
+			for (const auto& [connection, thread] : _readers)
+			{
+				shutdown(connection->fd, SHUT_RDWR);
+			}
+#endif
+		}
+		_condition.notify_all();
+		CancelSearches(nullptr, nullptr);
+
+		if (_accept_thread.joinable())
+			_accept_thread.join();
+		// No more readers are started once the accept thread has stopped.
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			readers = std::move(_readers);
+		}
+		for (auto& [connection, thread] : readers)
+		{
+			thread.join();
+		}
+		for (std::thread& thread : _search_threads)
+		{
+			thread.join();
+		}
+		_search_threads.clear();
+#ifndef _WIN32
+		if (_listen_fd >= 0)
+		{
+			close(_listen_fd);
+			_listen_fd = -1;
+			unlink(_socket_path.c_str());
+		}
+#endif
+	}
+
+	void Server::AcceptLoop()
+	{
+#ifndef _WIN32
+		while (true)
+		{
+			int fd = accept(_listen_fd, nullptr, nullptr);
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (_stopping)
+			{
+				if (fd >= 0)
+					close(fd);
+				return;
+			}
+			if (fd < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				return;
+			}
+			for (auto it = _readers.begin(); it != _readers.end();)
+			{
+				if (it->first->reader_finished)
+				{
+					it->second.join();
+					it = _readers.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+			std::shared_ptr<Connection> connection = std::make_shared<Connection>(fd);
+			_readers.emplace_back(connection, std::thread([this, connection]() { ReadLoop(connection); }));
+		}
+#endif
+	}
+
+	void Server::ReadLoop(std::shared_ptr<Connection> connection)
+	{
+#ifndef _WIN32
+		std::string buffer;
+		char chunk[4096];
+		while (true)
+		{
+			ssize_t result = recv(connection->fd, chunk, sizeof(chunk), 0);
+			if (result < 0 && errno == EINTR)
+				continue;
+			if (result <= 0)
+				break;
+			buffer.append(chunk, static_cast<std::size_t>(result));
+			std::size_t line_end;
+			while ((line_end = buffer.find('\n')) != std::string::npos)
+			{
+				std::string line = buffer.substr(0, line_end);
+				buffer.erase(0, line_end + 1);
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				if (!line.empty())
+					HandleRequest(connection, line);
+			}
+			if (buffer.size() > MAX_REQUEST_BYTES)
+			{
+				connection->Send(ErrorResponse("", "Request too long"));
+				break;
+			}
+		}
+		shutdown(connection->fd, SHUT_RDWR);
+#endif
+		// The client is gone, so nobody is waiting for its searches.
+		CancelSearches(connection.get(), nullptr);
+		connection->reader_finished = true;
+	}
+
+	void Server::HandleRequest(const std::shared_ptr<Connection>& connection, const std::string& line)
+	{
+		std::string error;
+		std::optional<JsonValue> request = ParseJson(line, error);
+		if (!request || request->type != JsonValue::Type::OBJECT)
+		{
+			connection->Send(ErrorResponse("", request ? "A request must be a JSON object" : "Invalid JSON: " + error));
+			return;
+		}
+		const JsonValue* id_value = request->Find("id");
+		std::string id = id_value != nullptr && id_value->type == JsonValue::Type::STRING ? id_value->string : "";
+		const JsonValue* type_value = request->Find("type");
+		std::string type = type_value != nullptr && type_value->type == JsonValue::Type::STRING ? type_value->string : "";
+
+		if (type == "shutdown")
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_condition.notify_all();
+			CancelSearches(nullptr, nullptr);
+			return;
+		}
+		if (type == "cancel")
+		{
+			CancelSearches(connection.get(), &id);
+			return;
+		}
+		if (type != "solve")
+		{
+			connection->Send(ErrorResponse(id, "Unknown request type \"" + type + "\""));
+			return;
+		}
+
+		std::shared_ptr<Search> search = std::make_shared<Search>();
+		search->id = id;
+		search->connection = connection;
+		search->options = _options.solver_options;
+		const JsonValue* level_value = request->Find("level");
+		const JsonValue* level_name_value = request->Find("level_name");
+		if (level_value != nullptr && level_value->type == JsonValue::Type::STRING)
+		{
+			std::istringstream level_stream(level_value->string);
+			search->level = ParseLevel(level_stream, error);
+		}
+		else if (level_name_value != nullptr && level_name_value->type == JsonValue::Type::STRING)
+		{
+			search->level = LoadLevel(level_name_value->string, error);
+		}
+		else
+		{
+			error = "A solve request needs a \"level\" or a \"level_name\"";
+		}
+		if (!search->level)
+		{
+			connection->Send(ErrorResponse(id, error));
+			return;
+		}
+		const JsonValue* from_moves_value = request->Find("from_moves");
+		if (from_moves_value != nullptr)
+		{
+			std::optional<std::vector<Direction>> move_prefix;
+			if (from_moves_value->type == JsonValue::Type::STRING)
+				move_prefix = ParseMoves(from_moves_value->string);
+			if (!move_prefix)
+			{
+				connection->Send(ErrorResponse(id, "\"from_moves\" must be a string of moves, e.g. \"UDLR\""));
+				return;
+			}
+			search->level = ReplayPrefix(search->level, *move_prefix, error);
+			if (!search->level)
+			{
+				connection->Send(ErrorResponse(id, error));
+				return;
+			}
+			search->move_prefix = FormatMoves(*move_prefix);
+		}
+		const JsonValue* options_value = request->Find("options");
+		if (options_value != nullptr && !ApplyRequestOptions(*options_value, search->options, search->time_budget, error))
+		{
+			connection->Send(ErrorResponse(id, error));
+			return;
+		}
+
+		std::size_t position;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			position = _queue.size();
+			_queue.push_back(search);
+		}
+		connection->Send(ResponseStart(id, "queued") + ", \"position\": " + std::to_string(position) + "}");
+		_condition.notify_all();
+	}
+
+	void Server::SearchLoop()
+	{
+		while (true)
+		{
+			std::shared_ptr<Search> search;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_condition.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+				if (_stopping)
+					return;
+				search = _queue.front();
+				_queue.pop_front();
+				_running.push_back(search);
+			}
+			RunSearch(search);
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running.erase(std::remove(_running.begin(), _running.end(), search), _running.end());
+		}
+	}
+
+	void Server::RunSearch(const std::shared_ptr<Search>& search)
+	{
+		Connection& connection = *search->connection;
+		connection.Send(ResponseStart(search->id, "started") + "}");
+		auto start_time = std::chrono::steady_clock::now();
+
+		Solver solver(search->level, search->options);
+		solver.SetThreadPool(&_thread_pool);
+		// Each iteration starts from the result of the last one, so the full moves of a game state
+		// are the moves of the finished iterations followed by its own.
+		std::string finished_moves = search->move_prefix;
+		int iteration = 1;
+		SolverCallbacks callbacks;
+		callbacks.on_progress = [&search, &connection](const SolverProgress& progress)
+			{
+				connection.Send(ResponseStart(search->id, "progress") + ", \"iteration\": " + std::to_string(progress.iteration)
+					+ ", \"moves_done\": " + std::to_string(progress.moves_done) + ", \"estimated_moves\": "
+					+ std::to_string(static_cast<uint64_t>(progress.estimated_moves)) + ", \"elapsed_ms\": "
+					+ std::to_string(Milliseconds(progress.elapsed)) + "}");
+			};
+		callbacks.on_best_leaf = [&search, &connection, &finished_moves, &iteration](const std::shared_ptr<GameState>& state, int score)
+			{
+				connection.Send(ResponseStart(search->id, "best_leaf") + ", \"iteration\": " + std::to_string(iteration)
+					+ ", \"score\": " + std::to_string(score) + ", \"moves\": " + JsonString(finished_moves + FormatMoves(*state)) + "}");
+			};
+		callbacks.on_shorter_win = [&search, &connection, &finished_moves, &iteration](const std::shared_ptr<GameState>& state)
+			{
+				connection.Send(ResponseStart(search->id, "win") + ", \"iteration\": " + std::to_string(iteration)
+					+ ", \"moves\": " + JsonString(finished_moves + FormatMoves(*state)) + "}");
+			};
+		callbacks.on_iteration_finished = [&finished_moves, &iteration](int finished_iteration, const std::shared_ptr<GameState>& state)
+			{
+				finished_moves += FormatMoves(*state);
+				iteration = finished_iteration + 1;
+			};
+		solver.SetCallbacks(callbacks);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			search->solver = &solver;
+		}
+		solver.Start();
+		if (search->cancelled)
+			solver.Cancel();
+		bool timed_out = false;
+		if (search->time_budget.count() > 0 && !solver.WaitFor(search->time_budget))
+		{
+			solver.Cancel();
+			timed_out = !search->cancelled;
+		}
+		std::shared_ptr<GameState> end_state = solver.Wait();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			search->solver = nullptr;
+		}
+
+		bool won = end_state && end_state->HaveWon();
+		connection.Send(ResponseStart(search->id, "result") + ", \"won\": " + (won ? "true" : "false") + ", \"cancelled\": "
+			+ (search->cancelled ? "true" : "false") + ", \"timed_out\": " + (timed_out ? "true" : "false") + ", \"moves\": "
+			+ JsonString(finished_moves) + ", \"moves_simulated\": " + std::to_string(solver.Stats().Totals().nodes_generated)
+			+ ", \"duration_ms\": " + std::to_string(Milliseconds(std::chrono::steady_clock::now() - start_time)) + "}");
+	}
+
+	void Server::CancelSearches(const Connection* connection, const std::string* id)
+	{
+		std::vector<std::shared_ptr<Search>> removed;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto matches = [connection, id](const std::shared_ptr<Search>& search)
+				{
+					return (connection == nullptr || search->connection.get() == connection) && (id == nullptr || search->id == *id);
+				};
+			for (const std::shared_ptr<Search>& search : _running)
+			{
+				if (!matches(search))
+					continue;
+				search->cancelled = true;
+				if (search->solver != nullptr)
+					search->solver->Cancel();
+			}
+			for (auto it = _queue.begin(); it != _queue.end();)
+			{
+				if (matches(*it))
+				{
+					removed.push_back(*it);
+					it = _queue.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+		}
+		// Searches that never started still get a result, so clients can wait for one result per
+		// request.
+		for (const std::shared_ptr<Search>& search : removed)
+		{
+			search->connection->Send(ResponseStart(search->id, "result")
+				+ ", \"won\": false, \"cancelled\": true, \"timed_out\": false, \"moves\": \"\", \"moves_simulated\": 0, \"duration_ms\": 0}");
+		}
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,111 @@
+// A long-running solver server that takes requests over a Unix domain socket.
+//
+// Clients send one JSON object per line and get JSON lines back. The server keeps one thread pool
+// for all requests (see ThreadPool.h), so repeated requests don't pay for starting a process and
+// its threads.
+//
+// Requests:
+//   {"type": "solve", "id": "a", "level": "<level text>", "options": {...}}
+//     Queues a search. "level" is a level in the format of Level.h; "level_name" may be given
+//     instead, with a built-in level name or a level file path on the server. "options" may have
+//     iteration_count, max_turn_depth, parallelism_depth, max_cache_depth, max_cache_mb,
+//     print_every_n_moves, estimate_probe_count, max_endgame_tables, time_budget_seconds and
+//     anytime (a boolean, see SolverOptions::anytime); the other options are the server's.
+//     "from_moves" (e.g. "LLLLD") is replayed before searching, and the moves of the responses
+//     start with it.
+//   {"type": "cancel", "id": "a"}
+//     Cancels a queued or running search of this connection.
+//   {"type": "shutdown"}
+//     Cancels every search and stops the server.
+//
+// Responses (each has the "id" of its request):
+//   {"type": "queued", "position": 0}  The number of searches ahead of this one.
+//   {"type": "started"}
+//   {"type": "progress", "iteration": 1, "moves_done": 123, "estimated_moves": 456, "elapsed_ms": 78}
+//   {"type": "best_leaf", "iteration": 1, "score": -12, "moves": "UDLR"}
+//   {"type": "win", "iteration": 1, "moves": "UDLR"}  A shorter win, in anytime mode.
+//   {"type": "result", "won": true, "cancelled": false, "timed_out": false, "moves": "UDLR",
+//    "moves_simulated": 123, "duration_ms": 78}
+//   {"type": "error", "message": "..."}
+//
+// A client's searches are cancelled when it disconnects.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Solver.h"
+#include "ThreadPool.h"
+
+namespace BabaSolver
+{
+	// Options for Server.
+	struct ServerOptions
+	{
+		// How many threads the shared pool has. 0 means one thread per hardware thread.
+		unsigned int thread_count = 0;
+		// How many searches run at the same time. The rest wait in a queue.
+		unsigned int concurrent_search_count = 2;
+		// The options of each search, before the request's options are applied.
+		SolverOptions solver_options;
+	};
+
+	class Server
+	{
+	public:
+		explicit Server(const ServerOptions& options);
+		// Stops the server if it's running.
+		~Server();
+		Server(const Server&) = delete;
+		Server& operator=(const Server&) = delete;
+
+		// Starts listening on a Unix domain socket at socket_path (replacing any file there) and
+		// returns right away. Returns false and sets error if the socket can't be created.
+		bool Start(const std::string& socket_path, std::string& error);
+
+		// Waits until the server is stopped by a "shutdown" request or Stop().
+		void Wait();
+
+		// Cancels every search, disconnects every client, and stops the server.
+		void Stop();
+
+	private:
+		struct Connection;
+		struct Search;
+
+		void AcceptLoop();
+		void ReadLoop(std::shared_ptr<Connection> connection);
+		void SearchLoop();
+		void HandleRequest(const std::shared_ptr<Connection>& connection, const std::string& line);
+		void RunSearch(const std::shared_ptr<Search>& search);
+		// Cancels the searches of connection (all of them if connection is null) whose ID is id (or
+		// all IDs if id is null).
+		void CancelSearches(const Connection* connection, const std::string* id);
+
+		ServerOptions _options;
+		ThreadPool _thread_pool;
+		std::string _socket_path;
+		int _listen_fd;
+		std::thread _accept_thread;
+		std::vector<std::thread> _search_threads;
+
+		// Guards everything below.
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		bool _stopping;
+		bool _stopped;
+		// The connections and the threads reading their requests. Finished readers are joined and
+		// removed when the next client connects.
+		std::vector<std::pair<std::shared_ptr<Connection>, std::thread>> _readers;
+		std::deque<std::shared_ptr<Search>> _queue;
+		std::vector<std::shared_ptr<Search>> _running;
+	};
+
+}  // namespace BabaSolver
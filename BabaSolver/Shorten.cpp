@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BreadthFirst.h"
+#include "GameState.h"
+
+#include "Shorten.h"
+
+namespace BabaSolver
+{
+	static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+	namespace
+	{
+		// Maps game states to an index. The move history of every game state in the map is reset
+		// so that GameStateHash and GameStateEqual only look at the positions of the game objects.
+		using StateIndexMap = std::unordered_map<std::shared_ptr<GameState>, std::size_t, GameStateHash, GameStateEqual>;
+
+		// Returns the game state after applying direction to state, with its move history reset.
+		std::shared_ptr<GameState> ApplyMoveAndResetContext(const GameState& state, Direction direction)
+		{
+			std::shared_ptr<GameState> new_state = state.ApplyMove(direction);
+			new_state->ResetContext();
+			return new_state;
+		}
+
+		// Returns the game state before the first move and after each move, with their move
+		// histories reset. Stops at the first winning game state.
+		std::vector<std::shared_ptr<GameState>> ReplayStates(const std::shared_ptr<GameState>& initial_state, const std::vector<Direction>& moves)
+		{
+			std::shared_ptr<GameState> state = std::make_shared<GameState>(*initial_state);
+			state->ResetContext();
+			std::vector<std::shared_ptr<GameState>> states = { state };
+			for (Direction direction : moves)
+			{
+				if (state->HaveWon())
+					break;
+				state = ApplyMoveAndResetContext(*state, direction);
+				states.push_back(state);
+			}
+			return states;
+		}
+
+		// Searches once for shortcuts between the game states of a move sequence, and returns the
+		// shortest sequence made of the original moves and the shortcuts. states are the game
+		// states before the first move and after each move (see ReplayStates()).
+		std::vector<Direction> ShortenOnce(const std::vector<std::shared_ptr<GameState>>& states, const std::vector<Direction>& moves,
+			const ShortenOptions& options, ShortenStats& stats)
+		{
+			std::size_t end_index = states.size() - 1;
+			bool won = states[end_index]->HaveWon();
+			// If a game state shows up more than once, a shortcut to it should skip to its last
+			// occurrence.
+			StateIndexMap state_indexes;
+			for (std::size_t j = 0; j <= end_index; ++j)
+				state_indexes[states[j]] = j;
+
+			// The shortest known sequence to each game state of the sequence is the one to
+			// states[from[j]], followed by segments[j]. Since shortcuts only go forward, the
+			// shortest sequence to states[i] is final once every game state before it is searched.
+			constexpr std::size_t UNREACHED = std::numeric_limits<std::size_t>::max();
+			std::vector<std::size_t> lengths(end_index + 1, UNREACHED);
+			std::vector<std::size_t> from(end_index + 1, 0);
+			std::vector<std::vector<Direction>> segments(end_index + 1);
+			lengths[0] = 0;
+			auto relax = [&lengths, &from, &segments](std::size_t i, std::size_t j, std::vector<Direction> segment)
+				{
+					if (lengths[i] + segment.size() >= lengths[j])
+						return;
+					lengths[j] = lengths[i] + segment.size();
+					from[j] = i;
+					segments[j] = std::move(segment);
+				};
+
+			for (std::size_t i = 0; i < end_index; ++i)
+			{
+				relax(i, i + 1, { moves[i] });
+
+				// Search breadth first from states[i], so the first path found to a game state is
+				// the shortest.
+				BreadthFirstTree tree(states[i]);
+				StateIndexMap seen_states = { { states[i], 0 } };
+				bool reached_end = false;
+				for (std::size_t k = 0; k < tree.Size() && !reached_end; ++k)
+				{
+					BreadthFirstTree::Node node = tree.At(k);
+					auto target = state_indexes.find(node.state);
+					if (won && node.state->HaveWon())
+						target = state_indexes.find(states[end_index]);
+					if (target != state_indexes.end() && target->second > i)
+					{
+						relax(i, target->second, tree.PathTo(k));
+						// A shortcut through another game state of the sequence can't be shorter
+						// than the shortest path to the end.
+						if (target->second == end_index)
+							reached_end = true;
+					}
+					if (node.depth >= options.max_shortcut_moves || node.state->HaveWon()
+						|| node.state->CheckWhyImpossibleToWin() != LossReason::NONE)
+						continue;
+					if (options.max_states_per_search != 0 && tree.Size() >= options.max_states_per_search)
+						continue;
+					for (Direction direction : ALL_DIRECTIONS)
+					{
+						std::shared_ptr<GameState> new_state = ApplyMoveAndResetContext(*node.state, direction);
+						if (!seen_states.emplace(new_state, tree.Size()).second)
+							continue;
+						tree.Add(new_state, k, direction);
+					}
+				}
+				stats.states_searched += tree.Size() - 1;
+			}
+
+			std::vector<std::vector<Direction>> path_segments;
+			for (std::size_t j = end_index; j != 0; j = from[j])
+			{
+				if (from[j] + 1 != j || segments[j].size() != 1)
+					++stats.shortcuts;
+				path_segments.push_back(std::move(segments[j]));
+			}
+			std::vector<Direction> shortened;
+			for (auto it = path_segments.rbegin(); it != path_segments.rend(); ++it)
+				shortened.insert(shortened.end(), it->begin(), it->end());
+			return shortened;
+		}
+	}  // namespace
+
+	std::vector<Direction> ShortenSolution(const std::shared_ptr<GameState>& initial_state, const std::vector<Direction>& moves,
+		const ShortenOptions& options, ShortenStats* stats)
+	{
+		auto start_time = std::chrono::steady_clock::now();
+		ShortenStats local_stats;
+		std::vector<std::shared_ptr<GameState>> states = ReplayStates(initial_state, moves);
+		std::vector<Direction> best_moves(moves.begin(), moves.begin() + (states.size() - 1));
+		while (true)
+		{
+			++local_stats.passes;
+			ShortenStats pass_stats;
+			std::vector<Direction> shortened = ShortenOnce(states, best_moves, options, pass_stats);
+			local_stats.states_searched += pass_stats.states_searched;
+			if (shortened.size() >= best_moves.size())
+				break;
+			local_stats.shortcuts += pass_stats.shortcuts;
+			best_moves = std::move(shortened);
+			states = ReplayStates(initial_state, best_moves);
+		}
+		local_stats.duration = std::chrono::steady_clock::now() - start_time;
+		if (stats != nullptr)
+			*stats = local_stats;
+		return best_moves;
+	}
+
+	std::shared_ptr<GameState> ReplayMoves(const std::shared_ptr<GameState>& initial_state, const std::vector<Direction>& moves)
+	{
+		return ReplayStates(initial_state, moves).back();
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,61 @@
+// Code for shortening solutions after they're found.
+//
+// The solver's depth-first search returns the first winning move sequence it finds, which often
+// wastes moves (e.g. walking back and forth). ShortenSolution() replays a move sequence to get the
+// game state after each move, and searches breadth first from each of those game states for a
+// shorter way to a game state later in the sequence. The shortest combination of the original
+// moves and the shortcuts found is the new sequence, which leads to the same end game state (or,
+// for a winning sequence, to a winning game state).
+//
+// Each breadth-first search is limited to a few moves, so shortening takes a small fraction of the
+// time of the search that found the solution, but it can't find shortcuts longer than the limit.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	// Options for ShortenSolution().
+	struct ShortenOptions
+	{
+		// The max number of moves of a shortcut. The cost of each breadth-first search grows
+		// exponentially with this value.
+		int max_shortcut_moves = 8;
+		// The max number of game states of each breadth-first search, or 0 for no limit. Each game
+		// state is kept until the search is over, so this bounds the memory used.
+		uint64_t max_states_per_search = 200'000;
+	};
+
+	// Statistics for a ShortenSolution() call.
+	struct ShortenStats
+	{
+		// How many times the whole sequence was searched for shortcuts. Shortening stops after the
+		// first pass that doesn't make the sequence shorter.
+		int passes = 0;
+		// How many game states the breadth-first searches generated.
+		uint64_t states_searched = 0;
+		// How many shortcuts are in the returned sequence (summed across passes).
+		int shortcuts = 0;
+		// How long shortening took.
+		std::chrono::nanoseconds duration{};
+	};
+
+	// Returns a move sequence that is at most as long as moves and, starting from initial_state,
+	// leads to the same game state as moves, or to a winning game state if moves win. The moves of
+	// a winning sequence after the win are dropped. moves may be longer than MAX_TURN_COUNT. If
+	// stats is not null, it's filled with the statistics of the call.
+	std::vector<Direction> ShortenSolution(const std::shared_ptr<GameState>& initial_state, const std::vector<Direction>& moves,
+		const ShortenOptions& options, ShortenStats* stats = nullptr);
+
+	// Returns the game state after applying moves to initial_state, with its move history reset.
+	// Unlike GameState::ApplyMoves(), moves may be longer than MAX_TURN_COUNT. Stops at the first
+	// winning game state, since the game is over once it's won.
+	std::shared_ptr<GameState> ReplayMoves(const std::shared_ptr<GameState>& initial_state, const std::vector<Direction>& moves);
+
+}  // namespace BabaSolver
@@ -0,0 +1,161 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+
+#include "SolutionCache.h"
+
+namespace BabaSolver
+{
+	// Parses the moves field of a cache line, e.g. "UURD/LLDR". Returns std::nullopt if it's
+	// invalid.
+	static std::optional<std::vector<std::vector<Direction>>> ParseIterationMoves(const std::string& field)
+	{
+		std::vector<std::vector<Direction>> iteration_moves;
+		std::size_t start = 0;
+		while (true)
+		{
+			std::size_t end = field.find('/', start);
+			std::optional<std::vector<Direction>> moves = ParseMoves(field.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			if (!moves)
+				return std::nullopt;
+			iteration_moves.push_back(std::move(*moves));
+			if (end == std::string::npos)
+				return iteration_moves;
+			start = end + 1;
+		}
+	}
+
+	// Returns the total number of moves of solution.
+	static std::size_t MoveCount(const CachedSolution& solution)
+	{
+		std::size_t count = 0;
+		for (const std::vector<Direction>& moves : solution.iteration_moves)
+			count += moves.size();
+		return count;
+	}
+
+	uint64_t LevelHash(const GameState& level)
+	{
+		// 64-bit FNV-1a over the grid cells and the Baba coordinates, one byte at a time so that
+		// the result doesn't depend on the machine's endianness.
+		uint64_t hash = 0xcbf29ce484222325;
+		auto add_byte = [&hash](uint8_t byte)
+			{
+				hash ^= byte;
+				hash *= 0x100000001b3;
+			};
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				add_byte(static_cast<uint8_t>(level._grid[i][j] & 0xff));
+				add_byte(static_cast<uint8_t>(level._grid[i][j] >> 8));
+			}
+		}
+		for (Coordinate baba : { level._baba1, level._baba2 })
+		{
+			add_byte(static_cast<uint8_t>(baba.i));
+			add_byte(static_cast<uint8_t>(baba.j));
+		}
+		return hash;
+	}
+
+	std::string SolutionCacheKey(const SolverOptions& options)
+	{
+		return "i" + std::to_string(options.iteration_count) + ",d" + std::to_string(options.max_turn_depth)
+			+ ",p" + std::to_string(options.parallelism_depth) + ",c" + std::to_string(options.max_cache_depth)
+			+ ",m" + std::to_string(options.max_cache_bytes)
+			+ (options.max_endgame_tables != 0 ? ",e" + std::to_string(options.max_endgame_tables) : "");
+	}
+
+	SolutionCache::SolutionCache(std::string path) : _path(std::move(path)) {}
+
+	std::optional<CachedSolution> SolutionCache::Find(const GameState& level, const SolverOptions& options) const
+	{
+		std::ifstream in(_path);
+		if (!in)
+			return std::nullopt;
+		char level_hash[17];
+		std::snprintf(level_hash, sizeof(level_hash), "%016llx", static_cast<unsigned long long>(LevelHash(level)));
+		std::string key = SolutionCacheKey(options);
+
+		std::optional<CachedSolution> best;
+		std::string line;
+		while (std::getline(in, line))
+		{
+			std::istringstream fields(line);
+			std::string line_hash, line_key, result, moves_field;
+			if (!(fields >> line_hash >> line_key >> result >> moves_field) || line_hash != level_hash)
+				continue;
+			if (result != "won" && result != "best")
+				continue;
+			CachedSolution solution;
+			solution.won = result == "won";
+			if (!solution.won && line_key != key)
+				continue;
+			std::optional<std::vector<std::vector<Direction>>> iteration_moves = ParseIterationMoves(moves_field);
+			if (!iteration_moves)
+				continue;
+			solution.iteration_moves = std::move(*iteration_moves);
+			if (best && best->won && (!solution.won || MoveCount(solution) >= MoveCount(*best)))
+				continue;
+			best = std::move(solution);
+		}
+		return best;
+	}
+
+	bool SolutionCache::Store(const GameState& level, const SolverOptions& options, const CachedSolution& solution) const
+	{
+		if (solution.iteration_moves.empty())
+			return false;
+		char level_hash[17];
+		std::snprintf(level_hash, sizeof(level_hash), "%016llx", static_cast<unsigned long long>(LevelHash(level)));
+		std::string line = std::string(level_hash) + " " + SolutionCacheKey(options) + " " + (solution.won ? "won" : "best") + " ";
+		for (std::size_t i = 0; i < solution.iteration_moves.size(); ++i)
+		{
+			if (i > 0)
+				line += '/';
+			line += FormatMoves(solution.iteration_moves[i]);
+		}
+		line += '\n';
+		// The line is written with one call, so that lines appended by other processes at the same
+		// time don't interleave with it.
+		std::ofstream out(_path, std::ios::app);
+		out.write(line.data(), static_cast<std::streamsize>(line.size()));
+		out.flush();
+		return static_cast<bool>(out);
+	}
+
+	std::vector<std::shared_ptr<GameState>> ReplaySolution(const std::shared_ptr<GameState>& level, const CachedSolution& solution)
+	{
+		std::vector<std::shared_ptr<GameState>> end_states;
+		std::shared_ptr<GameState> state = level;
+		for (const std::vector<Direction>& moves : solution.iteration_moves)
+		{
+			if (moves.size() > MAX_TURN_COUNT)
+				return {};
+			std::shared_ptr<GameState> iteration_start = std::make_shared<GameState>(*state);
+			iteration_start->ResetContext();
+			state = iteration_start->ApplyMoves(moves);
+			end_states.push_back(state);
+			// The Solver stops at the first win, so a win before the last iteration means the
+			// solution isn't one that the Solver would have found.
+			if (state->HaveWon() && end_states.size() < solution.iteration_moves.size())
+				return {};
+		}
+		if (end_states.empty() || state->HaveWon() != solution.won)
+			return {};
+		return end_states;
+	}
+
+}  // namespace BabaSolver
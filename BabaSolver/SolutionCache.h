@@ -0,0 +1,72 @@
+// An on-disk cache of solver results, so that solving a level again doesn't repeat the search.
+//
+// The cache is a text file with one result per line:
+//
+//   <level hash> <options> <won|best> <moves>
+//
+// The level hash is LevelHash() in hex. The options are the SolverOptions that change which
+// result a search finds (see SolutionCacheKey()), and the moves are the moves of each iteration
+// separated by '/', e.g. "UURD/LLDR". Results are appended, so several processes can share a
+// file, and lines that can't be parsed are skipped.
+//
+// A winning result is returned for any options, since the moves win the level no matter how they
+// were found. A result that didn't win is only returned for the same options. The Solver replays
+// a cached result before using it (see ReplaySolution()), so a stale or corrupted file can cost a
+// search but never returns a wrong answer.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+
+namespace BabaSolver
+{
+	// A solver result read from or written to a SolutionCache.
+	struct CachedSolution
+	{
+		// True if the moves win the level.
+		bool won = false;
+		// The moves of each iteration. Each iteration starts from the end state of the last one.
+		std::vector<std::vector<Direction>> iteration_moves;
+	};
+
+	// Returns a hash of the grid and Babas of level. Unlike GameStateHash, it doesn't depend on
+	// the build (see BABA_SOLVER_HASH), so it can be stored in files.
+	uint64_t LevelHash(const GameState& level);
+
+	// Returns the options that change which result a search finds, as a string without spaces,
+	// e.g. "i4,d25,p2,c20,m0" (with ",e<n>" appended if the endgame tablebase is used).
+	std::string SolutionCacheKey(const SolverOptions& options);
+
+	class SolutionCache
+	{
+	public:
+		explicit SolutionCache(std::string path);
+
+		// Returns the cached result for level and options, or std::nullopt if there is none. If
+		// several results match, a winning one with the fewest moves is preferred, and then the
+		// most recent one.
+		std::optional<CachedSolution> Find(const GameState& level, const SolverOptions& options) const;
+
+		// Appends a result to the file. Returns false if the file can't be written.
+		bool Store(const GameState& level, const SolverOptions& options, const CachedSolution& solution) const;
+
+		const std::string& Path() const { return _path; }
+
+	private:
+		std::string _path;
+	};
+
+	// Replays solution from level, resetting the context at the start of each iteration like the
+	// Solver does. Returns the end state of each iteration, or an empty vector if the solution is
+	// invalid (an iteration has more than MAX_TURN_COUNT moves, or the solution is marked as won
+	// but doesn't win).
+	std::vector<std::shared_ptr<GameState>> ReplaySolution(const std::shared_ptr<GameState>& level, const CachedSolution& solution);
+
+}  // namespace BabaSolver
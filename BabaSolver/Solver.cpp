@@ -1,37 +1,38 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
-#include <execution>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <mutex>
-#include <stack>
+#include <optional>
+#include <sstream>
 #include <string>
-#include <unordered_set>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "Endgame.h"
+#include "Estimate.h"
 #include "GameState.h"
+#include "Memory.h"
+#include "Shorten.h"
+#include "SolutionCache.h"
+#include "SolverSearch.h"
+#include "Timers.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "TranspositionTable.h"
 
 #include "Solver.h"
 
 namespace BabaSolver
 {
-	namespace
-	{
-		// A struct to describe a future move, with an initial state and a direction to apply on
-		// top of that state.
-		struct NextMove
-		{
-			std::shared_ptr<GameState> state;
-			Direction dir_to_apply;
-		};
-	}  // namespace
-
-	// Formats the given number with a suffix, e.g. 10,000,000 -> "10M".
-	static std::string FormatNumberWithSuffix(uint64_t n)
+	std::string detail::FormatNumberWithSuffix(uint64_t n)
 	{
 		if (n >= 1'000'000'000)
 			return std::to_string(n / 1'000'000'000) + "B";
@@ -55,281 +56,709 @@ namespace BabaSolver
 		return s;
 	}
 
-	// Tries to solve the level in one iteration given the initial state and options. Returns
-	// the winning state if it's possible to win in one iteration. Otherwise, returns the state
-	// with the highest score at the end of the iteration.
-	static std::shared_ptr<GameState> SolveOneIteration(
-		const std::shared_ptr<GameState>& initial_state, const SolverOptions& options)
-	{
-		std::cout << "Solving with initial state:\n";
-		initial_state->PrintGrid();
-
-		std::stack<NextMove> stack;
-		// Add the initial four directions to the stack.
-		stack.push(NextMove{ initial_state, Direction::UP });
-		stack.push(NextMove{ initial_state, Direction::RIGHT });
-		stack.push(NextMove{ initial_state, Direction::DOWN });
-		stack.push(NextMove{ initial_state, Direction::LEFT });
-		// This unordered_set acts a cache of previously computed game states. If we see a game
-		// state that we've already computed before, we don't compute that game state again,
-		// potentially pruning a large chunk of the move tree.
-		std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual> seen_states;
-		seen_states.insert(initial_state);
-
-		// TODO: Put all these stats variables in a struct.
-		uint64_t total_num_moves = 0;
-		uint64_t total_cache_hits = 0;
-		std::shared_ptr<GameState> winning_state;
-		// parallelism_roots stores the game states at which we will start the parallel
-		// algorithm (one thread per GameState in parallelism_roots).
-		std::vector<std::shared_ptr<GameState>> parallelism_roots;
-		auto start_time = std::chrono::high_resolution_clock::now();
-
-		while (!stack.empty())
-		{
-			++total_num_moves;
-			if (total_num_moves % options.print_every_n_moves == 0)
-			{
-				std::cout << "Calculating move #" << total_num_moves << " (" << FormatNumberWithSuffix(total_num_moves)
-					<< "), cache size = " << seen_states.size() << " (" << FormatNumberWithSuffix(seen_states.size())
-					<< "), stack size = " << stack.size() << std::endl;
-			}
+	// Formats the given number of bytes with a unit, e.g. 10,000,000 -> "9.5 MB".
+	static std::string FormatBytes(uint64_t bytes)
+	{
+		const char* units[] = { "bytes", "KB", "MB", "GB", "TB" };
+		double value = static_cast<double>(bytes);
+		int unit = 0;
+		while (value >= 1024.0 && unit < 4)
+		{
+			value /= 1024.0;
+			++unit;
+		}
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+		return out.str();
+	}
 
-			// Compute the new game state.
-			const NextMove& cur = stack.top();
-			std::shared_ptr<GameState> new_state = cur.state->ApplyMove(cur.dir_to_apply);
-			stack.pop();
+	// Formats the given duration for humans, e.g. 200 seconds -> "3m20s".
+	static std::string FormatDuration(std::chrono::nanoseconds duration)
+	{
+		int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+		if (seconds >= 3600)
+			return std::to_string(seconds / 3600) + "h" + std::to_string(seconds / 60 % 60) + "m";
+		if (seconds >= 60)
+			return std::to_string(seconds / 60) + "m" + std::to_string(seconds % 60) + "s";
+		return std::to_string(seconds) + "s";
+	}
 
-			// Check if we've won.
-			if (new_state->HaveWon())
-			{
-				std::cout << "WIN!!! Turn #" << static_cast<uint32_t>(new_state->_turn) << "\n";
-				winning_state = new_state;
-				break;
-			}
+	std::string detail::FormatProgress(uint64_t moves_done, double estimated_moves, std::chrono::nanoseconds elapsed)
+	{
+		if (estimated_moves <= 0.0 || moves_done == 0)
+			return "";
+		std::string progress = ", " + std::to_string(static_cast<int>(100.0 * moves_done / estimated_moves)) + "% of ~"
+			+ FormatNumberWithSuffix(static_cast<uint64_t>(estimated_moves)) + " estimated moves";
+		if (moves_done >= estimated_moves)
+			return progress + ", ETA unknown (past the estimate)";
+		auto remaining = std::chrono::nanoseconds(static_cast<int64_t>(elapsed.count() * (estimated_moves - moves_done) / moves_done));
+		return progress + ", ETA " + FormatDuration(remaining);
+	}
+
+	// How often the time and memory limits are checked (see Solver::MonitorLimits()).
+	static constexpr std::chrono::milliseconds LIMIT_CHECK_INTERVAL(10);
+	// The fraction of SolverOptions::memory_limit_bytes at which the caches stop growing. The rest
+	// is left for the stacks, the parallelism roots and the memory that the heap doesn't give back.
+	static constexpr double CACHE_FREEZE_MEMORY_FRACTION = 0.8;
+
+	// The estimated heap overhead of one allocation (the allocator's header and alignment padding).
+	static constexpr uint64_t ALLOCATION_OVERHEAD_BYTES = 16;
+	// The estimated heap usage of a GameState created with std::make_shared: the GameState and the
+	// shared_ptr control block, in one allocation.
+	static constexpr uint64_t GAME_STATE_BYTES = sizeof(GameState) + 16 + ALLOCATION_OVERHEAD_BYTES;
+	// The estimated heap usage of one node of a GameStateSet: the pointer to the next node, the
+	// shared_ptr, and the cached hash.
+	static constexpr uint64_t CACHE_NODE_BYTES = sizeof(void*) + sizeof(std::shared_ptr<GameState>) + sizeof(std::size_t)
+		+ ALLOCATION_OVERHEAD_BYTES;
+
+	uint64_t detail::EstimateCacheBytes(const GameStateSet& cache, std::size_t shared_state_count)
+	{
+		return cache.size() * CACHE_NODE_BYTES + cache.bucket_count() * sizeof(void*)
+			+ (cache.size() - shared_state_count) * GAME_STATE_BYTES;
+	}
+
+	void MemoryStats::Merge(const MemoryStats& other)
+	{
+		shared_cache_bytes = std::max(shared_cache_bytes, other.shared_cache_bytes);
+		max_local_cache_bytes = std::max(max_local_cache_bytes, other.max_local_cache_bytes);
+		max_stack_bytes = std::max(max_stack_bytes, other.max_stack_bytes);
+		roots_bytes = std::max(roots_bytes, other.roots_bytes);
+		uncached_states += other.uncached_states;
+		caches_frozen = caches_frozen || other.caches_frozen;
+		peak_rss_bytes = std::max(peak_rss_bytes, other.peak_rss_bytes);
+	}
 
-			if (new_state->_turn <= options.max_cache_depth)
+	uint64_t DepthStats::Survivors() const
+	{
+		return nodes_generated - cache_hits - pruned_dead_baba - pruned_text_region - pruned_transposition;
+	}
+
+	void DepthStats::Merge(const DepthStats& other)
+	{
+		nodes_generated += other.nodes_generated;
+		cache_hits += other.cache_hits;
+		pruned_dead_baba += other.pruned_dead_baba;
+		pruned_text_region += other.pruned_text_region;
+		pruned_transposition += other.pruned_transposition;
+		pruned_alignment += other.pruned_alignment;
+		noop_moves += other.noop_moves;
+		nodes_expanded += other.nodes_expanded;
+		leaves += other.leaves;
+		endgame_wins += other.endgame_wins;
+	}
+
+	DepthStats SolverStats::Totals() const
+	{
+		DepthStats totals;
+		for (const DepthStats& depth_stats : depths)
+		{
+			totals.Merge(depth_stats);
+		}
+		return totals;
+	}
+
+	double SolverStats::EffectiveBranchingFactor(int depth) const
+	{
+		if (depth <= 0 || depth > MAX_TURN_COUNT)
+			return 0.0;
+		uint64_t parent_count = depths[depth - 1].nodes_expanded;
+		if (parent_count == 0)
+			return 0.0;
+		return static_cast<double>(depths[depth].Survivors()) / parent_count;
+	}
+
+	void SolverStats::Merge(const SolverStats& other)
+	{
+		for (int i = 0; i <= MAX_TURN_COUNT; ++i)
+		{
+			depths[i].Merge(other.depths[i]);
+		}
+		cache_size += other.cache_size;
+		parallelism_root_count += other.parallelism_root_count;
+		iteration_count += other.iteration_count;
+		duration += other.duration;
+		estimated_nodes += other.estimated_nodes;
+		memory.Merge(other.memory);
+		phase_times.Merge(other.phase_times);
+		if (other.stop_reason != StopReason::NONE)
+			stop_reason = other.stop_reason;
+		reduced_depth_iterations += other.reduced_depth_iterations;
+		if (other.min_reduced_turn_depth != 0 && (min_reduced_turn_depth == 0 || other.min_reduced_turn_depth < min_reduced_turn_depth))
+			min_reduced_turn_depth = other.min_reduced_turn_depth;
+	}
+
+	const char* StopReasonName(StopReason reason)
+	{
+		switch (reason)
+		{
+		case StopReason::NONE:
+			return "not stopped";
+		case StopReason::CANCELLED:
+			return "cancelled";
+		case StopReason::TIME_LIMIT:
+			return "time limit";
+		case StopReason::MEMORY_LIMIT:
+			return "memory limit";
+		}
+		return "unknown";
+	}
+
+	bool detail::CheckIfPossibleToWinAndUpdateStats(const GameState& state, DepthStats& depth_stats, PhaseTimes& phase_times)
+	{
+		ScopedTimer timer(phase_times, TimedPhase::CHECK_IF_POSSIBLE_TO_WIN);
+		switch (state.CheckWhyImpossibleToWin())
+		{
+		case LossReason::NONE:
+			return true;
+		case LossReason::DEAD_BABA:
+			++depth_stats.pruned_dead_baba;
+			return false;
+		case LossReason::TEXT_OUT_OF_REGION:
+			++depth_stats.pruned_text_region;
+			return false;
+		}
+		// Should not be able to reach this point.
+		std::cerr << "Invalid LossReason in CheckIfPossibleToWinAndUpdateStats()" << std::endl;
+		std::abort();
+	}
+
+	std::shared_ptr<GameState> detail::ResolveEndgame(EndgameTablebase& tablebase, const GameState& state)
+	{
+		if (!state.BabasOnSameSpace() || state.HaveWon())
+			return nullptr;
+		std::optional<std::vector<Direction>> moves = tablebase.FindWin(state);
+		if (!moves || state._turn + moves->size() > static_cast<std::size_t>(MAX_TURN_COUNT))
+			return nullptr;
+		std::shared_ptr<GameState> won_state = state.ApplyMoves(*moves);
+		return won_state->HaveWon() ? won_state : nullptr;
+	}
+
+	// Prints a table of the per-depth stats to out.
+	static void PrintDepthStats(std::ostream& out, const SolverStats& stats)
+	{
+		out << "Per-depth stats:\n";
+		out << "  Depth  Generated  Cache hits  Dead Baba  Text region  Alignment  No-op  Expanded  Leaves  Branching\n";
+		for (int depth = 1; depth <= MAX_TURN_COUNT; ++depth)
+		{
+			const DepthStats& d = stats.depths[depth];
+			if (d.nodes_generated == 0)
+				continue;
+			out << "  " << std::setw(5) << depth << std::setw(11) << detail::FormatNumberWithSuffix(d.nodes_generated)
+				<< std::setw(12) << detail::FormatNumberWithSuffix(d.cache_hits) << std::setw(11) << detail::FormatNumberWithSuffix(d.pruned_dead_baba)
+				<< std::setw(13) << detail::FormatNumberWithSuffix(d.pruned_text_region) << std::setw(11) << detail::FormatNumberWithSuffix(d.pruned_alignment)
+				<< std::setw(7) << detail::FormatNumberWithSuffix(d.noop_moves) << std::setw(10) << detail::FormatNumberWithSuffix(d.nodes_expanded)
+				<< std::setw(8) << detail::FormatNumberWithSuffix(d.leaves) << std::setw(11) << std::fixed << std::setprecision(2)
+				<< stats.EffectiveBranchingFactor(depth) << std::defaultfloat << "\n";
+		}
+	}
+
+	bool detail::InsertIntoCache(GameStateSet& cache, const std::shared_ptr<GameState>& state, uint64_t budget_bytes, bool frozen,
+		std::size_t shared_state_count, MemoryStats& memory_stats, TraceBuffer* trace_buffer)
+	{
+		if (frozen || (budget_bytes != 0 && EstimateCacheBytes(cache, shared_state_count) >= budget_bytes))
+		{
+			if (cache.count(state) != 0)
+				return false;
+			++memory_stats.uncached_states;
+			return true;
+		}
+		if (trace_buffer == nullptr)
+			return cache.insert(state).second;
+		std::size_t bucket_count = cache.bucket_count();
+		auto start_time = std::chrono::steady_clock::now();
+		bool inserted = cache.insert(state).second;
+		if (cache.bucket_count() != bucket_count)
+		{
+			trace_buffer->AddSpan("Cache resize", "cache", start_time, std::chrono::steady_clock::now(),
+				{ { "size", cache.size() }, { "buckets", cache.bucket_count() } });
+		}
+		return inserted;
+	}
+
+	// Prints how much time was spent in each phase of the hot path to out.
+	static void PrintPhaseTimes(std::ostream& out, const PhaseTimes& phase_times)
+	{
+		double nanoseconds_per_tick = NanosecondsPerTick();
+		uint64_t search_ticks = phase_times.ticks[static_cast<int>(TimedPhase::SEARCH)];
+		uint64_t other_ticks = search_ticks;
+		out << "Time breakdown (summed across threads):\n";
+		out << "  Phase                        Calls   Time (ms)  % of search       ns/call\n";
+		for (int i = 0; i < TIMED_PHASE_COUNT; ++i)
+		{
+			uint64_t calls = phase_times.calls[i];
+			uint64_t ticks = phase_times.ticks[i];
+			if (static_cast<TimedPhase>(i) != TimedPhase::SEARCH)
+				other_ticks -= std::min(other_ticks, ticks);
+			out << "  " << std::left << std::setw(22) << TimedPhaseName(static_cast<TimedPhase>(i)) << std::right
+				<< std::setw(11) << detail::FormatNumberWithSuffix(calls) << std::setw(12) << std::fixed << std::setprecision(1)
+				<< ticks * nanoseconds_per_tick / 1e6 << std::setw(13)
+				<< (search_ticks == 0 ? 0.0 : 100.0 * ticks / search_ticks) << std::setw(14)
+				<< (calls == 0 ? 0.0 : ticks * nanoseconds_per_tick / calls) << std::defaultfloat << "\n";
+		}
+		out << "  " << std::left << std::setw(22) << "Other" << std::right << std::setw(11) << "" << std::setw(12)
+			<< std::fixed << std::setprecision(1) << other_ticks * nanoseconds_per_tick / 1e6 << std::setw(13)
+			<< (search_ticks == 0 ? 0.0 : 100.0 * other_ticks / search_ticks) << std::defaultfloat << "\n";
+	}
+
+	double Solver::PrepareIteration(int iteration, const std::shared_ptr<GameState>& initial_state, SolverOptions& options)
+	{
+		std::ostream& log = Log();
+		log << "Solving with initial state:\n";
+		initial_state->PrintGrid(log);
+
+		unsigned int expected_worker_count = ExpectedWorkerCount(options);
+		double estimated_moves = 0.0;
+		if (options.estimate_probe_count > 0)
+		{
+			TreeSizeEstimate estimate = EstimateTreeSize(initial_state, options, options.max_turn_depth);
+			if (options.time_limit.count() > 0)
 			{
-				// Check the cache and don't proceed if the new game state has already been
-				// computed before.
-				const auto inserted = seen_states.insert(new_state);
-				if (!inserted.second)
+				// Each iteration starts from the result of the last one, so the time that's left is
+				// shared evenly between the iterations that are left. The sequential portion
+				// doesn't check the max depth, so the search goes at least one move deeper than
+				// parallelism_depth.
+				auto time_left = options.time_limit - (std::chrono::steady_clock::now() - _search_start_time);
+				auto time_budget = time_left / std::max(1, options.iteration_count - iteration + 1);
+				int fitted_depth = std::max(options.parallelism_depth + 1,
+					SuggestDepths(estimate, time_budget, expected_worker_count).max_turn_depth);
+				if (fitted_depth < options.max_turn_depth)
 				{
-					++total_cache_hits;
-					continue;
+					log << "Reducing the max move depth from " << options.max_turn_depth << " to " << fitted_depth << " to fit in ~"
+						<< FormatDuration(time_budget) << " of the time limit" << std::endl;
+					options.max_turn_depth = fitted_depth;
 				}
 			}
+			estimated_moves = estimate.TotalNodes(options.max_turn_depth);
+			log << "Estimated number of moves: ~" << FormatNumberWithCommas(static_cast<uint64_t>(estimated_moves))
+				<< " (exact down to depth " << estimate.exact_depth << "), estimated time: ~"
+				<< FormatDuration(estimate.EstimatedDuration(options.max_turn_depth, expected_worker_count)) << std::endl;
+		}
+		return estimated_moves;
+	}
+
+	unsigned int Solver::ExpectedWorkerCount(const SolverOptions& options) const
+	{
+		return _thread_pool != nullptr ? _thread_pool->ThreadCount()
+			: options.thread_count != 0 ? options.thread_count : std::thread::hardware_concurrency();
+	}
+
+	void Solver::PrintIterationResults(const SolverOptions& options, const SolverStats& iteration_stats, double estimated_moves,
+		const std::shared_ptr<GameState>& result, bool won)
+	{
+		std::ostream& log = Log();
+		DepthStats totals = iteration_stats.Totals();
+
+		// Print results
+		log << "\n~~~ RESULTS ~~~\n";
+		if (_stopping)
+			log << "Stopped early (" << StopReasonName(_stop_reason) << ").\n";
+		if (won)
+		{
+			log << "WIN!!! Winning state:\n";
+			result->PrintGrid(log);
+			result->PrintMoves(log);
+		}
+		else
+		{
+			log << "Did not win...\n";
+			log << "Best leaf game state:\n";
+			result->PrintGrid(log);
+			result->PrintMoves(log);
+		}
+		log << "Config:\n";
+		log << "  Max move depth: " << options.max_turn_depth;
+		if (options.max_turn_depth < _options.max_turn_depth)
+			log << " (reduced from " << _options.max_turn_depth << " to fit in the time limit)";
+		log << "\n";
+		log << "  Parallelism depth: " << options.parallelism_depth << "\n";
+		log << "  Max cache depth: " << options.max_cache_depth << "\n";
+		log << "Stats:\n";
+		log << "  Total number of moves simulated (including cache hits): " << FormatNumberWithCommas(totals.nodes_generated) << "\n";
+		if (estimated_moves > 0.0)
+			log << "  Estimated number of moves: " << FormatNumberWithCommas(static_cast<uint64_t>(estimated_moves)) << "\n";
+		log << "  Cache size: " << FormatNumberWithCommas(iteration_stats.cache_size) << " moves\n";
+		log << "  Number of cache hits: " << FormatNumberWithCommas(totals.cache_hits) << "\n";
+		log << "  Number of unique, non-cached moves: " << FormatNumberWithCommas(totals.nodes_generated - totals.cache_hits) << "\n";
+		log << "  Number of parallel tree roots: " << FormatNumberWithCommas(iteration_stats.parallelism_root_count) << "\n";
+		log << "  Number of tree leaf game states: " << FormatNumberWithCommas(totals.leaves) << "\n";
+		log << "  Number of pruned game states: dead Baba = " << FormatNumberWithCommas(totals.pruned_dead_baba)
+			<< ", text region = " << FormatNumberWithCommas(totals.pruned_text_region)
+			<< ", transposition table = " << FormatNumberWithCommas(totals.pruned_transposition)
+			<< ", text alignment (leaves) = " << FormatNumberWithCommas(totals.pruned_alignment) << "\n";
+		log << "  Number of no-op moves: " << FormatNumberWithCommas(totals.noop_moves) << "\n";
+		if (options.max_endgame_tables != 0)
+			log << "  Number of endgames resolved by the tablebase: " << FormatNumberWithCommas(totals.endgame_wins) << "\n";
+		log << "  Total time: " << std::chrono::duration_cast<std::chrono::seconds>(iteration_stats.duration).count() << " seconds\n";
+		log << "  Time per move: " << (iteration_stats.duration.count() / std::max<uint64_t>(1, totals.nodes_generated)) << " nanoseconds\n";
+		const MemoryStats& memory = iteration_stats.memory;
+		log << "Memory (estimated):\n";
+		log << "  Shared cache: " << FormatBytes(memory.shared_cache_bytes) << "\n";
+		log << "  Largest thread-local cache: " << FormatBytes(memory.max_local_cache_bytes) << "\n";
+		log << "  Largest stack: " << FormatBytes(memory.max_stack_bytes) << "\n";
+		log << "  Parallelism roots: " << FormatBytes(memory.roots_bytes) << "\n";
+		if (options.max_cache_bytes != 0)
+		{
+			log << "  Game states not cached because of the " << FormatBytes(options.max_cache_bytes) << " cache budget: "
+				<< FormatNumberWithCommas(memory.uncached_states) << "\n";
+		}
+		if (memory.caches_frozen)
+		{
+			log << "  The caches stopped growing near the " << FormatBytes(options.memory_limit_bytes) << " memory limit ("
+				<< FormatNumberWithCommas(memory.uncached_states) << " game states not cached)\n";
+		}
+		log << "  Peak RSS: " << (memory.peak_rss_bytes == 0 ? "unknown" : FormatBytes(memory.peak_rss_bytes)) << "\n";
+		PrintDepthStats(log, iteration_stats);
+		if constexpr (TIMERS_ENABLED)
+			PrintPhaseTimes(log, iteration_stats.phase_times);
+		log << std::endl;
+	}
+
+	Solver::Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options)
+		: Solver(std::move(initial_state), options, WinGoal(), ScoreHeuristic())
+	{
+	}
 
-			// If it's impossible to win from this GameState, then prune that part of the tree.
-			if (!new_state->CheckIfPossibleToWin())
+	Solver::Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options, IterationFunction solve_iteration,
+		std::function<bool(const GameState& state)> is_goal, bool goal_is_win, bool heuristic_is_score)
+		: _initial_state(std::move(initial_state)), _options(options), _solve_iteration(std::move(solve_iteration)), _is_goal(std::move(is_goal)),
+		_goal_is_win(goal_is_win), _heuristic_is_score(heuristic_is_score), _callbacks(), _log(nullptr), _null_log(nullptr), _thread_pool(nullptr), _transposition_table(), _endgame_tablebase(), _thread(),
+		_started(false), _cancelled(false), _stopping(false), _stop_reason(StopReason::NONE), _caches_frozen(false), _search_start_time(), _finished(false), _mutex(), _finished_condition(), _stats(), _result()
+	{
+	}
+
+	Solver::~Solver()
+	{
+		Cancel();
+		if (_thread.joinable())
+			_thread.join();
+	}
+
+	void Solver::SetCallbacks(SolverCallbacks callbacks)
+	{
+		_callbacks = std::move(callbacks);
+	}
+
+	void Solver::SetLog(std::ostream* log)
+	{
+		_log = log;
+	}
+
+	void Solver::SetThreadPool(ThreadPool* thread_pool)
+	{
+		_thread_pool = thread_pool;
+	}
+
+	std::ostream& Solver::Log()
+	{
+		return _log != nullptr ? *_log : _null_log;
+	}
+
+	std::shared_ptr<GameState> Solver::Run()
+	{
+		MarkStarted();
+		return Search();
+	}
+
+	void Solver::Start()
+	{
+		MarkStarted();
+		_thread = std::thread([this]() { Search(); });
+	}
+
+	void Solver::MarkStarted()
+	{
+		if (_started)
+		{
+			std::cerr << "Solver::Run() or Solver::Start() was called twice" << std::endl;
+			std::abort();
+		}
+		_started = true;
+	}
+
+	std::shared_ptr<GameState> Solver::Search()
+	{
+		std::ostream& log = Log();
+		_search_start_time = std::chrono::steady_clock::now();
+		if (_options.max_turn_depth > MAX_TURN_COUNT)
+		{
+			log << "max_turn_depth must be less than MAX_TURN_COUNT (" << MAX_TURN_COUNT << ")" << std::endl;
+			Finish(nullptr);
+			return nullptr;
+		}
+
+		// A search from a winning game state (e.g. after a winning prefix, see SolveFrom()) would
+		// move away from the win.
+		if (_is_goal(*_initial_state))
+		{
+			log << (_goal_is_win ? "The initial game state has already won" : "The initial game state already reaches the goal") << std::endl;
+			if (_callbacks.on_solution)
+				_callbacks.on_solution(_initial_state);
+			Finish(_initial_state);
+			return _initial_state;
+		}
+
+		if (!_goal_is_win && (!_options.solution_cache_file.empty() || !_options.transposition_file.empty()))
+			log << "Not using the solution cache or the transposition table, since they only apply to wins" << std::endl;
+		else if (!_heuristic_is_score && !_options.solution_cache_file.empty())
+			log << "Not using the solution cache, since its results come from the default heuristic" << std::endl;
+		std::unique_ptr<SolutionCache> solution_cache = _options.solution_cache_file.empty() || !_goal_is_win || !_heuristic_is_score
+			? nullptr : std::make_unique<SolutionCache>(_options.solution_cache_file);
+		if (solution_cache)
+		{
+			std::shared_ptr<GameState> cached_state = ReplayCachedSolution(*solution_cache);
+			if (cached_state)
 			{
-				continue;
+				Finish(cached_state);
+				return cached_state;
 			}
+		}
+
+		// The table's entries say a game state can't win within some moves by searching alone,
+		// while the endgame tablebase may win from it past max_turn_depth.
+		if (!_options.transposition_file.empty() && _goal_is_win && _options.max_endgame_tables != 0)
+		{
+			log << "Not using the transposition table, since its entries don't count the wins from the endgame tablebase" << std::endl;
+		}
+		else if (!_options.transposition_file.empty() && _goal_is_win)
+		{
+			std::string error;
+			_transposition_table = TranspositionTable::Open(_options.transposition_file, _options.transposition_table_bytes, error);
+			if (_transposition_table)
+				log << "Using the transposition table " << _options.transposition_file << " (" << _transposition_table->Capacity() << " entries)" << std::endl;
+			else
+				log << error << ", so searching without a transposition table" << std::endl;
+		}
+
+		if (_options.max_endgame_tables != 0 && _goal_is_win)
+		{
+			_endgame_tablebase = std::make_unique<EndgameTablebase>(_options.max_endgame_tables);
+			log << "Using the endgame tablebase (up to " << _options.max_endgame_tables << " tables)" << std::endl;
+		}
+
+		std::atomic<bool> limits_done = false;
+		std::thread limits_thread;
+		if (_options.time_limit.count() > 0 || _options.memory_limit_bytes != 0)
+			limits_thread = std::thread([this, &limits_done]() { MonitorLimits(limits_done); });
 
-			// If we've reached parallelism_depth, then store the game state in parallelism_roots.
-			if (new_state->_turn >= options.parallelism_depth)
+		std::unique_ptr<TraceRecorder> trace = _options.trace_file.empty() ? nullptr : std::make_unique<TraceRecorder>();
+		std::shared_ptr<GameState> current_state = _initial_state;
+		CachedSolution solution;
+		bool reduced_depth = false;
+		for (int i = 0; i < _options.iteration_count && !_stopping; ++i)
+		{
+			log << "======== ITERATION " << (i + 1) << " ========" << std::endl;
+			TraceSpan iteration_span(trace ? trace->ThreadBuffer(0) : nullptr, "Iteration " + std::to_string(i + 1), "iteration");
+			// The caller's initial state and the states handed to the callbacks are never changed.
+			current_state = std::make_shared<GameState>(*current_state);
+			current_state->ResetContext();
+			SolverStats iteration_stats;
+			current_state = _solve_iteration(*this, i + 1, current_state, iteration_stats, trace.get());
+			reduced_depth = reduced_depth || iteration_stats.reduced_depth_iterations != 0;
+			solution.iteration_moves.emplace_back(current_state->_moves, current_state->_moves + current_state->_turn);
 			{
-				parallelism_roots.push_back(new_state);
-				continue;
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stats.Merge(iteration_stats);
+				_result = current_state;
 			}
+			if (_callbacks.on_iteration_finished)
+				_callbacks.on_iteration_finished(i + 1, current_state);
+			if (_is_goal(*current_state))
+			{
+				if (_callbacks.on_solution)
+					_callbacks.on_solution(current_state);
+				break;
+			}
+		}
+		limits_done = true;
+		if (limits_thread.joinable())
+			limits_thread.join();
+		{
+			// The search may have stopped before the first iteration.
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stats.stop_reason = _stop_reason;
+			_stats.memory.caches_frozen = _stats.memory.caches_frozen || _caches_frozen;
+		}
+		if (_stopping && _stop_reason != StopReason::CANCELLED)
+		{
+			log << "Reached the " << StopReasonName(_stop_reason) << ", so the result is the best game state found so far ("
+				<< (_is_goal(*current_state) ? "won" : "did not win") << ")" << std::endl;
+		}
+		if (trace)
+		{
+			if (trace->WriteToFile(_options.trace_file))
+				log << "Wrote trace to " << _options.trace_file << std::endl;
+			else
+				log << "Unable to write trace to " << _options.trace_file << std::endl;
+		}
+		// A stopped search may have stopped in the middle of an iteration, and a search with a
+		// reduced depth didn't search as deep as the options say, so their results aren't the ones
+		// the options would find.
+		if (solution_cache && !_stopping && !reduced_depth && !solution.iteration_moves.empty())
+		{
+			solution.won = current_state->HaveWon();
+			if (solution_cache->Store(*_initial_state, _options, solution))
+				log << "Saved the result to the solution cache " << solution_cache->Path() << std::endl;
+			else
+				log << "Unable to write the solution cache " << solution_cache->Path() << std::endl;
+		}
+		Finish(current_state);
+		return current_state;
+	}
 
-			// Add the next moves to the stack.
-			stack.push(NextMove{ new_state, Direction::UP });
-			stack.push(NextMove{ new_state, Direction::RIGHT });
-			stack.push(NextMove{ new_state, Direction::DOWN });
-			stack.push(NextMove{ new_state, Direction::LEFT });
-		}
-
-		std::size_t total_cache_size = seen_states.size();
-		uint64_t leaf_state_count = 0;
-		std::vector<std::shared_ptr<GameState>> best_leaf_states(parallelism_roots.size());
-		if (!winning_state)
-		{
-			std::mutex mutex;
-			uint16_t next_thread_id = 0;
-			uint16_t num_threads_finished = 0;
-			uint16_t total_num_threads = static_cast<uint16_t>(parallelism_roots.size());
-			std::cout << "Finished the sequential portion. Now parallelizing into " << total_num_threads << " threads." << std::endl;
-
-			// Use std::for_each with std::execution::par to parallelize the algorithm. You can
-			// think of it as one thread per element in parallelism_roots, but in reality it's more
-			// complicated than that. See
-			// https://en.cppreference.com/w/cpp/algorithm#Execution_policies for more details.
-			std::for_each(std::execution::par, parallelism_roots.begin(), parallelism_roots.end(),
-				[&options, &mutex, &seen_states, &winning_state, &total_num_moves, &total_cache_hits, &total_cache_size, &leaf_state_count, &best_leaf_states, &next_thread_id, &num_threads_finished, &total_num_threads](std::shared_ptr<GameState> state)
-				{
-					uint16_t thread_id = 0;
-					{
-						std::lock_guard<std::mutex> lock(mutex);
-						thread_id = next_thread_id++;
-					}
-
-					std::stack<NextMove> stack;
-					// Apply initial four directions to the stack.
-					stack.push(NextMove{ state, Direction::UP });
-					stack.push(NextMove{ state, Direction::RIGHT });
-					stack.push(NextMove{ state, Direction::DOWN });
-					stack.push(NextMove{ state, Direction::LEFT });
-
-					// Copy seen_states to make a thread-local cache.
-					std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual> local_seen_states = seen_states;
-					uint64_t num_moves = 0;
-					uint64_t num_cache_hits = 0;
-					uint64_t leaf_count = 0;
-					int best_score = std::numeric_limits<int>::min();
-					std::shared_ptr<GameState> best_leaf_state;
-
-					while (!stack.empty())
-					{
-						++num_moves;
-						if (num_moves % options.print_every_n_moves == 0)
-						{
-							// Lock the mutex so that print statements don't get jumbled.
-							std::lock_guard<std::mutex> lock(mutex);
-							std::cout << "Thread " << thread_id << ": Calculating move #" << num_moves << " (" << FormatNumberWithSuffix(num_moves)
-								<< "), cache size = " << local_seen_states.size() << " (" << FormatNumberWithSuffix(local_seen_states.size())
-								<< "), stack size = " << stack.size() << std::endl;
-						}
-
-						// Compute the new game state.
-						const NextMove& cur = stack.top();
-						std::shared_ptr<GameState> new_state = cur.state->ApplyMove(cur.dir_to_apply);
-						stack.pop();
-
-						// Check if we've won.
-						if (new_state->HaveWon())
-						{
-							std::lock_guard<std::mutex> lock(mutex);
-							std::cout << "WIN!!! Turn #" << static_cast<uint32_t>(new_state->_turn) << "\n";
-							winning_state = new_state;
-							best_leaf_state = new_state;
-							break;
-						}
-
-						if (new_state->_turn <= options.max_cache_depth)
-						{
-							// Check the cache and don't proceed if the new game state has already
-							// been computed before.
-							const auto inserted = local_seen_states.insert(new_state);
-							if (!inserted.second)
-							{
-								++num_cache_hits;
-								continue;
-							}
-						}
-
-						// If it's impossible to win from this GameState, then prune that part of
-						// the tree.
-						if (!new_state->CheckIfPossibleToWin())
-						{
-							continue;
-						}
-
-						// If we've reached max_turn_depth, then this game state is a leaf in the
-						// tree. Calculate the score of this game state and see if it's the best
-						// leaf state we've seen.
-						if (new_state->_turn >= options.max_turn_depth)
-						{
-							++leaf_count;
-							int score = new_state->CalculateScore();
-							if (score > best_score)
-							{
-								best_score = score;
-								best_leaf_state = new_state;
-							}
-							continue;
-						}
-
-						// Add the next moves to the stack.
-						stack.push(NextMove{ new_state, Direction::UP });
-						stack.push(NextMove{ new_state, Direction::RIGHT });
-						stack.push(NextMove{ new_state, Direction::DOWN });
-						stack.push(NextMove{ new_state, Direction::LEFT });
-					}
-
-					// Thread finished - print results.
-					{
-						std::lock_guard<std::mutex> lock(mutex);
-						uint16_t finished_thread_count = ++num_threads_finished;
-						total_num_moves += num_moves;
-						total_cache_hits += num_cache_hits;
-						total_cache_size += local_seen_states.size();
-						leaf_state_count += leaf_count;
-						best_leaf_states[thread_id] = best_leaf_state;
-						// Print inside the critical section so that print statements don't get jumbled.
-						std::cout << "Thread " << thread_id << " finished (" << finished_thread_count << "/" << total_num_threads << "): Moves="
-							<< FormatNumberWithSuffix(num_moves) << ", Cache=" << FormatNumberWithSuffix(local_seen_states.size()) << ", Leaves="
-							<< FormatNumberWithSuffix(leaf_count) << std::endl;
-					}
-				});
-		}
-
-		auto end_time = std::chrono::high_resolution_clock::now();
-		auto total_duration = end_time - start_time;
+	std::shared_ptr<GameState> Solver::ReplayCachedSolution(const SolutionCache& cache)
+	{
+		std::ostream& log = Log();
+		std::optional<CachedSolution> solution = cache.Find(*_initial_state, _options);
+		if (!solution)
+			return nullptr;
+		std::vector<std::shared_ptr<GameState>> end_states = ReplaySolution(_initial_state, *solution);
+		if (end_states.empty())
+		{
+			log << "The cached result in " << cache.Path() << " doesn't replay correctly, so searching instead" << std::endl;
+			return nullptr;
+		}
+		log << "Replayed the cached result in " << cache.Path() << (solution->won ? " (won)" : " (did not win)") << ":\n";
+		for (std::size_t i = 0; i < end_states.size(); ++i)
+		{
+			log << "Iteration " << (i + 1) << ": " << FormatMoves(*end_states[i]) << "\n";
+			if (_callbacks.on_iteration_finished)
+				_callbacks.on_iteration_finished(static_cast<int>(i + 1), end_states[i]);
+		}
+		std::shared_ptr<GameState> end_state = end_states.back();
+		end_state->PrintGrid(log);
+		log << std::flush;
+		if (end_state->HaveWon() && _callbacks.on_solution)
+			_callbacks.on_solution(end_state);
+		return end_state;
+	}
 
-		// Print results
-		std::cout << "\n~~~ RESULTS ~~~\n";
-		if (winning_state)
+	void Solver::Finish(const std::shared_ptr<GameState>& result)
+	{
 		{
-			std::cout << "WIN!!! Winning state:\n";
-			winning_state->PrintGrid();
-			winning_state->PrintMoves();
+			std::lock_guard<std::mutex> lock(_mutex);
+			_result = result;
+			_finished = true;
 		}
-		else
+		_finished_condition.notify_all();
+	}
+
+	std::shared_ptr<GameState> Solver::Wait()
+	{
+		if (_thread.joinable())
+			_thread.join();
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _result;
+	}
+
+	bool Solver::WaitFor(std::chrono::nanoseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _finished_condition.wait_for(lock, timeout, [this]() { return _finished.load(); });
+	}
+
+	void Solver::Cancel()
+	{
+		_cancelled = true;
+		Stop(StopReason::CANCELLED);
+	}
+
+	void Solver::Stop(StopReason reason)
+	{
+		// Only the first reason is kept.
+		StopReason expected = StopReason::NONE;
+		_stop_reason.compare_exchange_strong(expected, reason);
+		_stopping = true;
+	}
+
+	void Solver::MonitorLimits(const std::atomic<bool>& done)
+	{
+		uint64_t freeze_bytes = static_cast<uint64_t>(_options.memory_limit_bytes * CACHE_FREEZE_MEMORY_FRACTION);
+		while (!done && !_stopping)
 		{
-			std::cout << "Did not win...\n";
-			int best_score = std::numeric_limits<int>::min();
-			std::shared_ptr<GameState> best_leaf_state;
-			for (const std::shared_ptr<GameState>& leaf_state : best_leaf_states)
+			if (_options.time_limit.count() > 0 && std::chrono::steady_clock::now() - _search_start_time >= _options.time_limit)
 			{
-				int score = leaf_state->CalculateScore();
-				if (score > best_score)
+				Stop(StopReason::TIME_LIMIT);
+				break;
+			}
+			if (_options.memory_limit_bytes != 0)
+			{
+				// Once frozen, the caches stay frozen for the rest of the search, since the heap
+				// may not give the memory of freed caches back to the OS.
+				uint64_t rss_bytes = GetCurrentRssBytes();
+				if (rss_bytes >= freeze_bytes)
+					_caches_frozen = true;
+				if (rss_bytes >= _options.memory_limit_bytes)
 				{
-					best_score = score;
-					best_leaf_state = leaf_state;
+					Stop(StopReason::MEMORY_LIMIT);
+					break;
 				}
 			}
-			std::cout << "Best leaf game state:\n";
-			best_leaf_state->PrintGrid();
-			best_leaf_state->PrintMoves();
-			winning_state = best_leaf_state;
-		}
-		std::cout << "Config:\n";
-		std::cout << "  Max move depth: " << options.max_turn_depth << "\n";
-		std::cout << "  Parallelism depth: " << options.parallelism_depth << "\n";
-		std::cout << "  Max cache depth: " << options.max_cache_depth << "\n";
-		std::cout << "Stats:\n";
-		std::cout << "  Total number of moves simulated (including cache hits): " << FormatNumberWithCommas(total_num_moves) << "\n";
-		std::cout << "  Cache size: " << FormatNumberWithCommas(total_cache_size) << " moves\n";
-		std::cout << "  Number of cache hits: " << FormatNumberWithCommas(total_cache_hits) << "\n";
-		std::cout << "  Number of unique, non-cached moves: " << FormatNumberWithCommas(total_num_moves - total_cache_hits) << "\n";
-		std::cout << "  Number of parallel tree roots: " << FormatNumberWithCommas(parallelism_roots.size()) << "\n";
-		std::cout << "  Number of tree leaf game states: " << FormatNumberWithCommas(leaf_state_count) << "\n";
-		std::cout << "  Total time: " << std::chrono::duration_cast<std::chrono::seconds>(total_duration).count() << " seconds\n";
-		std::cout << "  Time per move: " << (total_duration.count() / total_num_moves) << " nanoseconds\n";
-		std::cout << std::endl;
-
-		return winning_state;
-	}
-
-	std::shared_ptr<GameState> Solve(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options)
-	{
-		if (options.max_turn_depth > MAX_TURN_COUNT)
-		{
-			std::cout << "max_turn_depth must be less than MAX_TURN_COUNT (" << MAX_TURN_COUNT << ")" << std::endl;
-			return nullptr;
+			std::this_thread::sleep_for(LIMIT_CHECK_INTERVAL);
 		}
+	}
 
-		std::shared_ptr<GameState> current_state = initial_state;
-		for (int i = 0; i < options.iteration_count; ++i)
+	bool Solver::IsFinished() const
+	{
+		return _finished;
+	}
+
+	bool Solver::WasCancelled() const
+	{
+		return _cancelled;
+	}
+
+	StopReason Solver::GetStopReason() const
+	{
+		return _stop_reason;
+	}
+
+	SolverStats Solver::Stats() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+
+	std::shared_ptr<GameState> Solve(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, SolverStats* stats)
+	{
+		Solver solver(initial_state, options);
+		solver.SetLog(&std::cout);
+		std::shared_ptr<GameState> end_state = solver.Run();
+		if (stats != nullptr)
+			*stats = solver.Stats();
+		return end_state;
+	}
+
+	std::shared_ptr<GameState> ReplayPrefix(const std::shared_ptr<GameState>& level, const std::vector<Direction>& move_prefix,
+		std::string& error)
+	{
+		// The game is over once it's won, so the moves after a win would never be applied.
+		std::shared_ptr<GameState> state = ReplayMoves(level, {});
+		for (std::size_t i = 0; i < move_prefix.size(); ++i)
 		{
-			std::cout << "======== ITERATION " << (i + 1) << " ========" << std::endl;
-			current_state->ResetContext();
-			current_state = SolveOneIteration(current_state, options);
-			if (current_state->HaveWon())
-				break;
+			if (state->HaveWon())
+			{
+				error = "The moves " + FormatMoves(move_prefix) + " go on after the win at move " + std::to_string(i);
+				return nullptr;
+			}
+			state = ReplayMoves(state, { move_prefix[i] });
 		}
-		return current_state;
+		LossReason loss_reason = state->CheckWhyImpossibleToWin();
+		if (loss_reason != LossReason::NONE)
+		{
+			error = "The level can't be won after the moves " + FormatMoves(move_prefix)
+				+ (loss_reason == LossReason::DEAD_BABA ? " (a Baba is dead)" : " (a text block left the region from which the level can be won)");
+			return nullptr;
+		}
+		return state;
+	}
+
+	std::shared_ptr<GameState> SolveFrom(const std::shared_ptr<GameState>& level, const std::vector<Direction>& move_prefix,
+		const SolverOptions& options, std::string& error, SolverStats* stats)
+	{
+		std::shared_ptr<GameState> start_state = ReplayPrefix(level, move_prefix, error);
+		if (!start_state)
+			return nullptr;
+		return Solve(start_state, options, stats);
 	}
 
 	std::shared_ptr<GameState> SolveFloatiestPlatforms(const SolverOptions& options)
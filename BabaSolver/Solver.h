@@ -20,13 +20,31 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "GameState.h"
+#include "Goal.h"
+#include "Timers.h"
 
 namespace BabaSolver
 {
+	class EndgameTablebase;
+	class SolutionCache;
+	class ThreadPool;
+	class TraceRecorder;
+	class TranspositionTable;
+
 	// Options to use when running the Baba Is You solver.
 	// Use these options to trade off CPU usage, memory usage, thread usage, and time to complete.
 	struct SolverOptions
@@ -44,18 +62,417 @@ namespace BabaSolver
 		// The max depth in the move tree at which to cache game states. A higher value trades CPU
 		// usage for memory usage.
 		int max_cache_depth;
-		// How often (in number of moves) to print a debug log to stdout.
+		// The max estimated size in bytes of the caches, or 0 for no limit. Once a cache reaches
+		// its budget, new game states are no longer added to it (the search continues without
+		// caching them, which costs CPU time instead of memory). The sequential portion of the
+		// algorithm gets the whole budget, and the budget is split evenly between the worker
+		// threads' caches in the parallel portion.
+		uint64_t max_cache_bytes;
+		// How many worker threads to use for the multi-threaded portion of the algorithm. 0 means
+		// one thread per hardware thread.
+		unsigned int thread_count;
+		// How often (in number of moves) to print a debug log and report progress (see
+		// SolverCallbacks::on_progress).
 		uint64_t print_every_n_moves;
+		// How many random probes to use to estimate the size of the move tree before each
+		// iteration (see Estimate.h). The estimate is used to print an ETA in the debug logs. 0
+		// disables the estimate.
+		int estimate_probe_count;
+		// If not empty, a timeline of what each thread was doing is written to this file in the
+		// Chrome trace event format (see Trace.h).
+		std::string trace_file;
+		// If not empty, results are looked up in and saved to this file (see SolutionCache.h). A
+		// cached result is replayed to check it before it's returned instead of searching.
+		std::string solution_cache_file;
+		// If not empty, game states that are known not to lead to a win are recorded in and looked
+		// up in a memory-mapped table in this file, which is kept between runs (see
+		// TranspositionTable.h).
+		std::string transposition_file;
+		// The size of the transposition table if transposition_file doesn't exist yet. An existing
+		// file keeps its size.
+		uint64_t transposition_table_bytes;
+		// If true, finding a win doesn't end the iteration: the search goes on to look for shorter
+		// wins, and each shorter win and each better leaf game state is logged (and reported with
+		// SolverCallbacks) as soon as a thread finds it. An anytime search can take longer than a
+		// normal one, so it's meant to be stopped at a deadline with Solver::Cancel(), which
+		// returns the shortest win (or the best leaf game state) found so far.
+		bool anytime;
+		// The max wall-clock time of the whole search (all iterations), or 0 for no limit. Each
+		// iteration gets an equal share of the time that's left, and its max_turn_depth is reduced
+		// if the tree size estimate says it won't fit in its share (this needs
+		// estimate_probe_count > 0). At the limit, the search stops and returns the best game
+		// state found so far.
+		std::chrono::nanoseconds time_limit;
+		// The max resident set size of the process in bytes, or 0 for no limit. Once the process
+		// uses most of it, no more game states are added to the caches (as if they were at
+		// max_cache_bytes). At the limit, the search stops and returns the best game state found
+		// so far, instead of running until the OS kills the process. The resident set size
+		// includes the pages of the transposition table that are in memory.
+		uint64_t memory_limit_bytes;
+		// The max number of endgame tables to compute, or 0 to not use the endgame tablebase. Once
+		// the Babas are on the same space, the search looks up the moves that push the key onto
+		// the door in the table of the game state's arrangement (see Endgame.h) instead of
+		// searching them move by move, so a win may be found past max_turn_depth. Only used with
+		// the default goal of winning. The transposition table isn't used with the tablebase,
+		// since it records game states that can't win by searching alone.
+		int max_endgame_tables;
 
 		// Initializes this object with reasonable defaults.
-		SolverOptions() : iteration_count(4), max_turn_depth(25), parallelism_depth(2), max_cache_depth(20), print_every_n_moves(10'000'000) {}
+		SolverOptions() : iteration_count(4), max_turn_depth(25), parallelism_depth(2), max_cache_depth(20), max_cache_bytes(0), thread_count(0), print_every_n_moves(10'000'000), estimate_probe_count(1000), trace_file(), solution_cache_file(), transposition_file(), transposition_table_bytes(1024ull * 1024 * 1024), anytime(false), time_limit(0), memory_limit_bytes(0), max_endgame_tables(0) {}
+	};
+
+	// Statistics for one depth (turn count) of the move tree.
+	struct DepthStats
+	{
+		// How many game states were generated at this depth (including cache hits).
+		uint64_t nodes_generated = 0;
+		// How many generated game states were already in the cache.
+		uint64_t cache_hits = 0;
+		// How many game states were pruned because a Baba died.
+		uint64_t pruned_dead_baba = 0;
+		// How many game states were pruned because a text block left the region from which the
+		// level can still be won.
+		uint64_t pruned_text_region = 0;
+		// How many game states were pruned because the transposition table says they can't lead to
+		// a win in the moves that are left (see SolverOptions::transposition_file).
+		uint64_t pruned_transposition = 0;
+		// How many leaf game states had text blocks that can't be aligned with the rock bridge.
+		// These states aren't pruned, but they get a very low score.
+		uint64_t pruned_alignment = 0;
+		// How many moves didn't change the game state (e.g. both Babas walked into a wall). These
+		// moves aren't pruned because the cache doesn't consider game states at different turn
+		// counts to be equal.
+		uint64_t noop_moves = 0;
+		// How many game states had their next moves added to the stack.
+		uint64_t nodes_expanded = 0;
+		// How many game states were leaves of the move tree (i.e. reached max_turn_depth).
+		uint64_t leaves = 0;
+		// How many game states were resolved with the moves to the win from the endgame tablebase
+		// (see SolverOptions::max_endgame_tables).
+		uint64_t endgame_wins = 0;
+
+		// Returns how many game states survived the cache and pruning checks.
+		uint64_t Survivors() const;
+
+		// Adds the counts from other to this object.
+		void Merge(const DepthStats& other);
+	};
+
+	// Estimated memory usage of the solver's data structures. The estimates include the game states
+	// owned by each structure and the heap allocator's per-allocation overhead, so they're close to
+	// the memory actually used, but they're still estimates: see peak_rss_bytes for the real peak.
+	struct MemoryStats
+	{
+		// Estimated bytes used by the cache of the sequential portion of the algorithm (which each
+		// worker thread copies and keeps alive until the end of the iteration).
+		uint64_t shared_cache_bytes = 0;
+		// Estimated bytes used by the largest thread-local cache in the parallel portion. At most
+		// one thread-local cache per worker thread exists at a time.
+		uint64_t max_local_cache_bytes = 0;
+		// Estimated bytes used by the largest stack of next moves.
+		uint64_t max_stack_bytes = 0;
+		// Estimated bytes used by the list of parallelism roots.
+		uint64_t roots_bytes = 0;
+		// How many game states weren't cached because the cache was at its budget (see
+		// SolverOptions::max_cache_bytes) or the caches were frozen near the memory limit.
+		uint64_t uncached_states = 0;
+		// True if the caches stopped growing because the process got close to
+		// SolverOptions::memory_limit_bytes.
+		bool caches_frozen = false;
+		// The peak resident set size of the process at the end of the run, or 0 if unknown.
+		uint64_t peak_rss_bytes = 0;
+
+		// Combines other with this object, taking the max of the sizes and the sum of the counts.
+		void Merge(const MemoryStats& other);
+	};
+
+	// Why a search stopped before searching everything that its options asked for.
+	enum class StopReason
+	{
+		// The search wasn't stopped.
+		NONE,
+		// Solver::Cancel() was called.
+		CANCELLED,
+		// The search reached SolverOptions::time_limit.
+		TIME_LIMIT,
+		// The process reached SolverOptions::memory_limit_bytes.
+		MEMORY_LIMIT,
+	};
+
+	// Returns a short description of reason, e.g. "time limit".
+	const char* StopReasonName(StopReason reason);
+
+	// Statistics for a solver run. Each thread collects its own SolverStats, and the results are
+	// merged after all threads have finished, so no synchronization is needed while searching.
+	struct SolverStats
+	{
+		// Per-depth statistics, indexed by the turn count of the game states. Turn counts are
+		// relative to the initial state of each iteration.
+		std::array<DepthStats, MAX_TURN_COUNT + 1> depths{};
+		// How many game states were stored in the caches (summed across all threads).
+		uint64_t cache_size = 0;
+		// How many game states the parallel portion of the algorithm started from.
+		uint64_t parallelism_root_count = 0;
+		// How many iterations were run.
+		int iteration_count = 0;
+		// How long the solver ran for.
+		std::chrono::nanoseconds duration{};
+		// The number of game states that the tree size estimate predicted would be generated
+		// (summed across iterations), or 0 if the estimate is disabled.
+		double estimated_nodes = 0.0;
+		// Estimated memory usage.
+		MemoryStats memory;
+		// Why the search stopped early, if it did.
+		StopReason stop_reason = StopReason::NONE;
+		// How many iterations searched less deep than SolverOptions::max_turn_depth to fit in
+		// SolverOptions::time_limit, and the shallowest max_turn_depth that was used (0 if none).
+		int reduced_depth_iterations = 0;
+		int min_reduced_turn_depth = 0;
+		// Time spent in each phase of the hot path (summed across all threads). Only collected if
+		// the timers are enabled (see Timers.h).
+		PhaseTimes phase_times;
+
+		// Returns the sum of the per-depth statistics.
+		DepthStats Totals() const;
+
+		// Returns the average number of surviving game states at the given depth per game state
+		// expanded at depth - 1. This is how fast the move tree actually grows after pruning and
+		// caching (at most 4).
+		double EffectiveBranchingFactor(int depth) const;
+
+		// Adds the statistics from other to this object.
+		void Merge(const SolverStats& other);
+	};
+
+	// The progress of a running search, passed to SolverCallbacks::on_progress.
+	struct SolverProgress
+	{
+		// The current iteration, starting at 1.
+		int iteration = 0;
+		// How many moves all threads have simulated in this iteration so far. Worker threads only
+		// report their moves every SolverOptions::print_every_n_moves moves, so this lags behind a
+		// little.
+		uint64_t moves_done = 0;
+		// The estimated number of moves of this iteration, or 0 if the estimate is disabled.
+		double estimated_moves = 0.0;
+		// The time since the iteration started.
+		std::chrono::nanoseconds elapsed{};
+	};
+
+	// Functions that a Solver calls while it runs. Any of them may be empty. They are called from
+	// the solver's threads (not necessarily the thread that started the solver), but never
+	// concurrently, and they should return quickly since a worker thread waits for them.
+	struct SolverCallbacks
+	{
+		// Called about every SolverOptions::print_every_n_moves moves on each thread.
+		std::function<void(const SolverProgress& progress)> on_progress;
+		// Called when a leaf game state scores higher than every leaf found earlier in the same
+		// iteration. The score is determined by the solver's heuristic (GameState::CalculateScore()
+		// by default).
+		std::function<void(const std::shared_ptr<GameState>& state, int score)> on_best_leaf;
+		// Called at the end of each iteration with the game state that the next iteration starts
+		// from (the winning game state, or the best leaf game state).
+		std::function<void(int iteration, const std::shared_ptr<GameState>& state)> on_iteration_finished;
+		// Called once if a winning game state is found (or one that reaches the solver's goal, see
+		// Goal.h).
+		std::function<void(const std::shared_ptr<GameState>& state)> on_solution;
+		// Called in anytime mode (see SolverOptions::anytime) when a winning game state is found
+		// that takes fewer moves than the ones found earlier in the same iteration. The moves of
+		// state are relative to the start of the iteration.
+		std::function<void(const std::shared_ptr<GameState>& state)> on_shorter_win;
+	};
+
+	// Solves a level in the background or on the calling thread, for embedding the solver in other
+	// programs. Nothing is printed unless a log stream is set with SetLog().
+	//
+	// Example:
+	//   Solver solver(initial_state, options);
+	//   solver.SetCallbacks(callbacks);
+	//   solver.Start();
+	//   ...
+	//   std::shared_ptr<GameState> result = solver.Wait();
+	//
+	// By default the solver searches for a win and continues from the leaf game state with the
+	// best GameState::CalculateScore(). The template constructor (see SolverSearch.h) takes
+	// another goal and heuristic instead (see Goal.h).
+	class Solver
+	{
+	public:
+		Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options);
+		// Searches for a game state that reaches goal, continuing from the leaf game state that
+		// heuristic scores the highest. Defined in SolverSearch.h, which must be included to use
+		// it. The solution cache is only used with the default goal and heuristic, and the
+		// transposition table only with the default goal, since their results are about wins.
+		template <typename Goal, typename Heuristic = ScoreHeuristic>
+		Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options, Goal goal, Heuristic heuristic = Heuristic());
+		// Cancels the search if it's still running and waits for it to stop.
+		~Solver();
+		Solver(const Solver&) = delete;
+		Solver& operator=(const Solver&) = delete;
+
+		// Sets the callbacks. Must be called before Start() or Run().
+		void SetCallbacks(SolverCallbacks callbacks);
+
+		// Sets the stream to print the debug logs and results to, or null to print nothing (the
+		// default). Must be called before Start() or Run(). The stream must outlive the search.
+		void SetLog(std::ostream* log);
+
+		// Runs the parallel portion of the search on thread_pool instead of on threads started
+		// for each iteration, or on its own threads if thread_pool is null (the default). The
+		// pool's thread count replaces SolverOptions::thread_count. Must be called before Start()
+		// or Run(). The pool must outlive the search.
+		void SetThreadPool(ThreadPool* thread_pool);
+
+		// Searches on the calling thread and returns the result (see Solve()). Returns null if the
+		// options are invalid. May only be called once, and not together with Start().
+		std::shared_ptr<GameState> Run();
+
+		// Starts Run() on a background thread and returns right away.
+		void Start();
+
+		// Waits for the search started by Start() to finish and returns its result.
+		std::shared_ptr<GameState> Wait();
+
+		// Waits for the search started by Start() to finish for at most timeout. Returns true if it
+		// finished.
+		bool WaitFor(std::chrono::nanoseconds timeout);
+
+		// Asks the search to stop as soon as possible. Can be called from any thread. A cancelled
+		// search returns the best game state found before it stopped.
+		void Cancel();
+
+		// Returns true once the search has finished (including when it was cancelled).
+		bool IsFinished() const;
+
+		// Returns true if Cancel() was called.
+		bool WasCancelled() const;
+
+		// Returns why the search stopped early, or StopReason::NONE if it didn't (yet). Can be
+		// called from any thread.
+		StopReason GetStopReason() const;
+
+		// Returns the statistics of the iterations that have finished so far. Can be called from
+		// any thread.
+		SolverStats Stats() const;
+
+	private:
+		// Runs one iteration of the search with the solver's goal and heuristic (see
+		// SolveOneIteration()).
+		using IterationFunction = std::function<std::shared_ptr<GameState>(Solver& solver, int iteration,
+			const std::shared_ptr<GameState>& initial_state, SolverStats& iteration_stats, TraceRecorder* trace)>;
+
+		// Called by the public constructors. is_goal is the type-erased goal, for the checks
+		// outside of the search's hot loop.
+		Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options, IterationFunction solve_iteration,
+			std::function<bool(const GameState& state)> is_goal, bool goal_is_win, bool heuristic_is_score);
+
+		// Aborts if the search was already started.
+		void MarkStarted();
+
+		// Runs all the iterations and records the result.
+		std::shared_ptr<GameState> Search();
+
+		// Replays the result for this level in the solution cache, calling the callbacks as if it
+		// had been searched. Returns null if there is no cached result or it isn't valid.
+		std::shared_ptr<GameState> ReplayCachedSolution(const SolutionCache& cache);
+
+		// Records the result, marks the search as finished, and wakes up WaitFor().
+		void Finish(const std::shared_ptr<GameState>& result);
+
+		// Stops the search as soon as possible for the given reason, unless it's already stopping.
+		void Stop(StopReason reason);
+
+		// Checks the time and memory limits (see SolverOptions::time_limit and
+		// SolverOptions::memory_limit_bytes) every few milliseconds until done is set, freezing the
+		// caches or stopping the search when they're reached.
+		void MonitorLimits(const std::atomic<bool>& done);
+
+		// Runs one iteration from initial_state and adds its statistics to iteration_stats. Returns
+		// the game state that reached goal if one was found, otherwise the leaf game state that
+		// heuristic scores the highest (or initial_state if the search was cancelled before
+		// reaching any leaf). Defined in SolverSearch.h.
+		template <typename Goal, typename Heuristic>
+		std::shared_ptr<GameState> SolveOneIteration(const Goal& goal, const Heuristic& heuristic, int iteration,
+			const std::shared_ptr<GameState>& initial_state, SolverStats& iteration_stats, TraceRecorder* trace);
+
+		// Prints the initial game state of an iteration, estimates the size of its move tree, and
+		// reduces options.max_turn_depth to fit in the time limit. Returns the estimated number of
+		// moves, or 0 if the estimate is disabled.
+		double PrepareIteration(int iteration, const std::shared_ptr<GameState>& initial_state, SolverOptions& options);
+
+		// Returns how many worker threads the parallel portion of the search can use.
+		unsigned int ExpectedWorkerCount(const SolverOptions& options) const;
+
+		// Prints the result and statistics of an iteration. won is true if result reached the
+		// goal.
+		void PrintIterationResults(const SolverOptions& options, const SolverStats& iteration_stats, double estimated_moves,
+			const std::shared_ptr<GameState>& result, bool won);
+
+		// Returns the log stream, or a stream that discards everything if there is none.
+		std::ostream& Log();
+
+		std::shared_ptr<GameState> _initial_state;
+		SolverOptions _options;
+		IterationFunction _solve_iteration;
+		std::function<bool(const GameState& state)> _is_goal;
+		// False for a custom goal or heuristic, in which case the transposition table or the
+		// solution cache aren't used.
+		bool _goal_is_win;
+		bool _heuristic_is_score;
+		SolverCallbacks _callbacks;
+		std::ostream* _log;
+		std::ostream _null_log;
+		ThreadPool* _thread_pool;
+		// Opened at the start of the search if SolverOptions::transposition_file is set.
+		std::unique_ptr<TranspositionTable> _transposition_table;
+		// Created at the start of the search if SolverOptions::max_endgame_tables isn't 0.
+		std::unique_ptr<EndgameTablebase> _endgame_tablebase;
+		std::thread _thread;
+		bool _started;
+		std::atomic<bool> _cancelled;
+		// Set by Cancel() or when a limit is reached. The search threads check this instead of
+		// _cancelled.
+		std::atomic<bool> _stopping;
+		std::atomic<StopReason> _stop_reason;
+		// Set when the process gets close to SolverOptions::memory_limit_bytes. Game states are no
+		// longer added to the caches after this.
+		std::atomic<bool> _caches_frozen;
+		std::chrono::steady_clock::time_point _search_start_time;
+		std::atomic<bool> _finished;
+		// Guards _stats and _result, and the change of _finished for _finished_condition.
+		mutable std::mutex _mutex;
+		std::condition_variable _finished_condition;
+		SolverStats _stats;
+		std::shared_ptr<GameState> _result;
 	};
 
 	// Tries to solve the level given the initial state and options. Returns the winning game state
 	// if achieveable with the given options, otherwise returns the game state with the best score
 	// at the end of the last iteration. The score is determined by GameState::CalculateScore().
-	// See SolverOptions for options that can be tuned for better performance.
-	std::shared_ptr<GameState> Solve(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options);
+	// See SolverOptions for options that can be tuned for better performance. If stats is not
+	// null, it is filled with the statistics of all iterations. The debug logs and results are
+	// printed to stdout; use the Solver class directly for a quiet search.
+	std::shared_ptr<GameState> Solve(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, SolverStats* stats = nullptr);
+
+	// Same as Solve(), but searches for a game state that reaches goal, continuing from the leaf
+	// game state that heuristic scores the highest (see Goal.h). Defined in SolverSearch.h.
+	template <typename Goal, typename Heuristic = ScoreHeuristic>
+	std::shared_ptr<GameState> SolveFor(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, Goal goal,
+		Heuristic heuristic = Heuristic(), SolverStats* stats = nullptr);
+
+	// Returns the game state after applying move_prefix to level, with its move history reset so
+	// that a search can start from it. move_prefix may be longer than MAX_TURN_COUNT. Returns null
+	// and sets error if move_prefix goes on after a win (the game doesn't apply those moves), or if
+	// the level can't be won from that game state.
+	std::shared_ptr<GameState> ReplayPrefix(const std::shared_ptr<GameState>& level, const std::vector<Direction>& move_prefix,
+		std::string& error);
+
+	// Calls Solve() from the game state after applying move_prefix to level (see ReplayPrefix()),
+	// so that a promising partial solution can be continued without searching its moves again. The
+	// moves of the returned game state are relative to the end of the prefix. Returns null and sets
+	// error if ReplayPrefix() rejects the prefix; nothing is printed then.
+	std::shared_ptr<GameState> SolveFrom(const std::shared_ptr<GameState>& level, const std::vector<Direction>& move_prefix,
+		const SolverOptions& options, std::string& error, SolverStats* stats = nullptr);
 
 	// Calls Solve() with the Floatiest Platforms level.
 	std::shared_ptr<GameState> SolveFloatiestPlatforms(const SolverOptions& options);
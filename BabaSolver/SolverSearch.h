@@ -0,0 +1,643 @@
+// The search of the Solver class, as templates over its goal and heuristic (see Goal.h).
+//
+// The goal is checked for every move and the heuristic for every leaf, so they are template
+// parameters that the compiler can inline into the search's hot loop, instead of calls through a
+// function pointer. Only the template constructor picks the goal and heuristic; the rest of the
+// solver calls the search through one type-erased function per iteration. Include this header
+// (instead of Solver.h) to construct a Solver with a custom goal or to call SolveFor().
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stack>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Endgame.h"
+#include "GameState.h"
+#include "Goal.h"
+#include "Memory.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+#include "Timers.h"
+#include "Trace.h"
+#include "TranspositionTable.h"
+
+namespace BabaSolver
+{
+	// Helpers of the search, defined in Solver.cpp.
+	namespace detail
+	{
+		using GameStateSet = std::unordered_set<std::shared_ptr<GameState>, GameStateHash, GameStateEqual>;
+
+		// A struct to describe a future move, with an initial state and a direction to apply on
+		// top of that state.
+		struct NextMove
+		{
+			std::shared_ptr<GameState> state;
+			Direction dir_to_apply;
+		};
+
+		// How often (in number of moves) each thread checks whether the search was cancelled.
+		inline constexpr uint64_t CANCEL_CHECK_INTERVAL = 1024;
+
+		// Formats the given number with a suffix, e.g. 10,000,000 -> "10M".
+		std::string FormatNumberWithSuffix(uint64_t n);
+
+		// Returns the progress of the search compared with the tree size estimate, for the debug
+		// logs, e.g. ", 42% of ~1B estimated moves, ETA 3m20s". Returns an empty string if there is
+		// no estimate. The ETA assumes that the rest of the search runs as fast as the search so
+		// far.
+		std::string FormatProgress(uint64_t moves_done, double estimated_moves, std::chrono::nanoseconds elapsed);
+
+		// Returns the estimated heap usage of cache, including the game states that only this cache
+		// references. The first shared_state_count game states in the cache were copied from
+		// another cache, so only the nodes pointing to them are counted.
+		uint64_t EstimateCacheBytes(const GameStateSet& cache, std::size_t shared_state_count);
+
+		// Same as GameState::CheckIfPossibleToWin(), but also counts the reason for pruning the
+		// game state in depth_stats and times the check in phase_times.
+		bool CheckIfPossibleToWinAndUpdateStats(const GameState& state, DepthStats& depth_stats, PhaseTimes& phase_times);
+
+		// If the Babas are on the same space in state and tablebase has the moves to the win,
+		// returns the winning game state after them. Otherwise (or if they would go past
+		// MAX_TURN_COUNT) returns null. The moves may go deeper than max_turn_depth.
+		std::shared_ptr<GameState> ResolveEndgame(EndgameTablebase& tablebase, const GameState& state);
+
+		// Inserts state into cache and returns true if it wasn't already there. If the cache has
+		// reached budget_bytes (0 means no budget) or frozen is true, state is only looked up, not
+		// inserted. See EstimateCacheBytes() for shared_state_count. If the insert makes the cache
+		// grow its bucket array (which rehashes every game state in the cache), records a "Cache
+		// resize" span in trace_buffer.
+		bool InsertIntoCache(GameStateSet& cache, const std::shared_ptr<GameState>& state, uint64_t budget_bytes, bool frozen,
+			std::size_t shared_state_count, MemoryStats& memory_stats, TraceBuffer* trace_buffer);
+	}  // namespace detail
+
+	template <typename Goal, typename Heuristic>
+	Solver::Solver(std::shared_ptr<GameState> initial_state, const SolverOptions& options, Goal goal, Heuristic heuristic)
+		: Solver(std::move(initial_state), options,
+			[goal, heuristic](Solver& solver, int iteration, const std::shared_ptr<GameState>& state, SolverStats& iteration_stats,
+				TraceRecorder* trace)
+			{
+				return solver.SolveOneIteration(goal, heuristic, iteration, state, iteration_stats, trace);
+			},
+			[goal](const GameState& state) { return goal.IsReached(state); },
+			std::is_same_v<Goal, WinGoal>, std::is_same_v<Heuristic, ScoreHeuristic>)
+	{
+	}
+
+	// If trace is not null, the activity of each thread is recorded in it.
+	template <typename Goal, typename Heuristic>
+	std::shared_ptr<GameState> Solver::SolveOneIteration(const Goal& goal, const Heuristic& heuristic, int iteration,
+		const std::shared_ptr<GameState>& initial_state, SolverStats& stats, TraceRecorder* trace)
+	{
+		// A copy, since max_turn_depth may be reduced to fit in the time limit.
+		SolverOptions options = _options;
+		double estimated_moves = PrepareIteration(iteration, initial_state, options);
+		unsigned int expected_worker_count = ExpectedWorkerCount(options);
+		std::ostream& log = Log();
+		TranspositionTable* transposition_table = _transposition_table.get();
+		EndgameTablebase* endgame_tablebase = _endgame_tablebase.get();
+		TraceBuffer* main_trace_buffer = trace != nullptr ? trace->ThreadBuffer(0) : nullptr;
+
+		// Stats for the sequential portion of the algorithm.
+		SolverStats sequential_stats;
+		uint64_t num_moves = 0;
+		std::size_t max_stack_size = 0;
+
+		std::stack<detail::NextMove> stack;
+		// Add the initial four directions to the stack.
+		++sequential_stats.depths[initial_state->_turn].nodes_expanded;
+		stack.push(detail::NextMove{ initial_state, Direction::UP });
+		stack.push(detail::NextMove{ initial_state, Direction::RIGHT });
+		stack.push(detail::NextMove{ initial_state, Direction::DOWN });
+		stack.push(detail::NextMove{ initial_state, Direction::LEFT });
+		// This unordered_set acts a cache of previously computed game states. If we see a game
+		// state that we've already computed before, we don't compute that game state again,
+		// potentially pruning a large chunk of the move tree.
+		detail::GameStateSet seen_states;
+		seen_states.insert(initial_state);
+		// The game states expanded by the sequential portion. Their moves are only all searched
+		// once the parallel portion has finished, so they're recorded in the transposition table
+		// at the end of the iteration.
+		std::vector<std::shared_ptr<GameState>> sequential_expanded_states;
+		if (transposition_table != nullptr)
+			sequential_expanded_states.push_back(initial_state);
+
+		std::shared_ptr<GameState> winning_state;
+		// The turn count of winning_state, or the max int if there is none. In anytime mode, game
+		// states that can't lead to a shorter win are pruned, and the workers read this without
+		// locking the mutex.
+		std::atomic<int> shortest_win_turn = std::numeric_limits<int>::max();
+		// Logs a win that is shorter than the ones found before, and reports it (anytime mode).
+		auto report_shorter_win = [this, &log](const std::string& thread_name, const std::shared_ptr<GameState>& state)
+			{
+				log << thread_name << "Shorter win (" << static_cast<uint32_t>(state->_turn) << " moves): " << FormatMoves(*state) << std::endl;
+				if (_callbacks.on_shorter_win)
+					_callbacks.on_shorter_win(state);
+			};
+		// parallelism_roots stores the game states at which we will start the parallel
+		// algorithm (one thread per GameState in parallelism_roots).
+		std::vector<std::shared_ptr<GameState>> parallelism_roots;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		// How many moves have been simulated by all threads. The worker threads only update this
+		// when they print a debug log and when they finish, so it lags behind a little.
+		std::atomic<uint64_t> moves_done = 0;
+
+		TraceSpan sequential_span(main_trace_buffer, "Sequential search", "search");
+		ScopedTimer search_timer(sequential_stats.phase_times, TimedPhase::SEARCH);
+		while (!stack.empty())
+		{
+			++num_moves;
+			max_stack_size = std::max(max_stack_size, stack.size());
+			if (num_moves % detail::CANCEL_CHECK_INTERVAL == 0 && _stopping)
+				break;
+			if (num_moves % options.print_every_n_moves == 0)
+			{
+				auto elapsed = std::chrono::high_resolution_clock::now() - start_time;
+				log << "Calculating move #" << num_moves << " (" << detail::FormatNumberWithSuffix(num_moves)
+					<< "), cache size = " << seen_states.size() << " (" << detail::FormatNumberWithSuffix(seen_states.size())
+					<< "), stack size = " << stack.size() << detail::FormatProgress(num_moves, estimated_moves, elapsed) << std::endl;
+				if (_callbacks.on_progress)
+					_callbacks.on_progress(SolverProgress{ iteration, num_moves, estimated_moves, elapsed });
+			}
+
+			// Compute the new game state.
+			const detail::NextMove& cur = stack.top();
+			std::shared_ptr<GameState> new_state;
+			{
+				ScopedTimer timer(sequential_stats.phase_times, TimedPhase::APPLY_MOVE);
+				new_state = cur.state->ApplyMove(cur.dir_to_apply);
+			}
+			DepthStats& depth_stats = sequential_stats.depths[new_state->_turn];
+			++depth_stats.nodes_generated;
+			if (IsNoOpMove(*cur.state, *new_state))
+				++depth_stats.noop_moves;
+			stack.pop();
+
+			// Once the Babas are on the same space, the endgame tablebase may have the moves to
+			// the win, which then count as reaching the goal.
+			if constexpr (std::is_same_v<Goal, WinGoal>)
+			{
+				if (endgame_tablebase != nullptr)
+				{
+					if (std::shared_ptr<GameState> endgame_win = detail::ResolveEndgame(*endgame_tablebase, *new_state))
+					{
+						++depth_stats.endgame_wins;
+						new_state = std::move(endgame_win);
+					}
+				}
+			}
+
+			// Check if we've reached the goal.
+			if (goal.IsReached(*new_state))
+			{
+				if (!options.anytime)
+				{
+					log << "WIN!!! Turn #" << static_cast<uint32_t>(new_state->_turn) << "\n";
+					winning_state = new_state;
+					break;
+				}
+				// In anytime mode, keep searching for shorter wins.
+				if (new_state->_turn < shortest_win_turn)
+				{
+					shortest_win_turn = new_state->_turn;
+					winning_state = new_state;
+					report_shorter_win("", new_state);
+				}
+				continue;
+			}
+
+			if (new_state->_turn <= options.max_cache_depth)
+			{
+				// Check the cache and don't proceed if the new game state has already been
+				// computed before.
+				bool inserted;
+				{
+					ScopedTimer timer(sequential_stats.phase_times, TimedPhase::CACHE_INSERT);
+					inserted = detail::InsertIntoCache(seen_states, new_state, options.max_cache_bytes, _caches_frozen.load(std::memory_order_relaxed), 0, sequential_stats.memory, main_trace_buffer);
+				}
+				if (!inserted)
+				{
+					++depth_stats.cache_hits;
+					continue;
+				}
+			}
+
+			// If it's impossible to win from this GameState, then prune that part of the tree.
+			if (!detail::CheckIfPossibleToWinAndUpdateStats(*new_state, depth_stats, sequential_stats.phase_times))
+			{
+				continue;
+			}
+
+			// If an earlier search found that this game state can't win in the moves that are
+			// left, then prune that part of the tree.
+			if (transposition_table != nullptr && new_state->_turn < options.max_turn_depth
+				&& transposition_table->CannotWinWithin(*new_state, options.max_turn_depth - new_state->_turn))
+			{
+				++depth_stats.pruned_transposition;
+				continue;
+			}
+
+			// Once there is a win (in anytime mode), only game states with moves left before its
+			// turn count can lead to a shorter one.
+			if (new_state->_turn + 1 >= shortest_win_turn)
+				continue;
+
+			// If we've reached parallelism_depth, then store the game state in parallelism_roots.
+			if (new_state->_turn >= options.parallelism_depth)
+			{
+				parallelism_roots.push_back(new_state);
+				continue;
+			}
+
+			// Add the next moves to the stack.
+			++depth_stats.nodes_expanded;
+			if (transposition_table != nullptr)
+				sequential_expanded_states.push_back(new_state);
+			stack.push(detail::NextMove{ new_state, Direction::UP });
+			stack.push(detail::NextMove{ new_state, Direction::RIGHT });
+			stack.push(detail::NextMove{ new_state, Direction::DOWN });
+			stack.push(detail::NextMove{ new_state, Direction::LEFT });
+		}
+
+		search_timer.Stop();
+		sequential_span.AddArg("moves", num_moves);
+		sequential_span.AddArg("parallelism_roots", parallelism_roots.size());
+		sequential_span.Stop();
+		moves_done = num_moves;
+		sequential_stats.cache_size = seen_states.size();
+		sequential_stats.parallelism_root_count = parallelism_roots.size();
+		sequential_stats.memory.shared_cache_bytes = detail::EstimateCacheBytes(seen_states, 0);
+		sequential_stats.memory.max_stack_bytes = max_stack_size * sizeof(detail::NextMove);
+		sequential_stats.memory.roots_bytes = parallelism_roots.capacity() * sizeof(std::shared_ptr<GameState>);
+		std::vector<std::shared_ptr<GameState>> best_leaf_states(parallelism_roots.size());
+		// Each thread writes its stats to its own element, so no lock is needed.
+		std::vector<SolverStats> thread_stats(parallelism_roots.size());
+		if ((!winning_state || options.anytime) && !_stopping)
+		{
+			std::mutex mutex;
+			// The best leaf score of all threads so far, for SolverCallbacks::on_best_leaf.
+			int best_shared_score = std::numeric_limits<int>::min();
+			uint16_t next_thread_id = 0;
+			uint16_t num_threads_finished = 0;
+			uint16_t total_num_threads = static_cast<uint16_t>(parallelism_roots.size());
+			unsigned int worker_count = std::max(1u, std::min<unsigned int>(expected_worker_count, total_num_threads));
+			log << "Finished the sequential portion. Now parallelizing into " << total_num_threads << " threads on "
+				<< worker_count << " worker threads." << std::endl;
+			// Each worker thread has one thread-local cache at a time, so the budget is split
+			// evenly between the worker threads.
+			uint64_t local_cache_budget_bytes = options.max_cache_bytes == 0 ? 0 : std::max<uint64_t>(1, options.max_cache_bytes / worker_count);
+
+			// search_subtree searches the move tree starting at one of the parallelism roots. You
+			// can think of it as one thread per element in parallelism_roots, but in reality the
+			// roots are distributed between options.thread_count worker threads (see below).
+			auto search_subtree =
+				[this, &goal, &heuristic, iteration, &options, &log, transposition_table, endgame_tablebase, &mutex, &seen_states, &winning_state, &best_leaf_states, &thread_stats, &next_thread_id, &num_threads_finished, &total_num_threads, local_cache_budget_bytes, &moves_done, estimated_moves, start_time, &best_shared_score, &shortest_win_turn, &report_shorter_win](
+					std::shared_ptr<GameState> state, TraceBuffer* trace_buffer) -> uint64_t
+				{
+					uint16_t thread_id = 0;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						thread_id = next_thread_id++;
+					}
+
+					SolverStats local_stats;
+					uint64_t num_moves = 0;
+					std::size_t max_stack_size = 0;
+
+					std::stack<detail::NextMove> stack;
+					// Apply initial four directions to the stack.
+					++local_stats.depths[state->_turn].nodes_expanded;
+					if (transposition_table != nullptr)
+						stack.push(detail::NextMove{ state, Direction::NO_DIRECTION });
+					stack.push(detail::NextMove{ state, Direction::UP });
+					stack.push(detail::NextMove{ state, Direction::RIGHT });
+					stack.push(detail::NextMove{ state, Direction::DOWN });
+					stack.push(detail::NextMove{ state, Direction::LEFT });
+
+					// Copy seen_states to make a thread-local cache.
+					detail::GameStateSet local_seen_states;
+					{
+						TraceSpan copy_span(trace_buffer, "Cache copy", "cache");
+						local_seen_states = seen_states;
+					}
+					int best_score = std::numeric_limits<int>::min();
+					std::shared_ptr<GameState> best_leaf_state;
+
+					ScopedTimer search_timer(local_stats.phase_times, TimedPhase::SEARCH);
+					while (!stack.empty())
+					{
+						// A move with no direction is a marker under the next moves of a game
+						// state, so it's reached once all of them have been searched without
+						// winning.
+						if (stack.top().dir_to_apply == Direction::NO_DIRECTION)
+						{
+							// Once there is a win in anytime mode, game states that can't lead to
+							// a shorter win are pruned, so the moves weren't all searched.
+							const std::shared_ptr<GameState>& searched_state = stack.top().state;
+							if (shortest_win_turn.load(std::memory_order_relaxed) == std::numeric_limits<int>::max())
+								transposition_table->RecordCannotWinWithin(*searched_state, options.max_turn_depth - searched_state->_turn);
+							stack.pop();
+							continue;
+						}
+						++num_moves;
+						max_stack_size = std::max(max_stack_size, stack.size());
+						if (num_moves % detail::CANCEL_CHECK_INTERVAL == 0 && _stopping)
+							break;
+						if (num_moves % options.print_every_n_moves == 0)
+						{
+							uint64_t all_moves_done = moves_done += options.print_every_n_moves;
+							auto elapsed = std::chrono::high_resolution_clock::now() - start_time;
+							// Lock the mutex so that print statements don't get jumbled.
+							std::lock_guard<std::mutex> lock(mutex);
+							log << "Thread " << thread_id << ": Calculating move #" << num_moves << " (" << detail::FormatNumberWithSuffix(num_moves)
+								<< "), cache size = " << local_seen_states.size() << " (" << detail::FormatNumberWithSuffix(local_seen_states.size())
+								<< "), stack size = " << stack.size() << detail::FormatProgress(all_moves_done, estimated_moves, elapsed) << std::endl;
+							if (_callbacks.on_progress)
+								_callbacks.on_progress(SolverProgress{ iteration, all_moves_done, estimated_moves, elapsed });
+						}
+
+						// Compute the new game state.
+						const detail::NextMove& cur = stack.top();
+						std::shared_ptr<GameState> new_state;
+						{
+							ScopedTimer timer(local_stats.phase_times, TimedPhase::APPLY_MOVE);
+							new_state = cur.state->ApplyMove(cur.dir_to_apply);
+						}
+						DepthStats& depth_stats = local_stats.depths[new_state->_turn];
+						++depth_stats.nodes_generated;
+						if (IsNoOpMove(*cur.state, *new_state))
+							++depth_stats.noop_moves;
+						stack.pop();
+
+						// Once the Babas are on the same space, the endgame tablebase may have the
+						// moves to the win, which then count as reaching the goal.
+						if constexpr (std::is_same_v<Goal, WinGoal>)
+						{
+							if (endgame_tablebase != nullptr)
+							{
+								if (std::shared_ptr<GameState> endgame_win = detail::ResolveEndgame(*endgame_tablebase, *new_state))
+								{
+									++depth_stats.endgame_wins;
+									new_state = std::move(endgame_win);
+								}
+							}
+						}
+
+						// Check if we've reached the goal.
+						if (goal.IsReached(*new_state))
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							if (!options.anytime)
+							{
+								log << "WIN!!! Turn #" << static_cast<uint32_t>(new_state->_turn) << "\n";
+								winning_state = new_state;
+								best_leaf_state = new_state;
+								break;
+							}
+							// In anytime mode, keep searching for shorter wins.
+							if (new_state->_turn < shortest_win_turn)
+							{
+								shortest_win_turn = new_state->_turn;
+								winning_state = new_state;
+								report_shorter_win("Thread " + std::to_string(thread_id) + ": ", new_state);
+							}
+							continue;
+						}
+
+						if (new_state->_turn <= options.max_cache_depth)
+						{
+							// Check the cache and don't proceed if the new game state has already
+							// been computed before.
+							bool inserted;
+							{
+								ScopedTimer timer(local_stats.phase_times, TimedPhase::CACHE_INSERT);
+								inserted = detail::InsertIntoCache(local_seen_states, new_state, local_cache_budget_bytes,
+									_caches_frozen.load(std::memory_order_relaxed), seen_states.size(),
+									local_stats.memory, trace_buffer);
+							}
+							if (!inserted)
+							{
+								++depth_stats.cache_hits;
+								continue;
+							}
+						}
+
+						// If it's impossible to win from this GameState, then prune that part of
+						// the tree.
+						if (!detail::CheckIfPossibleToWinAndUpdateStats(*new_state, depth_stats, local_stats.phase_times))
+						{
+							continue;
+						}
+
+						// If an earlier search found that this game state can't win in the moves
+						// that are left, then prune that part of the tree.
+						if (transposition_table != nullptr && new_state->_turn < options.max_turn_depth
+							&& transposition_table->CannotWinWithin(*new_state, options.max_turn_depth - new_state->_turn))
+						{
+							++depth_stats.pruned_transposition;
+							continue;
+						}
+
+						// Once there is a win (in anytime mode), only game states with moves left
+						// before its turn count can lead to a shorter one.
+						if (options.anytime && new_state->_turn + 1 >= shortest_win_turn.load(std::memory_order_relaxed))
+							continue;
+
+						// If we've reached max_turn_depth, then this game state is a leaf in the
+						// tree. Calculate the score of this game state and see if it's the best
+						// leaf state we've seen.
+						if (new_state->_turn >= options.max_turn_depth)
+						{
+							++depth_stats.leaves;
+							int score;
+							{
+								ScopedTimer timer(local_stats.phase_times, TimedPhase::CALCULATE_SCORE);
+								score = heuristic.Score(*new_state);
+							}
+							// Only CalculateScore() flags the leaves whose text blocks can't be aligned.
+							if constexpr (std::is_same_v<Heuristic, ScoreHeuristic>)
+							{
+								if (score == TEXT_CANNOT_BE_ALIGNED_SCORE)
+									++depth_stats.pruned_alignment;
+							}
+							if (score > best_score)
+							{
+								best_score = score;
+								best_leaf_state = new_state;
+								if (_callbacks.on_best_leaf || options.anytime)
+								{
+									std::lock_guard<std::mutex> lock(mutex);
+									if (score > best_shared_score)
+									{
+										best_shared_score = score;
+										if (options.anytime)
+										{
+											log << "Thread " << thread_id << ": New best leaf game state (score " << score << "): "
+												<< FormatMoves(*new_state) << std::endl;
+										}
+										if (_callbacks.on_best_leaf)
+											_callbacks.on_best_leaf(new_state, score);
+									}
+								}
+							}
+							continue;
+						}
+
+						// Add the next moves to the stack.
+						++depth_stats.nodes_expanded;
+						if (transposition_table != nullptr)
+							stack.push(detail::NextMove{ new_state, Direction::NO_DIRECTION });
+						stack.push(detail::NextMove{ new_state, Direction::UP });
+						stack.push(detail::NextMove{ new_state, Direction::RIGHT });
+						stack.push(detail::NextMove{ new_state, Direction::DOWN });
+						stack.push(detail::NextMove{ new_state, Direction::LEFT });
+					}
+
+					// Thread finished - print results.
+					search_timer.Stop();
+					moves_done += num_moves % options.print_every_n_moves;
+					local_stats.cache_size = local_seen_states.size();
+					local_stats.memory.max_local_cache_bytes = detail::EstimateCacheBytes(local_seen_states, seen_states.size());
+					local_stats.memory.max_stack_bytes = max_stack_size * sizeof(detail::NextMove);
+					thread_stats[thread_id] = local_stats;
+					best_leaf_states[thread_id] = best_leaf_state;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						uint16_t finished_thread_count = ++num_threads_finished;
+						// Print inside the critical section so that print statements don't get jumbled.
+						log << "Thread " << thread_id << " finished (" << finished_thread_count << "/" << total_num_threads << "): Moves="
+							<< detail::FormatNumberWithSuffix(num_moves) << ", Cache=" << detail::FormatNumberWithSuffix(local_seen_states.size()) << ", Leaves="
+							<< detail::FormatNumberWithSuffix(local_stats.Totals().leaves) << std::endl;
+					}
+					return num_moves;
+				};
+
+			// Each worker thread repeatedly takes the next unsearched root until all the roots have
+			// been searched. Since subtrees vary a lot in size, this balances the load better than
+			// giving each worker a fixed share of the roots.
+			std::atomic<std::size_t> next_root_index = 0;
+			std::vector<TraceBuffer*> worker_trace_buffers(worker_count);
+			for (unsigned int i = 0; i < worker_count; ++i)
+			{
+				worker_trace_buffers[i] = trace != nullptr ? trace->ThreadBuffer(i + 1) : nullptr;
+			}
+			auto run_worker = [this, &parallelism_roots, &next_root_index, &search_subtree, &worker_trace_buffers](unsigned int worker_index)
+				{
+					TraceBuffer* worker_trace_buffer = worker_trace_buffers[worker_index];
+					while (!_stopping)
+					{
+						std::size_t root_index;
+						{
+							TraceSpan take_span(worker_trace_buffer, "Take root", "scheduling");
+							root_index = next_root_index++;
+						}
+						if (root_index >= parallelism_roots.size())
+							break;
+						TraceSpan subtree_span(worker_trace_buffer, "Root #" + std::to_string(root_index), "subtree");
+						subtree_span.AddArg("root_index", root_index);
+						subtree_span.AddArg("moves", search_subtree(parallelism_roots[root_index], worker_trace_buffer));
+					}
+				};
+			TraceSpan parallel_span(main_trace_buffer, "Parallel search", "search");
+			if (_thread_pool != nullptr)
+			{
+				// The pool's threads may be busy with other solvers' roots, in which case this
+				// solver's workers start as the pool's threads free up.
+				_thread_pool->RunAndWait(worker_count, run_worker);
+			}
+			else
+			{
+				std::vector<std::thread> workers;
+				for (unsigned int i = 0; i < worker_count; ++i)
+				{
+					workers.emplace_back(run_worker, i);
+				}
+				for (std::thread& worker : workers)
+				{
+					worker.join();
+				}
+			}
+		}
+
+		// If the whole tree was searched without winning, then none of the game states that the
+		// sequential portion expanded can win in the moves that were left after them.
+		if (transposition_table != nullptr && !winning_state && !_stopping)
+		{
+			for (const std::shared_ptr<GameState>& state : sequential_expanded_states)
+				transposition_table->RecordCannotWinWithin(*state, options.max_turn_depth - state->_turn);
+		}
+
+		auto end_time = std::chrono::high_resolution_clock::now();
+		auto total_duration = end_time - start_time;
+
+		// Merge the stats from all threads.
+		SolverStats iteration_stats = sequential_stats;
+		for (const SolverStats& local_stats : thread_stats)
+		{
+			iteration_stats.Merge(local_stats);
+		}
+		iteration_stats.iteration_count = 1;
+		iteration_stats.estimated_nodes = estimated_moves;
+		iteration_stats.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(total_duration);
+		iteration_stats.memory.peak_rss_bytes = GetPeakRssBytes();
+		iteration_stats.memory.caches_frozen = _caches_frozen;
+		iteration_stats.stop_reason = _stop_reason;
+		if (options.max_turn_depth < _options.max_turn_depth)
+		{
+			iteration_stats.reduced_depth_iterations = 1;
+			iteration_stats.min_reduced_turn_depth = options.max_turn_depth;
+		}
+		stats.Merge(iteration_stats);
+
+		// The result is the game state that reached the goal, or else the leaf game state with the
+		// best score. A stopped search may not have reached any leaf, in which case the next
+		// iteration starts over from the same game state.
+		std::shared_ptr<GameState> result = winning_state;
+		if (!result)
+		{
+			int best_score = std::numeric_limits<int>::min();
+			result = initial_state;
+			for (const std::shared_ptr<GameState>& leaf_state : best_leaf_states)
+			{
+				if (!leaf_state)
+					continue;
+				int score = heuristic.Score(*leaf_state);
+				if (score > best_score)
+				{
+					best_score = score;
+					result = leaf_state;
+				}
+			}
+		}
+		PrintIterationResults(options, iteration_stats, estimated_moves, result, winning_state != nullptr);
+		return result;
+	}
+
+	template <typename Goal, typename Heuristic>
+	std::shared_ptr<GameState> SolveFor(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options, Goal goal,
+		Heuristic heuristic, SolverStats* stats)
+	{
+		Solver solver(initial_state, options, std::move(goal), std::move(heuristic));
+		solver.SetLog(&std::cout);
+		std::shared_ptr<GameState> end_state = solver.Run();
+		if (stats != nullptr)
+			*stats = solver.Stats();
+		return end_state;
+	}
+
+}  // namespace BabaSolver
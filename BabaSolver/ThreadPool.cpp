@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace BabaSolver
+{
+	ThreadPool::ThreadPool(unsigned int thread_count) : _threads(), _mutex(), _task_available(), _tasks(), _stopping(false)
+	{
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned int i = 0; i < thread_count; ++i)
+		{
+			_threads.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_task_available.notify_all();
+		for (std::thread& thread : _threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.push_back(std::move(task));
+		}
+		_task_available.notify_one();
+	}
+
+	void ThreadPool::RunAndWait(unsigned int count, const std::function<void(unsigned int)>& task)
+	{
+		std::mutex mutex;
+		std::condition_variable all_finished;
+		unsigned int remaining = count;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			Submit([i, &task, &mutex, &all_finished, &remaining]()
+				{
+					task(i);
+					std::lock_guard<std::mutex> lock(mutex);
+					if (--remaining == 0)
+						all_finished.notify_one();
+				});
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		all_finished.wait(lock, [&remaining]() { return remaining == 0; });
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_task_available.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+				if (_tasks.empty())
+					return;
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,52 @@
+// A fixed-size pool of worker threads that several solvers can share.
+//
+// Without a pool, each solver starts its own worker threads for the parallel portion of each
+// iteration. When several levels are solved at once (see Batch.h), a shared pool keeps the number
+// of busy threads at the number of hardware threads, and the threads that one level's search no
+// longer needs go straight to the other levels' searches.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BabaSolver
+{
+	class ThreadPool
+	{
+	public:
+		// Starts thread_count worker threads. 0 means one thread per hardware thread.
+		explicit ThreadPool(unsigned int thread_count);
+		// Runs the tasks that are still queued, then stops the worker threads.
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		unsigned int ThreadCount() const { return static_cast<unsigned int>(_threads.size()); }
+
+		// Queues task to run on one of the worker threads. Tasks start in the order they were
+		// queued.
+		void Submit(std::function<void()> task);
+
+		// Runs task(0), task(1), ..., task(count - 1) on the worker threads and waits for all of
+		// them to finish. Must not be called from a worker thread of this pool, since that thread
+		// would wait for tasks that may need it to run.
+		void RunAndWait(unsigned int count, const std::function<void(unsigned int)>& task);
+
+	private:
+		// The loop of each worker thread.
+		void WorkerLoop();
+
+		std::vector<std::thread> _threads;
+		// Guards _tasks and _stopping.
+		std::mutex _mutex;
+		std::condition_variable _task_available;
+		std::deque<std::function<void()>> _tasks;
+		bool _stopping;
+	};
+
+}  // namespace BabaSolver
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "Timers.h"
+
+namespace BabaSolver
+{
+	const char* TimedPhaseName(TimedPhase phase)
+	{
+		switch (phase)
+		{
+		case TimedPhase::SEARCH: return "Search";
+		case TimedPhase::APPLY_MOVE: return "ApplyMove";
+		case TimedPhase::CACHE_INSERT: return "Cache insert";
+		case TimedPhase::CHECK_IF_POSSIBLE_TO_WIN: return "CheckIfPossibleToWin";
+		case TimedPhase::CALCULATE_SCORE: return "CalculateScore";
+		}
+		// Should not be able to reach this point.
+		std::cerr << "Invalid phase in TimedPhaseName(): " << static_cast<uint32_t>(phase) << std::endl;
+		std::abort();
+	}
+
+	void PhaseTimes::Merge(const PhaseTimes& other)
+	{
+		for (int i = 0; i < TIMED_PHASE_COUNT; ++i)
+		{
+			ticks[i] += other.ticks[i];
+			calls[i] += other.calls[i];
+		}
+	}
+
+	double NanosecondsPerTick()
+	{
+#if BABA_SOLVER_ENABLE_TIMERS
+		// Compare the tick counter with the steady clock over a short sleep.
+		static const double nanoseconds_per_tick = []()
+			{
+				auto start_time = std::chrono::steady_clock::now();
+				uint64_t start_ticks = ReadTicks();
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				uint64_t end_ticks = ReadTicks();
+				auto end_time = std::chrono::steady_clock::now();
+				double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+				return end_ticks == start_ticks ? 1.0 : nanoseconds / (end_ticks - start_ticks);
+			}();
+		return nanoseconds_per_tick;
+#else
+		return 1.0;
+#endif
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,114 @@
+// Code for timing the phases of the solver's hot path.
+//
+// A ScopedTimer adds the time between its construction and destruction to one phase of a
+// PhaseTimes object. Each thread uses its own PhaseTimes (inside its SolverStats), so the timers
+// don't need any synchronization. The timers are only compiled in if BABA_SOLVER_ENABLE_TIMERS is
+// defined to 1 (e.g. "/DBABA_SOLVER_ENABLE_TIMERS=1"). Otherwise ScopedTimer is an empty class
+// that compiles to nothing, so the timers cost nothing in normal builds.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#ifndef BABA_SOLVER_ENABLE_TIMERS
+#define BABA_SOLVER_ENABLE_TIMERS 0
+#endif
+
+#if BABA_SOLVER_ENABLE_TIMERS
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace BabaSolver
+{
+	// True if the timers are compiled in.
+	inline constexpr bool TIMERS_ENABLED = BABA_SOLVER_ENABLE_TIMERS != 0;
+
+	// The phases of the solver that are timed.
+	enum class TimedPhase : uint8_t
+	{
+		// The whole search loop. The other phases happen inside of it.
+		SEARCH,
+		APPLY_MOVE,
+		CACHE_INSERT,
+		CHECK_IF_POSSIBLE_TO_WIN,
+		CALCULATE_SCORE,
+	};
+
+	inline constexpr int TIMED_PHASE_COUNT = 5;
+
+	// Returns the name of the given phase, e.g. "ApplyMove".
+	const char* TimedPhaseName(TimedPhase phase);
+
+	// The accumulated time and number of calls of each phase.
+	struct PhaseTimes
+	{
+		// Time spent in each phase in ticks (see ReadTicks()), indexed by TimedPhase.
+		std::array<uint64_t, TIMED_PHASE_COUNT> ticks{};
+		// How many times each phase ran, indexed by TimedPhase.
+		std::array<uint64_t, TIMED_PHASE_COUNT> calls{};
+
+		// Adds the times from other to this object.
+		void Merge(const PhaseTimes& other);
+	};
+
+	// Returns the length of one tick in nanoseconds. Measured once, the first time this is called.
+	double NanosecondsPerTick();
+
+#if BABA_SOLVER_ENABLE_TIMERS
+	// Returns the current time in ticks: CPU timestamp counter cycles on x86, and nanoseconds
+	// elsewhere.
+	inline uint64_t ReadTicks()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Times the enclosing scope (or until Stop() is called) and adds the time to the given phase.
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(PhaseTimes& times, TimedPhase phase) : _times(&times), _phase(phase), _start(ReadTicks()) {}
+		~ScopedTimer() { Stop(); }
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		// Stops the timer before the end of the scope.
+		void Stop()
+		{
+			if (_times == nullptr)
+				return;
+			int index = static_cast<int>(_phase);
+			_times->ticks[index] += ReadTicks() - _start;
+			++_times->calls[index];
+			_times = nullptr;
+		}
+
+	private:
+		PhaseTimes* _times;
+		TimedPhase _phase;
+		uint64_t _start;
+	};
+#else
+	// Timers are compiled out.
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(PhaseTimes&, TimedPhase) {}
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		void Stop() {}
+	};
+#endif
+
+}  // namespace BabaSolver
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Trace.h"
+
+namespace BabaSolver
+{
+	static double MicrosecondsBetween(std::chrono::steady_clock::time_point start_time, std::chrono::steady_clock::time_point end_time)
+	{
+		return std::chrono::duration<double, std::micro>(end_time - start_time).count();
+	}
+
+	TraceBuffer::TraceBuffer(uint32_t thread_id, const std::string& thread_name, std::chrono::steady_clock::time_point trace_start_time)
+		: _thread_id(thread_id), _thread_name(thread_name), _trace_start_time(trace_start_time)
+	{
+	}
+
+	void TraceBuffer::AddSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time,
+		std::chrono::steady_clock::time_point end_time, std::vector<std::pair<const char*, uint64_t>> args)
+	{
+		_events.push_back(TraceEvent{ std::move(name), category, MicrosecondsBetween(_trace_start_time, start_time),
+			MicrosecondsBetween(start_time, end_time), std::move(args) });
+	}
+
+	TraceSpan::TraceSpan(TraceBuffer* buffer, std::string name, const char* category)
+		: _buffer(buffer), _name(buffer != nullptr ? std::move(name) : std::string()), _category(category)
+	{
+		if (_buffer != nullptr)
+			_start_time = std::chrono::steady_clock::now();
+	}
+
+	TraceSpan::~TraceSpan()
+	{
+		Stop();
+	}
+
+	void TraceSpan::AddArg(const char* key, uint64_t value)
+	{
+		if (_buffer != nullptr)
+			_args.emplace_back(key, value);
+	}
+
+	void TraceSpan::Stop()
+	{
+		if (_buffer == nullptr)
+			return;
+		_buffer->AddSpan(std::move(_name), _category, _start_time, std::chrono::steady_clock::now(), std::move(_args));
+		_buffer = nullptr;
+	}
+
+	TraceRecorder::TraceRecorder() : _start_time(std::chrono::steady_clock::now())
+	{
+	}
+
+	TraceBuffer* TraceRecorder::ThreadBuffer(uint32_t thread_id)
+	{
+		while (_buffers.size() <= thread_id)
+		{
+			uint32_t new_thread_id = static_cast<uint32_t>(_buffers.size());
+			std::string thread_name = new_thread_id == 0 ? "Main thread" : "Worker " + std::to_string(new_thread_id);
+			_buffers.push_back(std::make_unique<TraceBuffer>(new_thread_id, thread_name, _start_time));
+		}
+		return _buffers[thread_id].get();
+	}
+
+	bool TraceRecorder::WriteToFile(const std::string& path) const
+	{
+		std::ofstream out(path);
+		if (!out)
+			return false;
+		// Event names are generated by the solver and never contain characters that need to be
+		// escaped in JSON.
+		out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+		out << std::fixed << std::setprecision(3);
+		bool first = true;
+		for (const std::unique_ptr<TraceBuffer>& buffer : _buffers)
+		{
+			out << (first ? "" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->ThreadId()
+				<< ", \"args\": {\"name\": \"" << buffer->ThreadName() << "\"}}";
+			first = false;
+			for (const TraceEvent& event : buffer->Events())
+			{
+				out << ",\n  {\"name\": \"" << event.name << "\", \"cat\": \"" << event.category << "\", \"ph\": \"X\", \"ts\": "
+					<< event.start_us << ", \"dur\": " << event.duration_us << ", \"pid\": 1, \"tid\": " << buffer->ThreadId();
+				if (!event.args.empty())
+				{
+					out << ", \"args\": {";
+					for (std::size_t i = 0; i < event.args.size(); ++i)
+					{
+						out << (i == 0 ? "" : ", ") << "\"" << event.args[i].first << "\": " << event.args[i].second;
+					}
+					out << "}";
+				}
+				out << "}";
+			}
+		}
+		out << "\n]}\n";
+		return static_cast<bool>(out);
+	}
+
+}  // namespace BabaSolver
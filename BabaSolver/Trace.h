@@ -0,0 +1,98 @@
+// Code for recording a timeline of the solver's activity in the Chrome trace event format.
+//
+// The trace file can be opened in chrome://tracing or https://ui.perfetto.dev to see when each
+// worker thread was busy (and with which parallelism root) and when it was idle. Each thread
+// records its spans into its own TraceBuffer, so recording doesn't need any synchronization. The
+// buffers are written to the file once the solver has finished.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BabaSolver
+{
+	// One span of time on one thread ("complete event" in the Chrome trace event format).
+	struct TraceEvent
+	{
+		std::string name;
+		const char* category;
+		// Start time and duration in microseconds. The start time is relative to the start of the
+		// trace.
+		double start_us;
+		double duration_us;
+		// Integer arguments shown when the span is selected in the trace viewer.
+		std::vector<std::pair<const char*, uint64_t>> args;
+	};
+
+	// The events recorded by one thread. Not thread safe: only one thread may use a TraceBuffer at
+	// a time.
+	class TraceBuffer
+	{
+	public:
+		TraceBuffer(uint32_t thread_id, const std::string& thread_name, std::chrono::steady_clock::time_point trace_start_time);
+
+		// Records a span from start_time to end_time.
+		void AddSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time,
+			std::chrono::steady_clock::time_point end_time, std::vector<std::pair<const char*, uint64_t>> args = {});
+
+		uint32_t ThreadId() const { return _thread_id; }
+		const std::string& ThreadName() const { return _thread_name; }
+		const std::vector<TraceEvent>& Events() const { return _events; }
+
+	private:
+		uint32_t _thread_id;
+		std::string _thread_name;
+		std::chrono::steady_clock::time_point _trace_start_time;
+		std::vector<TraceEvent> _events;
+	};
+
+	// Records a span from its construction to its destruction. Does nothing if buffer is null, so
+	// spans can be left in the code when tracing is disabled.
+	class TraceSpan
+	{
+	public:
+		TraceSpan(TraceBuffer* buffer, std::string name, const char* category);
+		~TraceSpan();
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		// Adds an integer argument to the span.
+		void AddArg(const char* key, uint64_t value);
+
+		// Ends the span before the end of the scope.
+		void Stop();
+
+	private:
+		TraceBuffer* _buffer;
+		std::string _name;
+		const char* _category;
+		std::chrono::steady_clock::time_point _start_time;
+		std::vector<std::pair<const char*, uint64_t>> _args;
+	};
+
+	// Owns the TraceBuffers of all threads and writes them to a file.
+	class TraceRecorder
+	{
+	public:
+		TraceRecorder();
+
+		// Returns the buffer for the thread with the given ID, creating it if it doesn't exist yet.
+		// Thread 0 is the main thread and thread N is worker thread #N. Must only be called from the
+		// main thread, before the worker threads start.
+		TraceBuffer* ThreadBuffer(uint32_t thread_id);
+
+		// Writes all the recorded events to the given file in the Chrome trace event format.
+		// Returns false if the file can't be written.
+		bool WriteToFile(const std::string& path) const;
+
+	private:
+		std::chrono::steady_clock::time_point _start_time;
+		std::vector<std::unique_ptr<TraceBuffer>> _buffers;
+	};
+
+}  // namespace BabaSolver
@@ -0,0 +1,297 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "GameState.h"
+#include "Hash.h"
+
+#include "TranspositionTable.h"
+
+namespace BabaSolver
+{
+	namespace
+	{
+		// The first bytes of the file. Everything after the header is entries.
+		struct TableHeader
+		{
+			char magic[8];
+			// Bump this when the layout of the file or of GameState's grid changes, so that old
+			// files are rejected instead of misread.
+			uint32_t version;
+			uint32_t ways;
+			uint64_t set_count;
+			uint8_t reserved[40];
+		};
+		static_assert(sizeof(TableHeader) == 64);
+
+		constexpr char TABLE_MAGIC[8] = { 'B', 'A', 'B', 'A', 'T', 'T', '\0', '\0' };
+		constexpr uint32_t TABLE_VERSION = 1;
+		// Entries per set. One set is 64 bytes, which is one cache line and keeps a lookup to one
+		// page fault at most.
+		constexpr uint32_t WAYS = 4;
+		// Each entry is two words: the key XORed with the data, and the data.
+		constexpr uint64_t WORDS_PER_ENTRY = 2;
+		constexpr uint64_t SET_BYTES = WAYS * WORDS_PER_ENTRY * sizeof(uint64_t);
+
+		// Returns the key of state: XXH64 of the grid, seeded with the locations of the Babas. The
+		// turn count and move history aren't part of the key.
+		uint64_t StateKey(const GameState& state)
+		{
+			uint64_t babas = static_cast<uint8_t>(state._baba1.i) | (static_cast<uint64_t>(static_cast<uint8_t>(state._baba1.j)) << 8)
+				| (static_cast<uint64_t>(static_cast<uint8_t>(state._baba2.i)) << 16) | (static_cast<uint64_t>(static_cast<uint8_t>(state._baba2.j)) << 24);
+			return Xxh64(state._grid, sizeof(state._grid), babas);
+		}
+
+		uint64_t Load(uint64_t& word)
+		{
+			return std::atomic_ref<uint64_t>(word).load(std::memory_order_relaxed);
+		}
+
+		void Store(uint64_t& word, uint64_t value)
+		{
+			std::atomic_ref<uint64_t>(word).store(value, std::memory_order_relaxed);
+		}
+
+		// Returns the file size of a table with the given number of sets.
+		uint64_t TableBytes(uint64_t set_count)
+		{
+			return sizeof(TableHeader) + set_count * SET_BYTES;
+		}
+
+		// Returns the largest power of two number of sets that fits in size_bytes (at least 1).
+		uint64_t SetCountForSize(uint64_t size_bytes)
+		{
+			uint64_t set_count = 1;
+			while (TableBytes(set_count * 2) <= size_bytes)
+				set_count *= 2;
+			return set_count;
+		}
+
+		// Maps the file at path into memory, creating it with create_bytes if it's empty. Returns
+		// null and sets error on failure.
+		void* MapFile(const std::string& path, uint64_t create_bytes, uint64_t& mapping_bytes, std::string& error)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+				OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				error = "Unable to open " + path;
+				return nullptr;
+			}
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(file, &size))
+			{
+				CloseHandle(file);
+				error = "Unable to get the size of " + path;
+				return nullptr;
+			}
+			if (size.QuadPart == 0)
+			{
+				size.QuadPart = static_cast<LONGLONG>(create_bytes);
+				if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+				{
+					CloseHandle(file);
+					error = "Unable to resize " + path;
+					return nullptr;
+				}
+			}
+			mapping_bytes = static_cast<uint64_t>(size.QuadPart);
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+			CloseHandle(file);
+			if (mapping == nullptr)
+			{
+				error = "Unable to map " + path;
+				return nullptr;
+			}
+			// The view keeps the file mapping alive after its handle is closed.
+			void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+			CloseHandle(mapping);
+			if (view == nullptr)
+			{
+				error = "Unable to map " + path;
+				return nullptr;
+			}
+			return view;
+#else
+			int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+			if (fd < 0)
+			{
+				error = "Unable to open " + path;
+				return nullptr;
+			}
+			struct stat file_stat;
+			if (fstat(fd, &file_stat) != 0)
+			{
+				close(fd);
+				error = "Unable to get the size of " + path;
+				return nullptr;
+			}
+			mapping_bytes = static_cast<uint64_t>(file_stat.st_size);
+			if (mapping_bytes == 0)
+			{
+				// The file is sparse until entries are written, so a big table doesn't take disk
+				// space (or time to create) up front.
+				if (ftruncate(fd, static_cast<off_t>(create_bytes)) != 0)
+				{
+					close(fd);
+					error = "Unable to resize " + path;
+					return nullptr;
+				}
+				mapping_bytes = create_bytes;
+			}
+			void* mapping = mmap(nullptr, mapping_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			// The mapping keeps the file open.
+			close(fd);
+			if (mapping == MAP_FAILED)
+			{
+				error = "Unable to map " + path;
+				return nullptr;
+			}
+			return mapping;
+#endif
+		}
+
+		void UnmapFile(void* mapping, uint64_t mapping_bytes)
+		{
+#ifdef _WIN32
+			(void)mapping_bytes;
+			UnmapViewOfFile(mapping);
+#else
+			munmap(mapping, mapping_bytes);
+#endif
+		}
+	}  // namespace
+
+	std::unique_ptr<TranspositionTable> TranspositionTable::Open(const std::string& path, uint64_t size_bytes, std::string& error)
+	{
+		uint64_t create_bytes = TableBytes(SetCountForSize(size_bytes));
+		uint64_t mapping_bytes = 0;
+		void* mapping = MapFile(path, create_bytes, mapping_bytes, error);
+		if (mapping == nullptr)
+			return nullptr;
+		if (mapping_bytes < sizeof(TableHeader))
+		{
+			UnmapFile(mapping, mapping_bytes);
+			error = path + " is not a transposition table";
+			return nullptr;
+		}
+
+		TableHeader* header = static_cast<TableHeader*>(mapping);
+		// A new file is all zeros. Another process may be creating the same file at the same
+		// time, but it writes the same header.
+		if (header->version == 0 && mapping_bytes == create_bytes)
+		{
+			std::memcpy(header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+			header->ways = WAYS;
+			header->set_count = SetCountForSize(size_bytes);
+			header->version = TABLE_VERSION;
+		}
+		if (std::memcmp(header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0 || header->version != TABLE_VERSION
+			|| header->ways != WAYS || header->set_count == 0 || (header->set_count & (header->set_count - 1)) != 0
+			|| TableBytes(header->set_count) != mapping_bytes)
+		{
+			UnmapFile(mapping, mapping_bytes);
+			error = path + " is not a transposition table of this version";
+			return nullptr;
+		}
+		return std::unique_ptr<TranspositionTable>(new TranspositionTable(mapping, mapping_bytes));
+	}
+
+	TranspositionTable::TranspositionTable(void* mapping, uint64_t mapping_bytes)
+		: _mapping(mapping), _mapping_bytes(mapping_bytes),
+		_entries(reinterpret_cast<uint64_t*>(static_cast<char*>(mapping) + sizeof(TableHeader))),
+		_set_count(static_cast<TableHeader*>(mapping)->set_count)
+	{
+	}
+
+	TranspositionTable::~TranspositionTable()
+	{
+		UnmapFile(_mapping, _mapping_bytes);
+	}
+
+	uint64_t* TranspositionTable::SetFor(uint64_t key) const
+	{
+		return _entries + (key & (_set_count - 1)) * WAYS * WORDS_PER_ENTRY;
+	}
+
+	bool TranspositionTable::CannotWinWithin(const GameState& state, int remaining_depth) const
+	{
+		uint64_t key = StateKey(state);
+		uint64_t* set = SetFor(key);
+		for (uint32_t way = 0; way < WAYS; ++way)
+		{
+			uint64_t checked_key = Load(set[way * WORDS_PER_ENTRY]);
+			uint64_t depth = Load(set[way * WORDS_PER_ENTRY + 1]);
+			if (depth != 0 && (checked_key ^ depth) == key)
+				return depth >= static_cast<uint64_t>(remaining_depth);
+		}
+		return false;
+	}
+
+	void TranspositionTable::RecordCannotWinWithin(const GameState& state, int remaining_depth)
+	{
+		if (remaining_depth <= 0)
+			return;
+		uint64_t depth = static_cast<uint64_t>(remaining_depth);
+		uint64_t key = StateKey(state);
+		uint64_t* set = SetFor(key);
+		// Replace the entry for the same game state, or else the shallowest entry. Empty entries
+		// have a depth of 0.
+		uint32_t victim = 0;
+		uint64_t victim_depth = std::numeric_limits<uint64_t>::max();
+		for (uint32_t way = 0; way < WAYS; ++way)
+		{
+			uint64_t checked_key = Load(set[way * WORDS_PER_ENTRY]);
+			uint64_t entry_depth = Load(set[way * WORDS_PER_ENTRY + 1]);
+			if (entry_depth != 0 && (checked_key ^ entry_depth) == key)
+			{
+				if (entry_depth >= depth)
+					return;
+				victim = way;
+				victim_depth = 0;
+				break;
+			}
+			if (entry_depth < victim_depth)
+			{
+				victim = way;
+				victim_depth = entry_depth;
+			}
+		}
+		// Deeper entries are worth more, since they save bigger subtrees.
+		if (victim_depth > depth)
+			return;
+		Store(set[victim * WORDS_PER_ENTRY], key ^ depth);
+		Store(set[victim * WORDS_PER_ENTRY + 1], depth);
+	}
+
+	uint64_t TranspositionTable::Capacity() const
+	{
+		return _set_count * WAYS;
+	}
+
+	uint64_t TranspositionTable::CountEntries() const
+	{
+		uint64_t count = 0;
+		for (uint64_t i = 0; i < _set_count * WAYS; ++i)
+		{
+			if (Load(_entries[i * WORDS_PER_ENTRY + 1]) != 0)
+				++count;
+		}
+		return count;
+	}
+
+}  // namespace BabaSolver
@@ -0,0 +1,68 @@
+// A transposition table of game states that are known not to lead to a win, stored in a
+// memory-mapped file so that it survives between runs.
+//
+// Each entry says "no winning game state can be reached from this game state in fewer than N
+// moves". The solver records a game state once it has searched every move from it down to
+// max_turn_depth without winning, and skips a game state if the table says it can't win in the
+// moves that are left. Since a game state is the same no matter which level or iteration it came
+// from, a later run (e.g. with a higher max_turn_depth) skips everything that an earlier run
+// searched to the same remaining depth.
+//
+// The table is a fixed-size, 4-way set-associative hash table. When a set is full, the entry with
+// the smallest depth is replaced, so the file never grows and the OS can page cold entries out
+// when the table is larger than RAM. Entries are keyed by a 64-bit hash of the grid and the Babas.
+// Threads and processes can use the same file at the same time without locks: each entry is
+// two 64-bit words, and the key is stored XORed with the data so that a torn entry (one word
+// written by one thread and the other by another) is detected and ignored.
+//
+// Skipped game states still count as searched, so an iteration that doesn't win may pick a
+// different best leaf game state than it would without the table.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "GameState.h"
+
+namespace BabaSolver
+{
+	class TranspositionTable
+	{
+	public:
+		// Opens the table in the file at path, or creates it with about size_bytes if it doesn't
+		// exist. An existing file keeps its size. Returns null and sets error if the file can't be
+		// opened or isn't a transposition table.
+		static std::unique_ptr<TranspositionTable> Open(const std::string& path, uint64_t size_bytes, std::string& error);
+
+		// Unmaps the file. The entries are written back to the file by the OS.
+		~TranspositionTable();
+		TranspositionTable(const TranspositionTable&) = delete;
+		TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+		// Returns true if state is known not to lead to a win in remaining_depth moves.
+		bool CannotWinWithin(const GameState& state, int remaining_depth) const;
+
+		// Records that state doesn't lead to a win in remaining_depth moves.
+		void RecordCannotWinWithin(const GameState& state, int remaining_depth);
+
+		// Returns how many entries the table has room for.
+		uint64_t Capacity() const;
+
+		// Returns how many entries are in use. Reads the whole table, so it's slow for big tables.
+		uint64_t CountEntries() const;
+
+	private:
+		TranspositionTable(void* mapping, uint64_t mapping_bytes);
+
+		// Returns the first entry of the set that key belongs to.
+		uint64_t* SetFor(uint64_t key) const;
+
+		void* _mapping;
+		uint64_t _mapping_bytes;
+		uint64_t* _entries;
+		uint64_t _set_count;
+	};
+
+}  // namespace BabaSolver
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Estimate.h"
+#include "GameState.h"
+#include "Solver.h"
+
+#include "Tuner.h"
+
+namespace BabaSolver
+{
+	// The max_turn_depth of the first calibration search, and how much deeper each calibration
+	// search is than the last one.
+	static constexpr int FIRST_CALIBRATION_DEPTH = 8;
+	static constexpr int CALIBRATION_DEPTH_STEP = 2;
+	// The calibration stops once a search takes this fraction of the time budget of one
+	// iteration. Each search takes about 4 times as long as the last one, so all of the calibration
+	// searches together take about a third of the budget at most.
+	static constexpr double CALIBRATION_BUDGET_FRACTION = 0.05;
+	// How much more memory a calibration search's caches use than the last one's (at most). The
+	// calibration stops before a search could go over the memory budget.
+	static constexpr uint64_t CALIBRATION_MEMORY_GROWTH = 4;
+	// The cache depths that are considered: from MAX_TURN_COUNT down to MIN_CANDIDATE_CACHE_DEPTH
+	// in steps of CANDIDATE_CACHE_DEPTH_STEP.
+	static constexpr int MIN_CANDIDATE_CACHE_DEPTH = 10;
+	static constexpr int CANDIDATE_CACHE_DEPTH_STEP = 4;
+
+	// Runs one calibration search with the given options without printing its logs, and adds its
+	// measurements to result.calibrations. Returns the new calibration.
+	static const CalibrationResult& RunCalibrationSearch(const std::shared_ptr<GameState>& initial_state, const SolverOptions& options,
+		SolverStats& stats, std::shared_ptr<GameState>& end_state, TuningResult& result)
+	{
+		Solver solver(initial_state, options);
+		end_state = solver.Run();
+		stats = solver.Stats();
+
+		DepthStats totals = stats.Totals();
+		CalibrationResult calibration;
+		calibration.max_turn_depth = options.max_turn_depth;
+		calibration.max_cache_depth = options.max_cache_depth;
+		calibration.nodes_generated = totals.nodes_generated;
+		calibration.estimated_nodes = stats.estimated_nodes;
+		calibration.duration = stats.duration;
+		calibration.cache_hit_rate = totals.nodes_generated == 0 ? 0.0 : static_cast<double>(totals.cache_hits) / totals.nodes_generated;
+		calibration.max_local_cache_bytes = stats.memory.max_local_cache_bytes;
+		result.calibrations.push_back(calibration);
+		return result.calibrations.back();
+	}
+
+	// Returns the options of the calibration searches (before their depths are set), which are
+	// also the options the tree size estimates are made with.
+	static SolverOptions CalibrationOptions(const SolverOptions& base_options)
+	{
+		SolverOptions calibration_options = base_options;
+		calibration_options.iteration_count = 1;
+		calibration_options.max_cache_bytes = 0;
+		calibration_options.trace_file.clear();
+		calibration_options.print_every_n_moves = UINT64_MAX;
+		if (calibration_options.estimate_probe_count <= 0)
+			calibration_options.estimate_probe_count = SolverOptions().estimate_probe_count;
+		return calibration_options;
+	}
+
+	// Returns the number of worker threads that the options' searches use.
+	static unsigned int WorkerCount(const SolverOptions& options)
+	{
+		unsigned int worker_count = options.thread_count != 0 ? options.thread_count : std::thread::hardware_concurrency();
+		return std::max(1u, worker_count);
+	}
+
+	TuningResult TuneOptions(const std::shared_ptr<GameState>& initial_state, const SolverOptions& base_options,
+		std::chrono::nanoseconds time_budget, uint64_t memory_budget_bytes)
+	{
+		TuningResult result;
+		result.options = base_options;
+		result.options.max_cache_bytes = memory_budget_bytes;
+		std::chrono::nanoseconds iteration_budget = time_budget / std::max(1, base_options.iteration_count);
+		unsigned int worker_count = WorkerCount(base_options);
+
+		// Run the calibration searches, with every depth cached.
+		SolverOptions calibration_options = CalibrationOptions(base_options);
+		SolverStats cached_stats;
+		for (int depth = FIRST_CALIBRATION_DEPTH; depth <= MAX_TURN_COUNT; depth += CALIBRATION_DEPTH_STEP)
+		{
+			calibration_options.max_turn_depth = depth;
+			calibration_options.max_cache_depth = depth;
+			calibration_options.parallelism_depth = std::min(base_options.parallelism_depth, depth - 1);
+			std::shared_ptr<GameState> end_state;
+			const CalibrationResult& calibration = RunCalibrationSearch(initial_state, calibration_options, cached_stats, end_state, result);
+			if (end_state && end_state->HaveWon())
+			{
+				result.won = true;
+				result.options.max_turn_depth = calibration_options.max_turn_depth;
+				result.options.max_cache_depth = calibration_options.max_cache_depth;
+				result.options.parallelism_depth = calibration_options.parallelism_depth;
+				result.estimated_nodes = static_cast<double>(calibration.nodes_generated);
+				result.estimated_duration = calibration.duration;
+				result.estimated_memory_bytes = calibration.max_local_cache_bytes * worker_count;
+				return result;
+			}
+			if (calibration.duration >= iteration_budget * CALIBRATION_BUDGET_FRACTION)
+				break;
+			if (memory_budget_bytes != 0 && calibration.max_local_cache_bytes * worker_count * CALIBRATION_MEMORY_GROWTH > memory_budget_bytes)
+				break;
+		}
+		CalibrationResult cached_calibration = result.calibrations.back();
+		CalibrationMeasurements measurements;
+
+		// Moves below the cache depth are much faster than cached moves, since they skip the cache
+		// insert (which is most of the time of a cached move). Run the last calibration search
+		// again without caching its last depths to measure both speeds.
+		SolverOptions uncached_options = calibration_options;
+		uncached_options.max_cache_depth = std::max(uncached_options.parallelism_depth, uncached_options.max_turn_depth - CALIBRATION_DEPTH_STEP);
+		SolverStats uncached_stats;
+		std::shared_ptr<GameState> uncached_end_state;
+		RunCalibrationSearch(initial_state, uncached_options, uncached_stats, uncached_end_state, result);
+		measurements.cached_nanoseconds_per_node = cached_calibration.nodes_generated == 0 ? 0.0
+			: static_cast<double>(cached_calibration.duration.count()) / cached_calibration.nodes_generated;
+		measurements.uncached_nanoseconds_per_node = measurements.cached_nanoseconds_per_node;
+		{
+			uint64_t cached_nodes = 0;
+			uint64_t uncached_nodes = 0;
+			for (int depth = 1; depth <= uncached_options.max_turn_depth; ++depth)
+			{
+				(depth <= uncached_options.max_cache_depth ? cached_nodes : uncached_nodes) += uncached_stats.depths[depth].nodes_generated;
+			}
+			double uncached_time = uncached_stats.duration.count() - measurements.cached_nanoseconds_per_node * cached_nodes;
+			if (uncached_nodes > 0 && uncached_time > 0.0)
+				measurements.uncached_nanoseconds_per_node = uncached_time / uncached_nodes;
+		}
+
+		// Measure how far off the probed part of the tree size estimate is. The exact part is
+		// left out since it's always right.
+		TreeSizeEstimate calibration_estimate = EstimateTreeSize(initial_state, calibration_options, cached_calibration.max_turn_depth);
+		double actual_probed_nodes = 0.0;
+		for (int depth = calibration_estimate.exact_depth + 1; depth <= cached_calibration.max_turn_depth; ++depth)
+		{
+			actual_probed_nodes += cached_stats.depths[depth].nodes_generated;
+		}
+		double estimated_probed_nodes = calibration_estimate.TotalNodes(cached_calibration.max_turn_depth)
+			- calibration_estimate.TotalNodes(calibration_estimate.exact_depth);
+		measurements.probe_correction = estimated_probed_nodes > 0.0 ? actual_probed_nodes / estimated_probed_nodes : 1.0;
+
+		// The cached calibration search caches every depth.
+		double calibration_nodes_per_root = static_cast<double>(cached_calibration.nodes_generated)
+			/ std::max<uint64_t>(1, cached_stats.parallelism_root_count);
+		measurements.cache_bytes_per_node_per_root = calibration_nodes_per_root == 0.0 ? 0.0
+			: cached_calibration.max_local_cache_bytes / calibration_nodes_per_root;
+
+		TuningResult picked = PickTunedOptions(initial_state, base_options, measurements, time_budget, memory_budget_bytes);
+		picked.calibrations = std::move(result.calibrations);
+		return picked;
+	}
+
+	TuningResult PickTunedOptions(const std::shared_ptr<GameState>& initial_state, const SolverOptions& base_options,
+		const CalibrationMeasurements& measurements, std::chrono::nanoseconds time_budget, uint64_t memory_budget_bytes)
+	{
+		TuningResult result;
+		result.options = base_options;
+		result.options.max_cache_bytes = memory_budget_bytes;
+		result.measurements = measurements;
+		std::chrono::nanoseconds iteration_budget = time_budget / std::max(1, base_options.iteration_count);
+		unsigned int worker_count = WorkerCount(base_options);
+		double cached_nanoseconds_per_node = measurements.cached_nanoseconds_per_node;
+		double uncached_nanoseconds_per_node = measurements.uncached_nanoseconds_per_node;
+		double cache_bytes_per_node_per_root = measurements.cache_bytes_per_node_per_root;
+
+		// Pick the deepest search that fits in the budget. Among equally deep searches, pick the
+		// fastest one.
+		bool found = false;
+		for (int cache_depth = MAX_TURN_COUNT; cache_depth >= MIN_CANDIDATE_CACHE_DEPTH; cache_depth -= CANDIDATE_CACHE_DEPTH_STEP)
+		{
+			SolverOptions candidate = CalibrationOptions(base_options);
+			candidate.max_cache_depth = cache_depth;
+			TreeSizeEstimate estimate = EstimateTreeSize(initial_state, candidate, MAX_TURN_COUNT);
+			for (int depth = estimate.exact_depth + 1; depth <= estimate.max_depth; ++depth)
+			{
+				estimate.nodes_generated[depth] *= measurements.probe_correction;
+			}
+			auto estimate_duration = [&estimate, cache_depth, cached_nanoseconds_per_node, uncached_nanoseconds_per_node](int max_turn_depth)
+				{
+					double cached_nodes = estimate.TotalNodes(std::min(max_turn_depth, cache_depth));
+					double uncached_nodes = estimate.TotalNodes(max_turn_depth) - cached_nodes;
+					return std::chrono::nanoseconds(static_cast<int64_t>(
+						cached_nodes * cached_nanoseconds_per_node + uncached_nodes * uncached_nanoseconds_per_node));
+				};
+			// Every worker thread holds one thread-local cache at a time, each with about
+			// 1 / root_count of the cached moves.
+			auto estimate_memory = [&estimate, cache_depth, cache_bytes_per_node_per_root, worker_count](int max_turn_depth, int parallelism_depth)
+				{
+					double root_count = std::max(1.0, estimate.nodes_generated[parallelism_depth + 1] / 4);
+					double cached_nodes = estimate.TotalNodes(std::min(max_turn_depth, cache_depth));
+					return static_cast<uint64_t>(std::min<double>(worker_count, root_count) * cache_bytes_per_node_per_root * cached_nodes / root_count);
+				};
+
+			// Even if nothing fits in the budget, search one move deep.
+			int max_turn_depth = 1;
+			for (int depth = 2; depth <= estimate.max_depth; ++depth)
+			{
+				if (estimate_duration(depth) > iteration_budget)
+					break;
+				if (memory_budget_bytes != 0 && estimate_memory(depth, SuggestParallelismDepth(estimate, depth, worker_count)) > memory_budget_bytes)
+					break;
+				max_turn_depth = depth;
+			}
+			std::chrono::nanoseconds duration = estimate_duration(max_turn_depth);
+			if (found && (max_turn_depth < result.options.max_turn_depth
+				|| (max_turn_depth == result.options.max_turn_depth && duration >= result.estimated_duration)))
+			{
+				continue;
+			}
+			found = true;
+			result.options.max_turn_depth = max_turn_depth;
+			result.options.parallelism_depth = SuggestParallelismDepth(estimate, max_turn_depth, worker_count);
+			result.options.max_cache_depth = std::min(cache_depth, max_turn_depth);
+			result.estimated_nodes = estimate.TotalNodes(max_turn_depth);
+			result.estimated_duration = duration;
+			result.estimated_memory_bytes = estimate_memory(max_turn_depth, result.options.parallelism_depth);
+		}
+		return result;
+	}
+
+}  // namespace BabaSolver
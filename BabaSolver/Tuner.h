@@ -0,0 +1,81 @@
+// Code for picking SolverOptions that fit a time and memory budget on this computer.
+//
+// The tuner first runs short calibration searches on the level, each one two moves deeper than the
+// last, until one takes a noticeable part of the budget. The calibration searches measure how
+// fast this computer simulates moves (with and without caching them), how far off the tree size
+// estimate (see Estimate.h) is, and how much memory the caches use per cached move. The tuner then
+// estimates the move tree for several cache depths, corrects the estimates with the measurements,
+// and picks the deepest search that is expected to fit in the budget.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+#include "Solver.h"
+
+namespace BabaSolver
+{
+	// The measurements of one calibration search.
+	struct CalibrationResult
+	{
+		int max_turn_depth = 0;
+		int max_cache_depth = 0;
+		// How many moves were simulated, and how many the tree size estimate predicted.
+		uint64_t nodes_generated = 0;
+		double estimated_nodes = 0.0;
+		std::chrono::nanoseconds duration{};
+		// The fraction of the simulated moves that were cache hits.
+		double cache_hit_rate = 0.0;
+		// The estimated size of the largest thread-local cache.
+		uint64_t max_local_cache_bytes = 0;
+	};
+
+	// What the calibration searches measured, which PickTunedOptions() bases its estimates on.
+	struct CalibrationMeasurements
+	{
+		// The time per move across all the worker threads, for moves that are cached and moves
+		// below the cache depth.
+		double cached_nanoseconds_per_node = 0.0;
+		double uncached_nanoseconds_per_node = 0.0;
+		// The actual number of moves of the probed part of the tree size estimate, divided by the
+		// estimate.
+		double probe_correction = 1.0;
+		// The bytes of the largest thread-local cache per cached move per parallelism root.
+		double cache_bytes_per_node_per_root = 0.0;
+	};
+
+	// The options picked by TuneOptions() and what they're expected to cost.
+	struct TuningResult
+	{
+		SolverOptions options;
+		// The expected number of moves, time, and memory of one iteration with options.
+		double estimated_nodes = 0.0;
+		std::chrono::nanoseconds estimated_duration{};
+		uint64_t estimated_memory_bytes = 0;
+		// True if a calibration search won, in which case options are the options of that search.
+		bool won = false;
+		std::vector<CalibrationResult> calibrations;
+		// Derived from calibrations (unless a calibration search won).
+		CalibrationMeasurements measurements;
+	};
+
+	// Picks the options that search the deepest from initial_state while each iteration is expected
+	// to take at most time_budget / base_options.iteration_count and the caches are expected to use
+	// at most memory_budget_bytes (0 means no limit). The thread count, iteration count, and
+	// estimate probe count are taken from base_options. The memory budget is also set as the
+	// options' max_cache_bytes, so the caches stay in the budget even if the estimate is too low.
+	// The calibration searches' logs are not printed.
+	TuningResult TuneOptions(const std::shared_ptr<GameState>& initial_state, const SolverOptions& base_options,
+		std::chrono::nanoseconds time_budget, uint64_t memory_budget_bytes);
+
+	// The second half of TuneOptions(): picks the options that search the deepest within the
+	// budgets, given the measurements of this computer. Doesn't run any search, so the result
+	// only depends on the arguments.
+	TuningResult PickTunedOptions(const std::shared_ptr<GameState>& initial_state, const SolverOptions& base_options,
+		const CalibrationMeasurements& measurements, std::chrono::nanoseconds time_budget, uint64_t memory_budget_bytes);
+
+}  // namespace BabaSolver
@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace BabaSolverBenchmark
+{
+	// Writing to a volatile variable forces the compiler to compute the value.
+	static volatile uint64_t g_sink = 0;
+
+	void DoNotOptimize(uint64_t value)
+	{
+		g_sink = g_sink + value;
+	}
+
+	BenchmarkRunner::BenchmarkRunner(const std::string& filter, std::chrono::nanoseconds min_time)
+		: _filter(filter), _min_time(min_time)
+	{
+	}
+
+	void BenchmarkRunner::Run(const std::string& name, const std::function<void(uint64_t iterations)>& fn)
+	{
+		if (!std::regex_search(name, _filter))
+			return;
+
+		// Warm up the caches and the branch predictor.
+		fn(1);
+
+		uint64_t iterations = 1;
+		std::chrono::nanoseconds elapsed{};
+		while (true)
+		{
+			auto start_time = std::chrono::steady_clock::now();
+			fn(iterations);
+			auto end_time = std::chrono::steady_clock::now();
+			elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+			if (elapsed >= _min_time)
+				break;
+			iterations *= 2;
+		}
+
+		BenchmarkResult result{ name, iterations, static_cast<double>(elapsed.count()) / iterations };
+		std::cout << std::left << std::setw(48) << result.name << std::right << std::setw(12) << result.iterations
+			<< std::setw(12) << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op" << std::endl;
+		_results.push_back(result);
+	}
+
+	const std::vector<BenchmarkResult>& BenchmarkRunner::Results() const
+	{
+		return _results;
+	}
+
+	void BenchmarkRunner::PrintHeader()
+	{
+		std::cout << std::left << std::setw(48) << "Benchmark" << std::right << std::setw(12) << "Iterations"
+			<< std::setw(18) << "Time" << std::endl;
+	}
+
+}  // namespace BabaSolverBenchmark
@@ -0,0 +1,74 @@
+// A minimal harness for microbenchmarks.
+//
+// Each benchmark is a function that is called in a loop. The harness keeps doubling the number of
+// calls until the loop runs for at least the minimum benchmark time, then reports the average time
+// per call in nanoseconds.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace BabaSolverBenchmark
+{
+	// The result of running one benchmark.
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint64_t iterations;
+		double ns_per_op;
+	};
+
+	// Prevents the compiler from optimizing away the computation of the given value.
+	void DoNotOptimize(uint64_t value);
+
+	// Returns ptr, but prevents the compiler from assuming anything about the returned pointer.
+	// This stops the compiler from hoisting computations on const objects out of benchmark loops.
+	template <typename T>
+	T* HideFromOptimizer(T* ptr)
+	{
+		T* volatile hidden = ptr;
+		return hidden;
+	}
+
+	// Runs benchmarks and collects their results.
+	class BenchmarkRunner
+	{
+	public:
+		// Only benchmarks whose names match filter are run. Each benchmark runs for at least
+		// min_time.
+		BenchmarkRunner(const std::string& filter, std::chrono::nanoseconds min_time);
+
+		// Runs the benchmark with the given name. fn must run the benchmarked operation the given
+		// number of times. Looping inside fn keeps the std::function call out of the measurement.
+		void Run(const std::string& name, const std::function<void(uint64_t iterations)>& fn);
+
+		// Returns the results of all the benchmarks that have been run.
+		const std::vector<BenchmarkResult>& Results() const;
+
+		// Prints the header of the table of results to stdout.
+		static void PrintHeader();
+
+	private:
+		std::regex _filter;
+		std::chrono::nanoseconds _min_time;
+		std::vector<BenchmarkResult> _results;
+	};
+
+	// Registers and runs the GameState benchmarks.
+	void RunGameStateBenchmarks(BenchmarkRunner& runner);
+
+	// Runs the end-to-end solver benchmarks whose names match filter, repeating each configuration
+	// the given number of times. If output_path is not empty, the results are written to it as CSV
+	// (if output_path ends with ".csv") or JSON (otherwise). Returns false on error.
+	bool RunSolverBenchmarks(const std::string& filter, int repetitions, const std::string& output_path);
+
+	// Prints a report comparing the quality (collisions, bucket distribution, and avalanche) and
+	// speed of the GameState hash functions on game states from real searches.
+	void RunHashQualityReport();
+
+}  // namespace BabaSolverBenchmark
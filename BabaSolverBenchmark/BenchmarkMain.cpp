@@ -0,0 +1,94 @@
+// BabaSolverBenchmark measures the performance of the Baba Is You solver.
+//
+// Run the benchmarks in "release" mode, not "debug" mode, and on an otherwise idle computer. Record
+// the results before and after every engine change so that each change has a ns/op number.
+
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <string>
+
+#include "Benchmark.h"
+
+static void PrintHelp()
+{
+	std::string help = R"(BabaSolverBenchmark: Benchmarks for the Baba Is You solver
+
+Usage: BabaSolverBenchmark [--flag=<value> ...]
+
+Flags:
+  --suite        Which benchmarks to run: "micro" (the default) for the GameState microbenchmarks, "solver" for the end-to-end solver benchmarks, or "hash" for a report on the quality of the GameState hash functions.
+  --filter       Only run benchmarks whose names match this regular expression.
+  --min_time_ms  The minimum time (in milliseconds) to run each microbenchmark for.
+  --repetitions  How many times to run each solver benchmark.
+  --output       The file to write the solver benchmark results to. The results are written as CSV if the file name ends with ".csv", otherwise as JSON.
+  --help         Prints this help message.
+)";
+	std::cout << help << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	// Parse flags.
+	std::string suite = "micro";
+	std::string filter = ".*";
+	std::chrono::milliseconds min_time(500);
+	int repetitions = 3;
+	std::string output_path;
+	std::regex suite_regex("--suite=(micro|solver|hash)");
+	std::regex filter_regex("--filter=(.*)");
+	std::regex min_time_ms_regex("--min_time_ms=(\\d+)");
+	std::regex repetitions_regex("--repetitions=(\\d+)");
+	std::regex output_regex("--output=(.+)");
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string flag_str(argv[i]);
+		std::smatch matches;
+		if (flag_str == "--help")
+		{
+			PrintHelp();
+			return 1;
+		}
+		if (std::regex_match(flag_str, matches, suite_regex))
+		{
+			suite = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, filter_regex))
+		{
+			filter = matches[1];
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, min_time_ms_regex))
+		{
+			min_time = std::chrono::milliseconds(std::stoi(matches[1]));
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, repetitions_regex))
+		{
+			repetitions = std::stoi(matches[1]);
+			continue;
+		}
+		if (std::regex_match(flag_str, matches, output_regex))
+		{
+			output_path = matches[1];
+			continue;
+		}
+		std::cout << "Invalid argument: " << flag_str << std::endl;
+		PrintHelp();
+		return 1;
+	}
+
+	// Run benchmarks.
+	if (suite == "solver")
+		return BabaSolverBenchmark::RunSolverBenchmarks(filter, repetitions, output_path) ? 0 : 1;
+	if (suite == "hash")
+	{
+		BabaSolverBenchmark::RunHashQualityReport();
+		return 0;
+	}
+	BabaSolverBenchmark::BenchmarkRunner runner(filter, min_time);
+	BabaSolverBenchmark::BenchmarkRunner::PrintHeader();
+	BabaSolverBenchmark::RunGameStateBenchmarks(runner);
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Benchmarks for the GameState hot path.
+//
+// The benchmarks run on a fixed corpus of game states recorded by replaying move sequences from
+// the Floatiest Platforms level and the test level, so the numbers are comparable between runs.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+
+#include "Benchmark.h"
+
+namespace BabaSolverBenchmark
+{
+	namespace
+	{
+		// A recorded game state, along with the move to benchmark ApplyMove() with.
+		struct CorpusState
+		{
+			std::string name;
+			std::shared_ptr<BabaSolver::GameState> state;
+			BabaSolver::Direction next_move;
+		};
+	}  // namespace
+
+	// Replays the given moves on top of initial_state.
+	static std::shared_ptr<BabaSolver::GameState> ReplayMoves(
+		const std::shared_ptr<BabaSolver::GameState>& initial_state, const std::string& moves_str)
+	{
+		std::optional<std::vector<BabaSolver::Direction>> moves = BabaSolver::ParseMoves(moves_str);
+		if (!moves)
+		{
+			// Programmer error
+			std::cerr << "Invalid moves in benchmark corpus: " << moves_str << std::endl;
+			std::abort();
+		}
+		return initial_state->ApplyMoves(*moves);
+	}
+
+	static std::vector<CorpusState> BuildCorpus()
+	{
+		std::shared_ptr<BabaSolver::GameState> floatiest = BabaSolver::FloatiestPlatformsLevel();
+		std::shared_ptr<BabaSolver::GameState> test_level = BabaSolver::TestLevel();
+		return {
+			// The initial state. Baba #2 pushes the "IS" text block, which breaks "ROCK IS PUSH".
+			{ "Floatiest/Initial", floatiest, BabaSolver::Direction::UP },
+			// Baba #1 pushes a rock while "ROCK IS PUSH" is active.
+			{ "Floatiest/RockPush", ReplayMoves(floatiest, "D"), BabaSolver::Direction::RIGHT },
+			// Baba #1 pushes a rock and Baba #2 pushes the whole "ROCK IS PUSH" row of text blocks.
+			{ "Floatiest/TextPushChain", ReplayMoves(floatiest, "LLU"), BabaSolver::Direction::RIGHT },
+			// The best leaf state at depth 12 of the first iteration.
+			{ "Floatiest/Depth12", ReplayMoves(floatiest, "LLRRDLLRRRRL"), BabaSolver::Direction::DOWN },
+			// The initial state of the test level.
+			{ "TestLevel/Initial", test_level, BabaSolver::Direction::UP },
+			// Baba #1 pushes the key into the door.
+			{ "TestLevel/KeyToDoor", test_level, BabaSolver::Direction::RIGHT },
+		};
+	}
+
+	void RunGameStateBenchmarks(BenchmarkRunner& runner)
+	{
+		std::vector<CorpusState> corpus = BuildCorpus();
+
+		for (const CorpusState& corpus_state : corpus)
+		{
+			const BabaSolver::GameState& state = *corpus_state.state;
+			BabaSolver::Direction direction = corpus_state.next_move;
+			runner.Run("ApplyMove/" + corpus_state.name, [&state, direction](uint64_t iterations)
+				{
+					for (uint64_t i = 0; i < iterations; ++i)
+					{
+						std::shared_ptr<BabaSolver::GameState> new_state = HideFromOptimizer(&state)->ApplyMove(direction);
+						DoNotOptimize(new_state->_baba1.i);
+					}
+				});
+		}
+
+		for (const CorpusState& corpus_state : corpus)
+		{
+			const std::shared_ptr<BabaSolver::GameState>& state = corpus_state.state;
+			runner.Run("GameStateHash/" + corpus_state.name, [&state](uint64_t iterations)
+				{
+					BabaSolver::GameStateHash hash;
+					for (uint64_t i = 0; i < iterations; ++i)
+					{
+						DoNotOptimize(hash(*HideFromOptimizer(&state)));
+					}
+				});
+		}
+
+		for (const CorpusState& corpus_state : corpus)
+		{
+			// Comparing a state with an equal copy is the worst case, since every cell is checked.
+			const std::shared_ptr<BabaSolver::GameState>& state = corpus_state.state;
+			std::shared_ptr<BabaSolver::GameState> copy = std::make_shared<BabaSolver::GameState>(*state);
+			runner.Run("GameStateEqual/" + corpus_state.name, [&state, copy](uint64_t iterations)
+				{
+					BabaSolver::GameStateEqual equal;
+					for (uint64_t i = 0; i < iterations; ++i)
+					{
+						DoNotOptimize(equal(*HideFromOptimizer(&state), copy));
+					}
+				});
+		}
+
+		for (const CorpusState& corpus_state : corpus)
+		{
+			const BabaSolver::GameState& state = *corpus_state.state;
+			runner.Run("CheckIfPossibleToWin/" + corpus_state.name, [&state](uint64_t iterations)
+				{
+					for (uint64_t i = 0; i < iterations; ++i)
+					{
+						DoNotOptimize(HideFromOptimizer(&state)->CheckIfPossibleToWin());
+					}
+				});
+		}
+
+		for (const CorpusState& corpus_state : corpus)
+		{
+			const BabaSolver::GameState& state = *corpus_state.state;
+			runner.Run("CalculateScore/" + corpus_state.name, [&state](uint64_t iterations)
+				{
+					for (uint64_t i = 0; i < iterations; ++i)
+					{
+						DoNotOptimize(static_cast<uint64_t>(HideFromOptimizer(&state)->CalculateScore()));
+					}
+				});
+		}
+	}
+
+}  // namespace BabaSolverBenchmark
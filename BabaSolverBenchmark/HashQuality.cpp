@@ -0,0 +1,248 @@
+// A report on the quality of the GameState hash functions.
+//
+// The report collects the game states that the solver caches while searching the real levels (every
+// distinct game state that can still be won, up to a fixed depth), then reports for each hash
+// function:
+//   - Speed: The average time to hash one game state.
+//   - Collisions: How many distinct game states share a full 64-bit hash, and how many share the
+//     low 32 bits, compared with the number expected from a random function.
+//   - Buckets: How evenly the hashes spread over the buckets of a hash table with a prime number of
+//     buckets (like libstdc++'s std::unordered_set) and with a power-of-two number of buckets
+//     (like MSVC's std::unordered_set, which only uses the low bits of the hash). chi2/B is the
+//     chi-squared statistic divided by the bucket count, which is about 1 for a random function.
+//   - Avalanche: How many output bits flip, on average, when one input bit of the game state
+//     flips (ideally 50%), and the worst bias of any output bit away from flipping 50% of the time.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "GameState.h"
+#include "Hash.h"
+
+#include "Benchmark.h"
+
+namespace BabaSolverBenchmark
+{
+	namespace
+	{
+		// How evenly hashes spread over the buckets of a hash table.
+		struct BucketReport
+		{
+			uint64_t bucket_count;
+			uint64_t max_load;
+			double chi_squared_per_bucket;
+		};
+	}  // namespace
+
+	// Collects the game states that the solver would cache while searching the given level: every
+	// distinct game state at each depth up to max_depth, skipping game states from which it's
+	// impossible to win, like the solver does.
+	static void CollectSearchStates(const std::shared_ptr<BabaSolver::GameState>& initial_state, int max_depth,
+		std::vector<std::shared_ptr<BabaSolver::GameState>>& states)
+	{
+		const BabaSolver::Direction directions[] = {
+			BabaSolver::Direction::UP, BabaSolver::Direction::RIGHT, BabaSolver::Direction::DOWN, BabaSolver::Direction::LEFT };
+		std::vector<std::shared_ptr<BabaSolver::GameState>> frontier = { initial_state };
+		states.push_back(initial_state);
+		for (int depth = 1; depth <= max_depth; ++depth)
+		{
+			// GameStateEqual compares the turn, so the same position at a different depth is a
+			// different game state, like in the solver's cache.
+			std::unordered_set<std::shared_ptr<BabaSolver::GameState>, BabaSolver::GameStateHash, BabaSolver::GameStateEqual> layer;
+			for (const std::shared_ptr<BabaSolver::GameState>& state : frontier)
+			{
+				for (BabaSolver::Direction direction : directions)
+				{
+					std::shared_ptr<BabaSolver::GameState> new_state = state->ApplyMove(direction);
+					if (new_state->HaveWon() || !new_state->CheckIfPossibleToWin())
+						continue;
+					layer.insert(new_state);
+				}
+			}
+			frontier.assign(layer.begin(), layer.end());
+			states.insert(states.end(), frontier.begin(), frontier.end());
+		}
+	}
+
+	static BucketReport ReportBuckets(const std::vector<uint64_t>& hashes, uint64_t bucket_count, bool power_of_two)
+	{
+		std::vector<uint64_t> loads(bucket_count);
+		for (uint64_t hash : hashes)
+		{
+			++loads[power_of_two ? (hash & (bucket_count - 1)) : (hash % bucket_count)];
+		}
+		double expected_load = static_cast<double>(hashes.size()) / bucket_count;
+		BucketReport report{};
+		report.bucket_count = bucket_count;
+		double chi_squared = 0.0;
+		for (uint64_t load : loads)
+		{
+			report.max_load = std::max(report.max_load, load);
+			chi_squared += (load - expected_load) * (load - expected_load) / expected_load;
+		}
+		report.chi_squared_per_bucket = chi_squared / bucket_count;
+		return report;
+	}
+
+	static bool IsPrime(uint64_t n)
+	{
+		if (n < 2)
+			return false;
+		for (uint64_t d = 2; d * d <= n; ++d)
+		{
+			if (n % d == 0)
+				return false;
+		}
+		return true;
+	}
+
+	// Counts the pairs of equal values in the given hashes.
+	static uint64_t CountCollisions(std::vector<uint64_t> hashes)
+	{
+		std::sort(hashes.begin(), hashes.end());
+		uint64_t collisions = 0;
+		for (std::size_t i = 1; i < hashes.size(); ++i)
+		{
+			if (hashes[i] == hashes[i - 1])
+				++collisions;
+		}
+		return collisions;
+	}
+
+	// Flips a random input bit of a copy of state. The input bits are the bits of the grid that hold
+	// GameObjects, the bits of the Baba coordinates, and the bits of the turn count. Flips that
+	// would move a Baba outside the grid are skipped, since the hash functions may assume that
+	// Babas are inside the grid.
+	static BabaSolver::GameState FlipRandomInputBit(const BabaSolver::GameState& state, std::mt19937_64& rng)
+	{
+		constexpr int grid_bits = BabaSolver::GRID_CELL_COUNT * 9;
+		constexpr int baba_bits = 4 * 5;
+		constexpr int turn_bits = 5;
+		std::uniform_int_distribution<int> random_bit(0, grid_bits + baba_bits + turn_bits - 1);
+		BabaSolver::GameState flipped(state);
+		while (true)
+		{
+			int bit = random_bit(rng);
+			if (bit < grid_bits)
+			{
+				uint16_t* grid = &flipped._grid[0][0];
+				grid[bit / 9] ^= 1 << (bit % 9);
+				return flipped;
+			}
+			bit -= grid_bits;
+			if (bit < baba_bits)
+			{
+				int8_t* babas[] = { &flipped._baba1.i, &flipped._baba1.j, &flipped._baba2.i, &flipped._baba2.j };
+				int8_t& coordinate = *babas[bit / 5];
+				int8_t new_coordinate = static_cast<int8_t>(coordinate ^ (1 << (bit % 5)));
+				if (coordinate < 0 || new_coordinate >= BabaSolver::GRID_HEIGHT)
+					continue;
+				coordinate = new_coordinate;
+				return flipped;
+			}
+			bit -= baba_bits;
+			flipped._turn ^= 1 << bit;
+			return flipped;
+		}
+	}
+
+	void RunHashQualityReport()
+	{
+		std::vector<std::shared_ptr<BabaSolver::GameState>> states;
+		CollectSearchStates(BabaSolver::FloatiestPlatformsLevel(), 13, states);
+		CollectSearchStates(BabaSolver::TestLevel(), 10, states);
+		std::cout << "Collected " << states.size() << " distinct game states from searches of the real levels.\n" << std::endl;
+
+		uint64_t prime_bucket_count = states.size();
+		while (!IsPrime(prime_bucket_count))
+		{
+			++prime_bucket_count;
+		}
+		uint64_t power_of_two_bucket_count = 1;
+		while (power_of_two_bucket_count < states.size())
+		{
+			power_of_two_bucket_count *= 2;
+		}
+		double n = static_cast<double>(states.size());
+		double expected_32_bit_collisions = n * (n - 1) / 2 / 4294967296.0;
+
+		std::cout << std::left << std::setw(10) << "Hash" << std::right << std::setw(10) << "ns/hash" << std::setw(12)
+			<< "64-bit coll" << std::setw(12) << "32-bit coll" << std::setw(16) << "prime max load" << std::setw(14)
+			<< "prime chi2/B" << std::setw(15) << "pow2 max load" << std::setw(13) << "pow2 chi2/B" << std::setw(13)
+			<< "avalanche" << std::setw(12) << "worst bias" << std::endl;
+		for (BabaSolver::HashFunction hash_function : BabaSolver::ALL_HASH_FUNCTIONS)
+		{
+			// Speed
+			std::vector<uint64_t> hashes(states.size());
+			auto start_time = std::chrono::steady_clock::now();
+			constexpr int speed_rounds = 5;
+			for (int round = 0; round < speed_rounds; ++round)
+			{
+				for (std::size_t i = 0; i < states.size(); ++i)
+				{
+					hashes[i] = BabaSolver::HashGameState(*HideFromOptimizer(states[i].get()), hash_function);
+				}
+			}
+			auto end_time = std::chrono::steady_clock::now();
+			double ns_per_hash = std::chrono::duration<double, std::nano>(end_time - start_time).count() / (speed_rounds * n);
+
+			// Collisions
+			uint64_t collisions_64_bit = CountCollisions(hashes);
+			std::vector<uint64_t> low_32_bits(hashes.size());
+			std::transform(hashes.begin(), hashes.end(), low_32_bits.begin(), [](uint64_t hash) { return hash & 0xffffffff; });
+			uint64_t collisions_32_bit = CountCollisions(low_32_bits);
+
+			// Buckets
+			BucketReport prime_report = ReportBuckets(hashes, prime_bucket_count, false);
+			BucketReport power_of_two_report = ReportBuckets(hashes, power_of_two_bucket_count, true);
+
+			// Avalanche
+			std::mt19937_64 rng(1);
+			constexpr int avalanche_samples = 100'000;
+			std::uniform_int_distribution<std::size_t> random_state(0, states.size() - 1);
+			uint64_t flipped_bit_count = 0;
+			uint64_t flip_counts_per_output_bit[64] = {};
+			for (int sample = 0; sample < avalanche_samples; ++sample)
+			{
+				const BabaSolver::GameState& state = *states[random_state(rng)];
+				BabaSolver::GameState flipped = FlipRandomInputBit(state, rng);
+				uint64_t difference = BabaSolver::HashGameState(state, hash_function) ^ BabaSolver::HashGameState(flipped, hash_function);
+				for (int bit = 0; bit < 64; ++bit)
+				{
+					if ((difference >> bit) & 1)
+					{
+						++flipped_bit_count;
+						++flip_counts_per_output_bit[bit];
+					}
+				}
+			}
+			double avalanche = static_cast<double>(flipped_bit_count) / (64.0 * avalanche_samples);
+			double worst_bias = 0.0;
+			for (uint64_t flip_count : flip_counts_per_output_bit)
+			{
+				worst_bias = std::max(worst_bias, std::abs(static_cast<double>(flip_count) / avalanche_samples - 0.5));
+			}
+
+			std::cout << std::left << std::setw(10) << BabaSolver::HashFunctionName(hash_function) << std::right << std::fixed
+				<< std::setprecision(1) << std::setw(10) << ns_per_hash << std::setw(12) << collisions_64_bit << std::setw(12)
+				<< collisions_32_bit << std::setw(16) << prime_report.max_load << std::setprecision(3) << std::setw(14)
+				<< prime_report.chi_squared_per_bucket << std::setw(15) << power_of_two_report.max_load << std::setw(13)
+				<< power_of_two_report.chi_squared_per_bucket << std::setprecision(1) << std::setw(12) << avalanche * 100 << "%"
+				<< std::setw(11) << worst_bias * 100 << "%" << std::endl;
+		}
+		std::cout << "\nExpected for a random function: 0 64-bit collisions, " << std::setprecision(1) << expected_32_bit_collisions
+			<< " 32-bit collisions, chi2/B of about 1, 50% avalanche, and a worst bias of about "
+			<< std::setprecision(1) << 100 * 3 * 0.5 / std::sqrt(static_cast<double>(100'000)) << "%." << std::endl;
+		std::cout << "Buckets: " << prime_bucket_count << " (prime), " << power_of_two_bucket_count << " (power of two)." << std::endl;
+	}
+
+}  // namespace BabaSolverBenchmark
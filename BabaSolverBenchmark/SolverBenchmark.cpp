@@ -0,0 +1,204 @@
+// End-to-end benchmarks for the solver.
+//
+// The benchmarks run Solve() on a fixed matrix of levels and solver options, repeat each
+// configuration, and write one result row per run to a JSON or CSV file. Comparing these files
+// between runs makes performance regressions visible.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GameState.h"
+#include "Memory.h"
+#include "Solver.h"
+
+#include "Benchmark.h"
+
+namespace BabaSolverBenchmark
+{
+	namespace
+	{
+		// One configuration in the benchmark matrix.
+		struct SolverBenchmarkConfig
+		{
+			std::string level_name;
+			std::function<std::shared_ptr<BabaSolver::GameState>()> create_level;
+			BabaSolver::SolverOptions options;
+		};
+
+		// The result of one run of a configuration.
+		struct SolverBenchmarkResult
+		{
+			std::string name;
+			const SolverBenchmarkConfig* config;
+			int repetition;
+			bool won;
+			uint64_t total_moves;
+			uint64_t unique_moves;
+			uint64_t cache_size;
+			uint64_t peak_rss_bytes;
+			uint64_t duration_ns;
+			double ns_per_move;
+		};
+	}  // namespace
+
+	static std::string ConfigName(const SolverBenchmarkConfig& config)
+	{
+		return config.level_name + "/depth=" + std::to_string(config.options.max_turn_depth) + "/parallelism="
+			+ std::to_string(config.options.parallelism_depth) + "/cache=" + std::to_string(config.options.max_cache_depth)
+			+ "/threads=" + std::to_string(config.options.thread_count);
+	}
+
+	// Creates the fixed matrix of configurations to benchmark.
+	static std::vector<SolverBenchmarkConfig> CreateMatrix()
+	{
+		struct Dimensions
+		{
+			int max_turn_depth;
+			int parallelism_depth;
+			int max_cache_depth;
+		};
+		Dimensions floatiest_dimensions[] = {
+			{ 10, 2, 10 },
+			{ 12, 2, 12 },
+			{ 12, 3, 12 },
+			{ 12, 2, 8 },
+			{ 14, 3, 14 },
+		};
+		unsigned int all_threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned int> thread_counts = { 1 };
+		if (all_threads > 1)
+			thread_counts.push_back(all_threads);
+
+		std::vector<SolverBenchmarkConfig> matrix;
+		for (const Dimensions& dimensions : floatiest_dimensions)
+		{
+			for (unsigned int thread_count : thread_counts)
+			{
+				SolverBenchmarkConfig config{ "Floatiest", BabaSolver::FloatiestPlatformsLevel, BabaSolver::SolverOptions() };
+				config.options.iteration_count = 1;
+				config.options.max_turn_depth = dimensions.max_turn_depth;
+				config.options.parallelism_depth = dimensions.parallelism_depth;
+				config.options.max_cache_depth = dimensions.max_cache_depth;
+				config.options.thread_count = thread_count;
+				matrix.push_back(config);
+			}
+		}
+		// The test level is won right away, so it measures the fixed overhead of Solve().
+		SolverBenchmarkConfig test_level_config{ "TestLevel", BabaSolver::TestLevel, BabaSolver::SolverOptions() };
+		test_level_config.options.thread_count = 1;
+		matrix.push_back(test_level_config);
+		return matrix;
+	}
+
+	static SolverBenchmarkResult RunOnce(const SolverBenchmarkConfig& config, int repetition)
+	{
+		std::shared_ptr<BabaSolver::GameState> initial_state = config.create_level();
+		// The tree size estimate isn't part of the search, and its game states would add to the
+		// peak RSS.
+		BabaSolver::SolverOptions options = config.options;
+		options.estimate_probe_count = 0;
+		BabaSolver::ResetPeakRss();
+
+		// The solver doesn't log anything without a log stream, so logging isn't measured.
+		BabaSolver::Solver solver(initial_state, options);
+		std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+		BabaSolver::SolverStats stats = solver.Stats();
+
+		BabaSolver::DepthStats totals = stats.Totals();
+		SolverBenchmarkResult result{};
+		result.name = ConfigName(config);
+		result.config = &config;
+		result.repetition = repetition;
+		result.won = end_state && end_state->HaveWon();
+		result.total_moves = totals.nodes_generated;
+		result.unique_moves = totals.nodes_generated - totals.cache_hits;
+		result.cache_size = stats.cache_size;
+		result.peak_rss_bytes = BabaSolver::GetPeakRssBytes();
+		result.duration_ns = stats.duration.count();
+		result.ns_per_move = totals.nodes_generated == 0 ? 0.0 : static_cast<double>(result.duration_ns) / totals.nodes_generated;
+		return result;
+	}
+
+	static void WriteJson(std::ostream& out, const std::vector<SolverBenchmarkResult>& results)
+	{
+		out << "[\n";
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const SolverBenchmarkResult& r = results[i];
+			const BabaSolver::SolverOptions& options = r.config->options;
+			out << "  {\"name\": \"" << r.name << "\", \"level\": \"" << r.config->level_name << "\""
+				<< ", \"max_turn_depth\": " << options.max_turn_depth << ", \"parallelism_depth\": " << options.parallelism_depth
+				<< ", \"max_cache_depth\": " << options.max_cache_depth << ", \"threads\": " << options.thread_count
+				<< ", \"repetition\": " << r.repetition << ", \"won\": " << (r.won ? "true" : "false")
+				<< ", \"total_moves\": " << r.total_moves << ", \"unique_moves\": " << r.unique_moves
+				<< ", \"cache_size\": " << r.cache_size << ", \"peak_rss_bytes\": " << r.peak_rss_bytes
+				<< ", \"duration_ns\": " << r.duration_ns << ", \"ns_per_move\": " << std::fixed << std::setprecision(1)
+				<< r.ns_per_move << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "]\n";
+	}
+
+	static void WriteCsv(std::ostream& out, const std::vector<SolverBenchmarkResult>& results)
+	{
+		out << "name,level,max_turn_depth,parallelism_depth,max_cache_depth,threads,repetition,won,total_moves,"
+			"unique_moves,cache_size,peak_rss_bytes,duration_ns,ns_per_move\n";
+		for (const SolverBenchmarkResult& r : results)
+		{
+			const BabaSolver::SolverOptions& options = r.config->options;
+			out << r.name << "," << r.config->level_name << "," << options.max_turn_depth << "," << options.parallelism_depth
+				<< "," << options.max_cache_depth << "," << options.thread_count << "," << r.repetition << ","
+				<< (r.won ? 1 : 0) << "," << r.total_moves << "," << r.unique_moves << "," << r.cache_size << ","
+				<< r.peak_rss_bytes << "," << r.duration_ns << "," << std::fixed << std::setprecision(1) << r.ns_per_move << "\n";
+		}
+	}
+
+	bool RunSolverBenchmarks(const std::string& filter, int repetitions, const std::string& output_path)
+	{
+		std::regex filter_regex(filter);
+		std::vector<SolverBenchmarkConfig> matrix = CreateMatrix();
+		std::vector<SolverBenchmarkResult> results;
+		std::cout << std::left << std::setw(56) << "Configuration" << std::right << std::setw(14) << "Moves"
+			<< std::setw(14) << "Peak RSS (MB)" << std::setw(18) << "Time" << std::endl;
+		for (const SolverBenchmarkConfig& config : matrix)
+		{
+			std::string name = ConfigName(config);
+			if (!std::regex_search(name, filter_regex))
+				continue;
+			for (int repetition = 0; repetition < repetitions; ++repetition)
+			{
+				SolverBenchmarkResult result = RunOnce(config, repetition);
+				std::cout << std::left << std::setw(56) << result.name << std::right << std::setw(14) << result.total_moves
+					<< std::setw(14) << (result.peak_rss_bytes / (1024 * 1024)) << std::setw(12) << std::fixed
+					<< std::setprecision(1) << result.ns_per_move << " ns/move" << std::endl;
+				results.push_back(result);
+			}
+		}
+
+		if (output_path.empty())
+			return true;
+		std::ofstream out(output_path);
+		if (!out)
+		{
+			std::cout << "Unable to open output file: " << output_path << std::endl;
+			return false;
+		}
+		bool is_csv = output_path.size() >= 4 && output_path.compare(output_path.size() - 4, 4, ".csv") == 0;
+		if (is_csv)
+			WriteCsv(out, results);
+		else
+			WriteJson(out, results);
+		std::cout << "Wrote " << results.size() << " results to " << output_path << std::endl;
+		return true;
+	}
+
+}  // namespace BabaSolverBenchmark
@@ -0,0 +1,82 @@
+// Tests for SolveBatch() and ThreadPool.
+
+#include "pch.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "Batch.h"
+#include "GameState.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+TEST(BatchTest, ThreadPoolRunsEveryTask)
+{
+	BabaSolver::ThreadPool thread_pool(3);
+	EXPECT_EQ(thread_pool.ThreadCount(), 3u);
+	std::vector<std::atomic<int>> runs(100);
+	thread_pool.RunAndWait(100, [&runs](unsigned int i) { ++runs[i]; });
+	for (const std::atomic<int>& run_count : runs)
+	{
+		EXPECT_EQ(run_count, 1);
+	}
+}
+
+TEST(BatchTest, SharedPoolDoesNotChangeResults)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 8;
+	options.thread_count = 2;
+	BabaSolver::SolverStats own_threads_stats;
+	BabaSolver::Solver own_threads_solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	own_threads_solver.Run();
+	own_threads_stats = own_threads_solver.Stats();
+
+	BabaSolver::ThreadPool thread_pool(4);
+	BabaSolver::Solver pool_solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	pool_solver.SetThreadPool(&thread_pool);
+	pool_solver.Run();
+	EXPECT_EQ(pool_solver.Stats().Totals().nodes_generated, own_threads_stats.Totals().nodes_generated);
+}
+
+TEST(BatchTest, SolvesEveryLevel)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 2;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 8;
+	std::vector<BabaSolver::BatchLevel> levels;
+	levels.push_back(BabaSolver::BatchLevel{ "floatiest", BabaSolver::FloatiestPlatformsLevel(), options, {} });
+	levels.push_back(BabaSolver::BatchLevel{ "test", BabaSolver::TestLevel(), options, {} });
+	// This search would take far too long without its time budget.
+	BabaSolver::SolverOptions slow_options = options;
+	slow_options.max_turn_depth = 25;
+	slow_options.max_cache_depth = 20;
+	slow_options.estimate_probe_count = 0;
+	levels.push_back(BabaSolver::BatchLevel{ "slow", BabaSolver::FloatiestPlatformsLevel(), slow_options, std::chrono::milliseconds(200) });
+
+	BabaSolver::BatchOptions batch_options;
+	batch_options.thread_count = 2;
+	std::vector<std::size_t> finished_indexes;
+	std::vector<BabaSolver::BatchResult> results = BabaSolver::SolveBatch(levels, batch_options,
+		[&finished_indexes](const BabaSolver::BatchResult& result) { finished_indexes.push_back(result.index); });
+
+	ASSERT_EQ(results.size(), 3u);
+	EXPECT_EQ(finished_indexes.size(), 3u);
+	EXPECT_EQ(results[0].name, "floatiest");
+	EXPECT_FALSE(results[0].won);
+	EXPECT_FALSE(results[0].timed_out);
+	EXPECT_EQ(results[0].stats.iteration_count, 2);
+	// Both iterations searched the full depth, so the moves of both are in the result.
+	EXPECT_EQ(results[0].moves.size(), 16u);
+	EXPECT_TRUE(results[1].won);
+	EXPECT_EQ(results[1].moves, BabaSolver::FormatMoves(*results[1].end_state));
+	std::optional<std::vector<BabaSolver::Direction>> moves = BabaSolver::ParseMoves(results[1].moves);
+	EXPECT_TRUE(BabaSolver::TestLevel()->ApplyMoves(*moves)->HaveWon());
+	EXPECT_TRUE(results[2].timed_out);
+	EXPECT_FALSE(results[2].won);
+	EXPECT_LT(results[2].duration, std::chrono::seconds(10));
+}
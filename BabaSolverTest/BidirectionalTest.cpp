@@ -0,0 +1,123 @@
+// Tests for GameState::UndoMove() and the bidirectional search.
+
+#include "pch.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Bidirectional.h"
+#include "GameState.h"
+#include "Planner.h"
+#include "Shorten.h"
+#include "Solver.h"
+
+namespace
+{
+	const BabaSolver::Direction ALL_DIRECTIONS[] = { BabaSolver::Direction::UP, BabaSolver::Direction::RIGHT,
+		BabaSolver::Direction::DOWN, BabaSolver::Direction::LEFT };
+
+	// Returns true if the game objects of lhs and rhs are in the same positions.
+	bool SamePositions(const std::shared_ptr<BabaSolver::GameState>& lhs, const std::shared_ptr<BabaSolver::GameState>& rhs)
+	{
+		std::shared_ptr<BabaSolver::GameState> lhs_copy = std::make_shared<BabaSolver::GameState>(*lhs);
+		std::shared_ptr<BabaSolver::GameState> rhs_copy = std::make_shared<BabaSolver::GameState>(*rhs);
+		lhs_copy->ResetContext();
+		rhs_copy->ResetContext();
+		return BabaSolver::GameStateEqual()(lhs_copy, rhs_copy);
+	}
+
+	// Checks that undoing direction from state's next game state finds state, and only game states
+	// that lead back to the next game state.
+	void ExpectUndoFindsPreviousState(const std::shared_ptr<BabaSolver::GameState>& state, BabaSolver::Direction direction)
+	{
+		// UndoMove() leaves out game states with a dead Baba.
+		std::shared_ptr<BabaSolver::GameState> next_state = state->ApplyMove(direction);
+		if (next_state->CheckWhyImpossibleToWin() == BabaSolver::LossReason::DEAD_BABA)
+			return;
+		std::vector<std::shared_ptr<BabaSolver::GameState>> previous_states = next_state->UndoMove(direction);
+		bool found = false;
+		for (const std::shared_ptr<BabaSolver::GameState>& previous_state : previous_states)
+		{
+			found = found || SamePositions(previous_state, state);
+			EXPECT_TRUE(SamePositions(previous_state->ApplyMove(direction), next_state));
+		}
+		EXPECT_TRUE(found) << BabaSolver::FormatMoves(*state) << " + " << BabaSolver::FormatMoves({ direction });
+	}
+}  // namespace
+
+TEST(BidirectionalTest, UndoMoveFindsThePreviousGameState)
+{
+	std::vector<std::shared_ptr<BabaSolver::GameState>> states = { BabaSolver::FloatiestPlatformsLevel() };
+	for (int depth = 0; depth < 4; ++depth)
+	{
+		std::vector<std::shared_ptr<BabaSolver::GameState>> next_states;
+		for (const std::shared_ptr<BabaSolver::GameState>& state : states)
+		{
+			for (BabaSolver::Direction direction : ALL_DIRECTIONS)
+			{
+				ExpectUndoFindsPreviousState(state, direction);
+				std::shared_ptr<BabaSolver::GameState> next_state = state->ApplyMove(direction);
+				if (next_state->CheckIfPossibleToWin())
+					next_states.push_back(next_state);
+			}
+		}
+		states = std::move(next_states);
+	}
+}
+
+TEST(BidirectionalTest, UndoMovePullsTheKeyOutOfTheDoor)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+	std::shared_ptr<BabaSolver::GameState> won_state = level->ApplyMove(BabaSolver::Direction::RIGHT);
+	ASSERT_TRUE(won_state->HaveWon());
+	ExpectUndoFindsPreviousState(level, BabaSolver::Direction::RIGHT);
+	// Winning game states are left out, since the game is over once it's won.
+	for (BabaSolver::Direction direction : ALL_DIRECTIONS)
+	{
+		for (const std::shared_ptr<BabaSolver::GameState>& previous_state : won_state->UndoMove(direction))
+			EXPECT_FALSE(previous_state->HaveWon());
+	}
+}
+
+TEST(BidirectionalTest, FindsTheShortestMovesToAGoalState)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> goal = BabaSolver::ReplayPrefix(level, *BabaSolver::ParseMoves("RRUULLDDRRDL"), error);
+	ASSERT_TRUE(goal) << error;
+
+	// A breadth-first search for the goal finds the shortest moves.
+	std::vector<BabaSolver::Milestone> milestones = {
+		BabaSolver::Milestone{ "Goal", [goal](const BabaSolver::GameState& state)
+			{
+				return SamePositions(std::make_shared<BabaSolver::GameState>(state), goal);
+			} },
+	};
+	BabaSolver::PlannerOptions planner_options;
+	planner_options.alternatives_per_stage = 1;
+	BabaSolver::PlanResult shortest = BabaSolver::PlanMilestones(level, milestones, planner_options);
+	ASSERT_TRUE(shortest.completed);
+
+	BabaSolver::BidirectionalResult result = BabaSolver::SearchBidirectional(level, { goal }, BabaSolver::BidirectionalOptions());
+	ASSERT_TRUE(result.found);
+	EXPECT_EQ(result.moves.size(), shortest.moves.size());
+	EXPECT_TRUE(SamePositions(BabaSolver::ReplayMoves(level, result.moves), goal));
+	// Both searches did part of the work.
+	EXPECT_GT(result.stats.forward_depth, 0);
+	EXPECT_GT(result.stats.backward_depth, 0);
+	EXPECT_LT(result.stats.forward_depth, static_cast<int>(result.moves.size()));
+}
+
+TEST(BidirectionalTest, StopsAtMaxMoves)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> goal = BabaSolver::ReplayPrefix(level, *BabaSolver::ParseMoves("RRUULLDDRRDL"), error);
+	ASSERT_TRUE(goal) << error;
+	BabaSolver::BidirectionalOptions options;
+	options.max_moves = 2;
+	BabaSolver::BidirectionalResult result = BabaSolver::SearchBidirectional(level, { goal }, options);
+	EXPECT_FALSE(result.found);
+	EXPECT_LE(result.stats.forward_depth + result.stats.backward_depth, options.max_moves);
+}
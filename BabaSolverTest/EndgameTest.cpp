@@ -0,0 +1,149 @@
+// Tests for the endgame tablebase.
+
+#include "pch.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Endgame.h"
+#include "GameState.h"
+#include "Shorten.h"
+#include "Solver.h"
+
+#include "TempFile.h"
+
+namespace
+{
+	// A solution of the Floatiest Platforms. The Babas are on the same space after the first
+	// BABAS_TOGETHER_MOVES moves.
+	const char FLOATIEST_SOLUTION[] = "DRRLLLLUUURDRDDLULURDLDRRRRULLLUURRRDDUULDDUULDDLDDRRURULLULDLDRRRRRRRRRRRRDDDDDLLLLLLLLLULD";
+	const std::size_t BABAS_TOGETHER_MOVES = 75;
+
+	// Returns the game state after the first move_count moves of FLOATIEST_SOLUTION.
+	std::shared_ptr<BabaSolver::GameState> FloatiestStateAfter(std::size_t move_count)
+	{
+		std::vector<BabaSolver::Direction> moves = *BabaSolver::ParseMoves(FLOATIEST_SOLUTION);
+		moves.resize(move_count);
+		return BabaSolver::ReplayMoves(BabaSolver::FloatiestPlatformsLevel(), moves);
+	}
+}  // namespace
+
+TEST(EndgameTest, FindsTheFewestMovesToTheWin)
+{
+	std::size_t solution_size = BabaSolver::ParseMoves(FLOATIEST_SOLUTION)->size();
+	BabaSolver::EndgameTablebase tablebase(1);
+	for (std::size_t move_count = BABAS_TOGETHER_MOVES; move_count <= solution_size; ++move_count)
+	{
+		std::shared_ptr<BabaSolver::GameState> state = FloatiestStateAfter(move_count);
+		ASSERT_TRUE(state->BabasOnSameSpace());
+		std::optional<std::vector<BabaSolver::Direction>> moves = tablebase.FindWin(*state);
+		ASSERT_TRUE(moves) << move_count;
+		EXPECT_TRUE(BabaSolver::ReplayMoves(state, *moves)->HaveWon()) << BabaSolver::FormatMoves(*moves);
+		EXPECT_LE(moves->size(), solution_size - move_count);
+	}
+	// The other game objects don't move in the endgame, so one table covers all of it.
+	EXPECT_EQ(tablebase.TableCount(), 1u);
+}
+
+TEST(EndgameTest, OnlyAppliesOnceTheBabasAreTogether)
+{
+	BabaSolver::EndgameTablebase tablebase(1);
+	std::shared_ptr<BabaSolver::GameState> state = FloatiestStateAfter(BABAS_TOGETHER_MOVES - 1);
+	ASSERT_FALSE(state->BabasOnSameSpace());
+	EXPECT_FALSE(tablebase.FindWin(*state));
+	EXPECT_EQ(tablebase.TableCount(), 0u);
+}
+
+TEST(EndgameTest, StopsAtMaxTables)
+{
+	BabaSolver::EndgameTablebase tablebase(0);
+	EXPECT_FALSE(tablebase.FindWin(*FloatiestStateAfter(BABAS_TOGETHER_MOVES)));
+	EXPECT_EQ(tablebase.TableCount(), 0u);
+}
+
+TEST(EndgameTest, ThreadsComputeEachTableOnce)
+{
+	BabaSolver::EndgameTablebase tablebase(1);
+	std::shared_ptr<BabaSolver::GameState> state = FloatiestStateAfter(BABAS_TOGETHER_MOVES);
+	std::vector<std::optional<std::vector<BabaSolver::Direction>>> results(4);
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < results.size(); ++i)
+		threads.emplace_back([&tablebase, &state, &results, i]() { results[i] = tablebase.FindWin(*state); });
+	for (std::thread& thread : threads)
+		thread.join();
+	// The threads that found another thread computing the table didn't wait for it.
+	bool found = false;
+	for (const std::optional<std::vector<BabaSolver::Direction>>& moves : results)
+	{
+		if (moves)
+		{
+			EXPECT_TRUE(BabaSolver::ReplayMoves(state, *moves)->HaveWon());
+		}
+		found = found || moves.has_value();
+	}
+	EXPECT_TRUE(found);
+	EXPECT_EQ(tablebase.TableCount(), 1u);
+	EXPECT_TRUE(tablebase.FindWin(*state));
+}
+
+TEST(EndgameTest, SolverResolvesTheEndgame)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<BabaSolver::Direction> prefix = *BabaSolver::ParseMoves(FLOATIEST_SOLUTION);
+	prefix.resize(BABAS_TOGETHER_MOVES - 2);
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 3;
+	options.parallelism_depth = 1;
+	options.estimate_probe_count = 0;
+
+	// The win is too deep for the search alone.
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::SolveFrom(level, prefix, options, error);
+	ASSERT_TRUE(end_state) << error;
+	EXPECT_FALSE(end_state->HaveWon());
+
+	options.max_endgame_tables = 1;
+	BabaSolver::SolverStats stats;
+	end_state = BabaSolver::SolveFrom(level, prefix, options, error, &stats);
+	ASSERT_TRUE(end_state);
+	ASSERT_TRUE(end_state->HaveWon());
+	EXPECT_GT(end_state->_turn, options.max_turn_depth);
+	EXPECT_GT(stats.Totals().endgame_wins, 0u);
+
+	std::vector<BabaSolver::Direction> solution = prefix;
+	solution.insert(solution.end(), end_state->_moves, end_state->_moves + end_state->_turn);
+	EXPECT_TRUE(BabaSolver::ReplayMoves(level, solution)->HaveWon());
+}
+
+TEST(EndgameTest, TranspositionTableDoesNotHideEndgameWins)
+{
+	BabaSolverTest::TempFile file("endgame_transposition.bin");
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<BabaSolver::Direction> prefix = *BabaSolver::ParseMoves(FLOATIEST_SOLUTION);
+	prefix.resize(BABAS_TOGETHER_MOVES - 2);
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 3;
+	options.parallelism_depth = 1;
+	options.estimate_probe_count = 0;
+	options.transposition_file = file.Path();
+	options.transposition_table_bytes = 1024 * 1024;
+
+	// The search alone records the game states from which it can't win in the moves it has.
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::SolveFrom(level, prefix, options, error);
+	ASSERT_TRUE(end_state) << error;
+	EXPECT_FALSE(end_state->HaveWon());
+
+	// The tablebase wins from them past max_turn_depth, so they must not be pruned.
+	options.max_endgame_tables = 1;
+	BabaSolver::SolverStats stats;
+	end_state = BabaSolver::SolveFrom(level, prefix, options, error, &stats);
+	ASSERT_TRUE(end_state) << error;
+	EXPECT_TRUE(end_state->HaveWon());
+	EXPECT_EQ(stats.Totals().pruned_transposition, 0u);
+}
@@ -0,0 +1,73 @@
+// Tests for EstimateTreeSize() and SuggestDepths().
+
+#include "pch.h"
+
+#include <chrono>
+
+#include "Estimate.h"
+#include "GameState.h"
+#include "Solver.h"
+
+TEST(EstimateTest, ExactDepthsMatchSolver)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 6;
+	options.parallelism_depth = 3;
+	BabaSolver::TreeSizeEstimate estimate = BabaSolver::EstimateTreeSize(BabaSolver::FloatiestPlatformsLevel(), options, options.max_turn_depth);
+	ASSERT_EQ(estimate.exact_depth, options.max_turn_depth);
+	BabaSolver::SolverStats stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &stats);
+	for (int depth = 1; depth <= options.max_turn_depth; ++depth)
+	{
+		EXPECT_EQ(estimate.nodes_generated[depth], stats.depths[depth].nodes_generated) << "depth " << depth;
+	}
+	EXPECT_EQ(stats.estimated_nodes, stats.Totals().nodes_generated);
+}
+
+TEST(EstimateTest, ProbesEstimateUncachedTree)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 9;
+	options.max_cache_depth = 0;
+	options.estimate_probe_count = 20'000;
+	BabaSolver::TreeSizeEstimate estimate =
+		BabaSolver::EstimateTreeSize(BabaSolver::FloatiestPlatformsLevel(), options, options.max_turn_depth, /*exact_state_limit=*/100);
+	EXPECT_LT(estimate.exact_depth, 4);
+	BabaSolver::SolverStats stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &stats);
+	// Without a cache, Knuth's estimate is unbiased, so with enough probes it's close.
+	double actual = static_cast<double>(stats.Totals().nodes_generated);
+	EXPECT_NEAR(estimate.TotalNodes(options.max_turn_depth), actual, 0.1 * actual);
+}
+
+TEST(EstimateTest, SuggestDepthsFitsBudget)
+{
+	BabaSolver::TreeSizeEstimate estimate;
+	estimate.max_depth = 10;
+	estimate.exact_depth = 10;
+	estimate.nanoseconds_per_node = 1.0;
+	for (int depth = 1; depth <= estimate.max_depth; ++depth)
+	{
+		estimate.nodes_generated[depth] = 1 << (2 * depth);
+	}
+	// 4 + 16 + 64 + 256 + 1024 nodes at 1 nanosecond per node.
+	BabaSolver::DepthSuggestion suggestion = BabaSolver::SuggestDepths(estimate, std::chrono::nanoseconds(1364), 1);
+	EXPECT_EQ(suggestion.max_turn_depth, 5);
+	EXPECT_EQ(suggestion.estimated_nodes, 1364);
+	EXPECT_EQ(suggestion.parallelism_depth, 2);
+
+	// Two threads search 4 + ... + 4096 nodes in 2730 nanoseconds.
+	suggestion = BabaSolver::SuggestDepths(estimate, std::chrono::nanoseconds(2730), 2);
+	EXPECT_EQ(suggestion.max_turn_depth, 6);
+	EXPECT_EQ(suggestion.parallelism_depth, 2);
+	// More threads need more parallelism roots.
+	suggestion = BabaSolver::SuggestDepths(estimate, std::chrono::nanoseconds(2730), 4);
+	EXPECT_EQ(suggestion.parallelism_depth, 3);
+
+	// If nothing fits, one move deep is suggested.
+	suggestion = BabaSolver::SuggestDepths(estimate, std::chrono::nanoseconds(0), 1);
+	EXPECT_EQ(suggestion.max_turn_depth, 1);
+}
@@ -0,0 +1,34 @@
+// Tests for the GameState hash functions.
+
+#include "pch.h"
+
+#include <cstring>
+
+#include "GameState.h"
+#include "Hash.h"
+
+TEST(HashTest, Xxh64MatchesReferenceTestVectors)
+{
+	EXPECT_EQ(BabaSolver::Xxh64("", 0, 0), 0xef46db3751d8e999ull);
+	EXPECT_EQ(BabaSolver::Xxh64("abc", 3, 0), 0x44bc2cf5ad770999ull);
+	const char* long_input = "Nobody inspects the spammish repetition";
+	EXPECT_EQ(BabaSolver::Xxh64(long_input, std::strlen(long_input), 0), 0xfbcea83c8a378bf1ull);
+}
+
+TEST(HashTest, HashFunctionsAgreeWithGameStateEqual)
+{
+	// The same position reached by different moves is equal, so it must have the same hash.
+	std::shared_ptr<BabaSolver::GameState> initial_state = BabaSolver::FloatiestPlatformsLevel();
+	std::shared_ptr<BabaSolver::GameState> left_right = initial_state->ApplyMoves(*BabaSolver::ParseMoves("LR"));
+	std::shared_ptr<BabaSolver::GameState> right_left = initial_state->ApplyMoves(*BabaSolver::ParseMoves("RL"));
+	ASSERT_TRUE(BabaSolver::GameStateEqual()(left_right, right_left));
+	std::shared_ptr<BabaSolver::GameState> up = initial_state->ApplyMoves(*BabaSolver::ParseMoves("UU"));
+	ASSERT_FALSE(BabaSolver::GameStateEqual()(left_right, up));
+	for (BabaSolver::HashFunction hash_function : BabaSolver::ALL_HASH_FUNCTIONS)
+	{
+		EXPECT_EQ(BabaSolver::HashGameState(*left_right, hash_function), BabaSolver::HashGameState(*right_left, hash_function))
+			<< BabaSolver::HashFunctionName(hash_function);
+		EXPECT_NE(BabaSolver::HashGameState(*left_right, hash_function), BabaSolver::HashGameState(*up, hash_function))
+			<< BabaSolver::HashFunctionName(hash_function);
+	}
+}
@@ -0,0 +1,75 @@
+// Tests for reading and writing level files.
+
+#include "pch.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "GameState.h"
+#include "Level.h"
+
+// Writes level and reads it back.
+static std::shared_ptr<BabaSolver::GameState> RoundTrip(const BabaSolver::GameState& level)
+{
+	std::stringstream stream;
+	EXPECT_TRUE(BabaSolver::WriteLevel(level, stream));
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> parsed = BabaSolver::ParseLevel(stream, error);
+	EXPECT_EQ(error, "");
+	return parsed;
+}
+
+TEST(LevelTest, RoundTripsBuiltInLevels)
+{
+	for (const std::shared_ptr<BabaSolver::GameState>& level : { BabaSolver::FloatiestPlatformsLevel(), BabaSolver::TestLevel() })
+	{
+		std::shared_ptr<BabaSolver::GameState> parsed = RoundTrip(*level);
+		ASSERT_TRUE(parsed);
+		EXPECT_TRUE(BabaSolver::GameStateEqual()(parsed, level));
+		// The cached state (e.g. where the key is) is recalculated, so the levels play the same.
+		std::optional<std::vector<BabaSolver::Direction>> moves = BabaSolver::ParseMoves("RRDDLLUURDLU");
+		EXPECT_TRUE(BabaSolver::GameStateEqual()(parsed->ApplyMoves(*moves), level->ApplyMoves(*moves)));
+	}
+}
+
+TEST(LevelTest, LoadsBuiltInLevelsByName)
+{
+	std::string error;
+	EXPECT_TRUE(BabaSolver::GameStateEqual()(BabaSolver::LoadLevel("floatiest", error), BabaSolver::FloatiestPlatformsLevel()));
+	EXPECT_TRUE(BabaSolver::GameStateEqual()(BabaSolver::LoadLevel("test", error), BabaSolver::TestLevel()));
+	EXPECT_FALSE(BabaSolver::LoadLevel("no_such_level.txt", error));
+	EXPECT_NE(error.find("no_such_level.txt"), std::string::npos);
+}
+
+TEST(LevelTest, RejectsInvalidLevels)
+{
+	std::stringstream valid;
+	BabaSolver::WriteLevel(*BabaSolver::TestLevel(), valid);
+	std::string text = valid.str();
+	std::size_t objects_start = text.find("objects:\n") + std::string("objects:\n").size();
+
+	auto parse_error = [](const std::string& level_text)
+		{
+			std::istringstream stream(level_text);
+			std::string error;
+			EXPECT_FALSE(BabaSolver::ParseLevel(stream, error));
+			return error;
+		};
+	EXPECT_NE(parse_error("# Comments only\n").find("tiles:"), std::string::npos);
+	EXPECT_NE(parse_error(text.substr(0, text.size() - 5) + "\n").find("cells instead of"), std::string::npos);
+	std::string unknown_object = text;
+	unknown_object[objects_start] = '?';
+	EXPECT_NE(parse_error(unknown_object).find("Invalid game object '?'"), std::string::npos);
+	std::string extra_baba = text;
+	extra_baba[objects_start] = 'B';
+	EXPECT_NE(parse_error(extra_baba).find("exactly one Baba #1"), std::string::npos);
+	// The game engine needs the key and the "IS" text block.
+	std::string no_key = text;
+	no_key[text.find('K', objects_start)] = '.';
+	EXPECT_NE(parse_error(no_key).find("exactly one key"), std::string::npos);
+	std::string no_is_text = text;
+	no_is_text[text.find('2', objects_start)] = '.';
+	EXPECT_NE(parse_error(no_is_text).find("exactly one key and one \"IS\" text block, not 1 and 0"), std::string::npos);
+	EXPECT_NE(parse_error(text + "extra\n").find("Unexpected line"), std::string::npos);
+}
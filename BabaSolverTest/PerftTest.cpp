@@ -0,0 +1,94 @@
+// Tests for Perft(). The expected counts were recorded from the game engine before any performance
+// work on it, so any change to the counts means that the game rules changed.
+
+#include "pch.h"
+
+#include "GameState.h"
+#include "Perft.h"
+
+static void ExpectCounts(const BabaSolver::PerftResult& result, const std::vector<BabaSolver::PerftDepthCounts>& expected)
+{
+	ASSERT_EQ(result.depths.size(), expected.size() + 1);
+	for (std::size_t i = 0; i < expected.size(); ++i)
+	{
+		const BabaSolver::PerftDepthCounts& actual = result.depths[i + 1];
+		EXPECT_EQ(actual.nodes, expected[i].nodes) << "depth " << i + 1;
+		EXPECT_EQ(actual.wins, expected[i].wins) << "depth " << i + 1;
+		EXPECT_EQ(actual.noop_moves, expected[i].noop_moves) << "depth " << i + 1;
+		EXPECT_EQ(actual.dead_baba, expected[i].dead_baba) << "depth " << i + 1;
+	}
+}
+
+TEST(PerftTest, FloatiestPlatforms)
+{
+	BabaSolver::PerftResult result = BabaSolver::Perft(BabaSolver::FloatiestPlatformsLevel(), 8, /*dedup=*/false, 0);
+	ExpectCounts(result, {
+		{ 4, 0, 0, 0 },
+		{ 16, 0, 0, 0 },
+		{ 64, 0, 0, 4 },
+		{ 256, 0, 16, 40 },
+		{ 1024, 0, 160, 268 },
+		{ 4096, 0, 1072, 1432 },
+		{ 16384, 0, 5728, 7204 },
+		{ 65536, 0, 28816, 33352 },
+	});
+}
+
+TEST(PerftTest, FloatiestPlatformsWithDedup)
+{
+	BabaSolver::PerftResult result = BabaSolver::Perft(BabaSolver::FloatiestPlatformsLevel(), 8, /*dedup=*/true, 0);
+	ExpectCounts(result, {
+		{ 4, 0, 0, 0 },
+		{ 13, 0, 0, 0 },
+		{ 46, 0, 0, 2 },
+		{ 119, 0, 0, 17 },
+		{ 225, 0, 0, 15 },
+		{ 502, 0, 0, 56 },
+		{ 981, 0, 0, 78 },
+		{ 2125, 0, 0, 223 },
+	});
+}
+
+TEST(PerftTest, TestLevel)
+{
+	BabaSolver::PerftResult result = BabaSolver::Perft(BabaSolver::TestLevel(), 8, /*dedup=*/false, 0);
+	ExpectCounts(result, {
+		{ 4, 1, 0, 1 },
+		{ 12, 0, 0, 6 },
+		{ 48, 2, 0, 30 },
+		{ 184, 0, 12, 134 },
+		{ 736, 8, 112, 586 },
+		{ 2912, 0, 730, 2466 },
+		{ 11648, 42, 3854, 10310 },
+		{ 46424, 2, 19366, 42374 },
+	});
+}
+
+TEST(PerftTest, TestLevelWithDedup)
+{
+	BabaSolver::PerftResult result = BabaSolver::Perft(BabaSolver::TestLevel(), 8, /*dedup=*/true, 0);
+	ExpectCounts(result, {
+		{ 4, 1, 0, 1 },
+		{ 10, 0, 0, 5 },
+		{ 24, 1, 0, 14 },
+		{ 42, 0, 0, 24 },
+		{ 83, 1, 0, 46 },
+		{ 164, 0, 0, 95 },
+		{ 287, 1, 0, 171 },
+		{ 474, 2, 0, 281 },
+	});
+}
+
+TEST(PerftTest, ThreadCountDoesNotChangeCounts)
+{
+	for (bool dedup : { false, true })
+	{
+		BabaSolver::PerftResult one_thread = BabaSolver::Perft(BabaSolver::FloatiestPlatformsLevel(), 7, dedup, 1);
+		BabaSolver::PerftResult four_threads = BabaSolver::Perft(BabaSolver::FloatiestPlatformsLevel(), 7, dedup, 4);
+		for (int depth = 0; depth <= 7; ++depth)
+		{
+			EXPECT_EQ(one_thread.depths[depth].nodes, four_threads.depths[depth].nodes);
+			EXPECT_EQ(one_thread.depths[depth].dead_baba, four_threads.depths[depth].dead_baba);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+// Tests for the milestone planner.
+
+#include "pch.h"
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "GameState.h"
+#include "Planner.h"
+#include "Shorten.h"
+
+TEST(PlannerTest, SolvesTheFloatiestPlatforms)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<BabaSolver::Milestone> milestones = BabaSolver::FloatiestPlatformsMilestones();
+	BabaSolver::PlanResult result = BabaSolver::PlanMilestones(level, milestones, BabaSolver::PlannerOptions());
+	ASSERT_TRUE(result.completed);
+	EXPECT_TRUE(BabaSolver::ReplayMoves(level, result.moves)->HaveWon());
+	EXPECT_EQ(result.stage_moves.size(), milestones.size());
+	EXPECT_EQ(std::accumulate(result.stage_moves.begin(), result.stage_moves.end(), std::size_t{ 0 }), result.moves.size());
+}
+
+TEST(PlannerTest, WinMilestonesFindTheShortestWin)
+{
+	BabaSolver::PlanResult result = BabaSolver::PlanMilestones(BabaSolver::TestLevel(), BabaSolver::WinMilestones(), BabaSolver::PlannerOptions());
+	ASSERT_TRUE(result.completed);
+	EXPECT_EQ(BabaSolver::FormatMoves(result.moves), "R");
+}
+
+TEST(PlannerTest, BacktracksWhenALaterMilestoneIsNotReached)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	BabaSolver::Coordinate baba1 = level->_baba1;
+	std::vector<BabaSolver::Milestone> milestones = {
+		BabaSolver::Milestone{ "Baba #1 moved", [baba1](const BabaSolver::GameState& state)
+			{
+				return state._baba1.i != baba1.i || state._baba1.j != baba1.j;
+			} },
+		BabaSolver::Milestone{ "Never", [](const BabaSolver::GameState&) { return false; } },
+	};
+	BabaSolver::PlannerOptions options;
+	options.max_stage_moves = 2;
+	options.alternatives_per_stage = 3;
+	BabaSolver::PlanResult result = BabaSolver::PlanMilestones(level, milestones, options);
+	EXPECT_FALSE(result.completed);
+	// The second milestone is searched for from each of the alternatives of the first one.
+	EXPECT_EQ(result.stats.stage_searches, 1 + options.alternatives_per_stage);
+	EXPECT_EQ(result.stats.backtracks, options.alternatives_per_stage - 1);
+	// The moves reach the first milestone.
+	ASSERT_EQ(result.stage_moves.size(), 1u);
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::ReplayMoves(level, result.moves);
+	EXPECT_TRUE(milestones[0].is_reached(*end_state));
+}
@@ -0,0 +1,203 @@
+#include "pch.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <vector>
+
+#include "GameState.h"
+
+#include "ReferenceEngine.h"
+
+using BabaSolver::Coordinate;
+using BabaSolver::Direction;
+using BabaSolver::GameObject;
+using BabaSolver::GRID_HEIGHT;
+using BabaSolver::GRID_WIDTH;
+
+namespace BabaSolverTest
+{
+	static const GameObject ALL_GAME_OBJECTS[] = {
+		GameObject::BABA, GameObject::IMMOVABLE, GameObject::TILE, GameObject::ROCK, GameObject::DOOR,
+		GameObject::KEY, GameObject::ROCK_TEXT, GameObject::IS_TEXT, GameObject::PUSH_TEXT };
+
+	static bool InBounds(int i, int j)
+	{
+		return i >= 0 && i < GRID_HEIGHT && j >= 0 && j < GRID_WIDTH;
+	}
+
+	ReferenceState::ReferenceState(const BabaSolver::GameState& state)
+	{
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				for (GameObject obj : ALL_GAME_OBJECTS)
+				{
+					if ((state._grid[i][j] & (1 << static_cast<uint16_t>(obj))) != 0)
+						_cells[i][j].insert(obj);
+				}
+			}
+		}
+		Coordinate babas[] = { state._baba1, state._baba2 };
+		for (int index = 0; index < 2; ++index)
+		{
+			if (babas[index].i >= 0)
+				_babas[index] = babas[index];
+		}
+		KillUnsupportedBabas();
+	}
+
+	void ReferenceState::ApplyMove(Direction direction)
+	{
+		int8_t delta_i = 0;
+		int8_t delta_j = 0;
+		switch (direction)
+		{
+		case Direction::UP: delta_i = -1; break;
+		case Direction::RIGHT: delta_j = 1; break;
+		case Direction::DOWN: delta_i = 1; break;
+		case Direction::LEFT: delta_j = -1; break;
+		default:
+			// Programmer error
+			std::cerr << "Invalid direction in ReferenceState::ApplyMove(): " << static_cast<uint32_t>(direction) << std::endl;
+			std::abort();
+		}
+
+		// The rules are read once at the start of the turn, so if Baba #1 breaks "ROCK IS PUSH",
+		// Baba #2 can still push rocks during the same turn.
+		bool rock_is_push = RockIsPush();
+		MoveBaba(0, delta_i, delta_j, rock_is_push);
+		MoveBaba(1, delta_i, delta_j, rock_is_push);
+		KillUnsupportedBabas();
+	}
+
+	bool ReferenceState::HaveWon() const
+	{
+		for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int8_t j = 0; j < GRID_WIDTH; ++j)
+			{
+				if (_cells[i][j].count(GameObject::DOOR) != 0 && _cells[i][j].count(GameObject::KEY) != 0)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	uint16_t ReferenceState::CellBitmask(int8_t i, int8_t j) const
+	{
+		uint16_t bitmask = 0;
+		for (GameObject obj : _cells[i][j])
+		{
+			bitmask |= 1 << static_cast<uint16_t>(obj);
+		}
+		return bitmask;
+	}
+
+	Coordinate ReferenceState::BabaCoordinate(int index) const
+	{
+		if (!_babas[index])
+			return { -1, -1 };
+		return *_babas[index];
+	}
+
+	bool ReferenceState::RockIsPush() const
+	{
+		for (int i = 0; i < GRID_HEIGHT; ++i)
+		{
+			for (int j = 0; j < GRID_WIDTH; ++j)
+			{
+				if (_cells[i][j].count(GameObject::IS_TEXT) == 0)
+					continue;
+				if (InBounds(i - 1, j) && InBounds(i + 1, j) && _cells[i - 1][j].count(GameObject::ROCK_TEXT) != 0
+					&& _cells[i + 1][j].count(GameObject::PUSH_TEXT) != 0)
+				{
+					return true;
+				}
+				if (InBounds(i, j - 1) && InBounds(i, j + 1) && _cells[i][j - 1].count(GameObject::ROCK_TEXT) != 0
+					&& _cells[i][j + 1].count(GameObject::PUSH_TEXT) != 0)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	std::set<GameObject> ReferenceState::PushableObjects(int8_t i, int8_t j, bool rock_is_push) const
+	{
+		std::set<GameObject> pushable;
+		for (GameObject obj : _cells[i][j])
+		{
+			bool is_pushable = obj == GameObject::KEY || obj == GameObject::ROCK_TEXT || obj == GameObject::IS_TEXT
+				|| obj == GameObject::PUSH_TEXT || (obj == GameObject::ROCK && rock_is_push);
+			if (is_pushable)
+				pushable.insert(obj);
+		}
+		return pushable;
+	}
+
+	void ReferenceState::MoveBaba(int index, int8_t delta_i, int8_t delta_j, bool rock_is_push)
+	{
+		if (!_babas[index])
+			return;
+		Coordinate baba = *_babas[index];
+
+		// Walk from the Baba in the direction of the move and collect the line of cells whose
+		// objects get pushed. The line ends at the first cell without pushable objects. Walls,
+		// doors and the edge of the grid block the whole line, except that a key can be pushed
+		// into a door if the key is the only pushable object in its cell.
+		std::vector<Coordinate> pushed_cells;
+		int i = baba.i + delta_i;
+		int j = baba.j + delta_j;
+		while (true)
+		{
+			if (!InBounds(i, j))
+				return;
+			const std::set<GameObject>& cell = _cells[i][j];
+			if (cell.count(GameObject::IMMOVABLE) != 0)
+				return;
+			if (cell.count(GameObject::DOOR) != 0)
+			{
+				if (pushed_cells.empty())
+					return;
+				Coordinate last = pushed_cells.back();
+				if (PushableObjects(last.i, last.j, rock_is_push) != std::set<GameObject>{ GameObject::KEY })
+					return;
+				break;
+			}
+			if (PushableObjects(static_cast<int8_t>(i), static_cast<int8_t>(j), rock_is_push).empty())
+				break;
+			pushed_cells.push_back({ static_cast<int8_t>(i), static_cast<int8_t>(j) });
+			i += delta_i;
+			j += delta_j;
+		}
+
+		// Push the objects, starting with the cell farthest from the Baba.
+		for (auto it = pushed_cells.rbegin(); it != pushed_cells.rend(); ++it)
+		{
+			for (GameObject obj : PushableObjects(it->i, it->j, rock_is_push))
+			{
+				_cells[it->i][it->j].erase(obj);
+				_cells[it->i + delta_i][it->j + delta_j].insert(obj);
+			}
+		}
+		_babas[index] = Coordinate{ static_cast<int8_t>(baba.i + delta_i), static_cast<int8_t>(baba.j + delta_j) };
+	}
+
+	void ReferenceState::KillUnsupportedBabas()
+	{
+		// Babas on the same cell hold each other up.
+		if (_babas[0] && _babas[1] && _babas[0]->i == _babas[1]->i && _babas[0]->j == _babas[1]->j)
+			return;
+		for (std::optional<Coordinate>& baba : _babas)
+		{
+			if (baba && _cells[baba->i][baba->j].empty())
+				baba = std::nullopt;
+		}
+	}
+
+}  // namespace BabaSolverTest
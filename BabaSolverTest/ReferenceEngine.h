@@ -0,0 +1,56 @@
+// A deliberately simple implementation of the game rules, used as an oracle for the optimized
+// engine in GameState.
+//
+// ReferenceState stores each cell as a set of GameObjects and recomputes everything (e.g. whether
+// "ROCK IS PUSH" is active) from the grid instead of caching it. It's slow, but it's short enough
+// to check against the game by reading it. Don't optimize it: its only job is to be obviously
+// correct.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+
+#include "GameState.h"
+
+namespace BabaSolverTest
+{
+	class ReferenceState
+	{
+	public:
+		// The GameObjects in each cell of the grid.
+		std::set<BabaSolver::GameObject> _cells[BabaSolver::GRID_HEIGHT][BabaSolver::GRID_WIDTH];
+		// The locations of Baba #1 and Baba #2, or std::nullopt if the Baba is dead.
+		std::optional<BabaSolver::Coordinate> _babas[2];
+
+		// Creates a ReferenceState with the same grid and Babas as the given GameState.
+		explicit ReferenceState(const BabaSolver::GameState& state);
+
+		// Moves both Babas in the given direction.
+		void ApplyMove(BabaSolver::Direction direction);
+
+		// Returns true if the key is in a door.
+		bool HaveWon() const;
+
+		// Returns the grid cell at (i, j) as a GameState bitmask.
+		uint16_t CellBitmask(int8_t i, int8_t j) const;
+
+		// Returns the location of the given Baba, with dead Babas at (-1, -1) like in GameState.
+		BabaSolver::Coordinate BabaCoordinate(int index) const;
+
+	private:
+		// Returns true if the "ROCK IS PUSH" rule is formed anywhere in the grid.
+		bool RockIsPush() const;
+
+		// Returns the objects in the given cell that get pushed when something moves into it.
+		std::set<BabaSolver::GameObject> PushableObjects(int8_t i, int8_t j, bool rock_is_push) const;
+
+		// Moves one Baba in the given direction, pushing objects in front of it.
+		void MoveBaba(int index, int8_t delta_i, int8_t delta_j, bool rock_is_push);
+
+		// Kills every Baba that isn't standing on anything, unless the Babas share a cell.
+		void KillUnsupportedBabas();
+	};
+
+}  // namespace BabaSolverTest
@@ -0,0 +1,241 @@
+// Differential fuzzing of the optimized engine in GameState against ReferenceState.
+//
+// The fuzzer generates random levels and random move sequences, applies the moves in both engines,
+// and checks after every move that the engines agree on the grid, the Babas, the hash, and
+// everything derived from the cached state (winning, losing, and the score). The random number
+// generator is seeded with a constant, so a failure is reproducible.
+
+#include "pch.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+
+#include "ReferenceEngine.h"
+
+using BabaSolver::Direction;
+using BabaSolver::GameObject;
+using BabaSolver::GRID_HEIGHT;
+using BabaSolver::GRID_WIDTH;
+
+// How many random levels to generate.
+static constexpr int FUZZ_LEVEL_COUNT = 3'000;
+// How many random move sequences to apply to each real level.
+static constexpr int FUZZ_SEQUENCES_PER_REAL_LEVEL = 500;
+
+static const Direction ALL_DIRECTIONS[] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+static uint16_t Bit(GameObject obj)
+{
+	return 1 << static_cast<uint16_t>(obj);
+}
+
+static std::string MovesToString(const BabaSolver::GameState& state)
+{
+	std::string moves;
+	for (int i = 0; i < state._turn; ++i)
+	{
+		moves += "?URDL"[static_cast<int>(state._moves[i])];
+	}
+	return moves;
+}
+
+// Generates a random level. The level follows the invariants that GameState relies on: the door is
+// at (DOOR_I, DOOR_J) and there's exactly one key and one "IS" text block. Everything else is
+// random, including cells with several objects, so the fuzzer reaches states that the real levels
+// never do.
+static std::shared_ptr<BabaSolver::GameState> RandomLevel(std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> percent(0, 99);
+
+	uint16_t grid[GRID_HEIGHT][GRID_WIDTH]{};
+	for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+	{
+		for (int8_t j = 0; j < GRID_WIDTH; ++j)
+		{
+			int roll = percent(rng);
+			if (roll < 45)
+				grid[i][j] = Bit(GameObject::TILE);
+			else if (roll < 52)
+				grid[i][j] = Bit(GameObject::IMMOVABLE);
+			else if (roll < 60)
+				grid[i][j] = Bit(GameObject::ROCK);
+			else if (roll < 64)
+				grid[i][j] = Bit(GameObject::TILE) | Bit(GameObject::ROCK);
+			else if (roll < 66)
+				grid[i][j] = Bit(GameObject::ROCK_TEXT);
+			else if (roll < 68)
+				grid[i][j] = Bit(GameObject::PUSH_TEXT);
+			else if (roll < 69)
+				grid[i][j] = Bit(GameObject::TILE) | Bit(GameObject::ROCK_TEXT);
+		}
+	}
+	grid[BabaSolver::DOOR_I][BabaSolver::DOOR_J] = Bit(GameObject::DOOR);
+
+	auto random_cell_other_than_door = [&](int min_i, int max_i, int min_j, int max_j)
+		{
+			std::uniform_int_distribution<int> cell_i(min_i, max_i);
+			std::uniform_int_distribution<int> cell_j(min_j, max_j);
+			while (true)
+			{
+				BabaSolver::Coordinate cell{ static_cast<int8_t>(cell_i(rng)), static_cast<int8_t>(cell_j(rng)) };
+				if (cell.i != BabaSolver::DOOR_I || cell.j != BabaSolver::DOOR_J)
+					return cell;
+			}
+		};
+
+	// Half of the levels start with "ROCK IS PUSH" intact, horizontally or vertically.
+	BabaSolver::Coordinate is_text = random_cell_other_than_door(1, GRID_HEIGHT - 2, 1, GRID_WIDTH - 2);
+	grid[is_text.i][is_text.j] |= Bit(GameObject::IS_TEXT);
+	if (percent(rng) < 50)
+	{
+		bool horizontal = percent(rng) < 50;
+		int8_t delta_i = horizontal ? 0 : 1;
+		int8_t delta_j = horizontal ? 1 : 0;
+		uint16_t& before = grid[is_text.i - delta_i][is_text.j - delta_j];
+		uint16_t& after = grid[is_text.i + delta_i][is_text.j + delta_j];
+		if ((before & Bit(GameObject::DOOR)) == 0)
+			before = Bit(GameObject::ROCK_TEXT);
+		if ((after & Bit(GameObject::DOOR)) == 0)
+			after = Bit(GameObject::PUSH_TEXT);
+	}
+
+	// A quarter of the levels start with the key next to the door, so that some sequences win.
+	BabaSolver::Coordinate key = percent(rng) < 25
+		? random_cell_other_than_door(BabaSolver::DOOR_I - 1, BabaSolver::DOOR_I + 1, BabaSolver::DOOR_J - 1, BabaSolver::DOOR_J + 1)
+		: random_cell_other_than_door(0, GRID_HEIGHT - 1, 0, GRID_WIDTH - 1);
+	grid[key.i][key.j] |= Bit(GameObject::KEY);
+
+	BabaSolver::Coordinate baba1 = random_cell_other_than_door(0, GRID_HEIGHT - 1, 0, GRID_WIDTH - 1);
+	BabaSolver::Coordinate baba2 = percent(rng) < 10 ? baba1 : random_cell_other_than_door(0, GRID_HEIGHT - 1, 0, GRID_WIDTH - 1);
+	return std::make_shared<BabaSolver::GameState>(grid, baba1, baba2);
+}
+
+// Checks that the optimized and reference engines agree. Returns false (after adding a gtest
+// failure) if they don't.
+static bool ExpectSameState(const std::shared_ptr<BabaSolver::GameState>& state, const BabaSolverTest::ReferenceState& reference,
+	const std::string& context)
+{
+	for (int8_t i = 0; i < GRID_HEIGHT; ++i)
+	{
+		for (int8_t j = 0; j < GRID_WIDTH; ++j)
+		{
+			if (state->_grid[i][j] != reference.CellBitmask(i, j))
+			{
+				ADD_FAILURE() << context << ": cell (" << static_cast<int>(i) << ", " << static_cast<int>(j) << ") is "
+					<< state->_grid[i][j] << " but should be " << reference.CellBitmask(i, j);
+				return false;
+			}
+		}
+	}
+	BabaSolver::Coordinate babas[] = { state->_baba1, state->_baba2 };
+	for (int index = 0; index < 2; ++index)
+	{
+		BabaSolver::Coordinate expected = reference.BabaCoordinate(index);
+		if (babas[index].i != expected.i || babas[index].j != expected.j)
+		{
+			ADD_FAILURE() << context << ": Baba #" << index + 1 << " is at (" << static_cast<int>(babas[index].i) << ", "
+				<< static_cast<int>(babas[index].j) << ") but should be at (" << static_cast<int>(expected.i) << ", "
+				<< static_cast<int>(expected.j) << ")";
+			return false;
+		}
+	}
+
+	// A GameState built from scratch from the same grid has freshly computed cached state, so
+	// comparing the two checks that the optimized engine keeps its cached state up to date.
+	std::shared_ptr<BabaSolver::GameState> rebuilt = std::make_shared<BabaSolver::GameState>(state->_grid, state->_baba1, state->_baba2);
+	std::shared_ptr<BabaSolver::GameState> position = std::make_shared<BabaSolver::GameState>(*state);
+	position->ResetContext();
+	if (!BabaSolver::GameStateEqual()(position, rebuilt) || BabaSolver::GameStateHash()(position) != BabaSolver::GameStateHash()(rebuilt))
+	{
+		ADD_FAILURE() << context << ": equality or hash doesn't match a rebuilt GameState";
+		return false;
+	}
+	if (state->HaveWon() != reference.HaveWon())
+	{
+		ADD_FAILURE() << context << ": HaveWon() is " << state->HaveWon() << " but should be " << reference.HaveWon();
+		return false;
+	}
+	if (state->CheckWhyImpossibleToWin() != rebuilt->CheckWhyImpossibleToWin() || state->CalculateScore() != rebuilt->CalculateScore())
+	{
+		ADD_FAILURE() << context << ": cached state doesn't match a rebuilt GameState";
+		return false;
+	}
+	return true;
+}
+
+// Applies random moves to initial_state in both engines and compares the engines after every move.
+static void FuzzMoves(const std::shared_ptr<BabaSolver::GameState>& initial_state, std::mt19937& rng, const std::string& name)
+{
+	std::uniform_int_distribution<int> random_direction(0, 3);
+	std::shared_ptr<BabaSolver::GameState> state = initial_state;
+	BabaSolverTest::ReferenceState reference(*initial_state);
+	if (!ExpectSameState(state, reference, name + ", initial state"))
+		return;
+	for (int turn = 0; turn < BabaSolver::MAX_TURN_COUNT; ++turn)
+	{
+		Direction direction = ALL_DIRECTIONS[random_direction(rng)];
+		state = state->ApplyMove(direction);
+		reference.ApplyMove(direction);
+		if (!ExpectSameState(state, reference, name + ", moves " + MovesToString(*state)))
+		{
+			state->PrintGrid();
+			return;
+		}
+	}
+}
+
+TEST(ReferenceEngineTest, MatchesOnRealLevels)
+{
+	std::mt19937 rng(20240601);
+	for (int sequence = 0; sequence < FUZZ_SEQUENCES_PER_REAL_LEVEL; ++sequence)
+	{
+		FuzzMoves(BabaSolver::FloatiestPlatformsLevel(), rng, "Floatiest Platforms");
+		FuzzMoves(BabaSolver::TestLevel(), rng, "Test level");
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST(ReferenceEngineTest, MatchesOnRandomLevels)
+{
+	std::mt19937 rng(20240602);
+	for (int level = 0; level < FUZZ_LEVEL_COUNT; ++level)
+	{
+		FuzzMoves(RandomLevel(rng), rng, "Random level #" + std::to_string(level));
+		if (HasFailure())
+			return;
+	}
+}
+
+TEST(ReferenceEngineTest, MatchesEveryMoveSequenceOfFloatiestPlatforms)
+{
+	// Exhaustively compare the engines on every move sequence up to depth 6.
+	constexpr int max_depth = 6;
+	struct Node
+	{
+		std::shared_ptr<BabaSolver::GameState> state;
+		BabaSolverTest::ReferenceState reference;
+	};
+	std::shared_ptr<BabaSolver::GameState> initial_state = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<Node> frontier = { { initial_state, BabaSolverTest::ReferenceState(*initial_state) } };
+	for (int depth = 1; depth <= max_depth; ++depth)
+	{
+		std::vector<Node> next_frontier;
+		for (const Node& node : frontier)
+		{
+			for (Direction direction : ALL_DIRECTIONS)
+			{
+				Node child = { node.state->ApplyMove(direction), node.reference };
+				child.reference.ApplyMove(direction);
+				if (!ExpectSameState(child.state, child.reference, "Floatiest Platforms, moves " + MovesToString(*child.state)))
+					return;
+				next_frontier.push_back(std::move(child));
+			}
+		}
+		frontier = std::move(next_frontier);
+	}
+}
@@ -0,0 +1,235 @@
+// Tests for the solver server and its JSON reader.
+
+#include "pch.h"
+
+#include <optional>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "GameState.h"
+#include "Json.h"
+#include "Level.h"
+#include "Server.h"
+
+TEST(ServerTest, ParsesJson)
+{
+	std::string error;
+	std::optional<BabaSolver::JsonValue> value = BabaSolver::ParseJson(
+		R"( {"a": [1, -2.5e1, true, null], "b\n": "x\"é", "c": {}} )", error);
+	ASSERT_TRUE(value) << error;
+	const BabaSolver::JsonValue* a = value->Find("a");
+	ASSERT_TRUE(a);
+	ASSERT_EQ(a->elements.size(), 4u);
+	EXPECT_EQ(a->elements[1].number, -25.0);
+	EXPECT_TRUE(a->elements[2].boolean);
+	EXPECT_EQ(a->elements[3].type, BabaSolver::JsonValue::Type::NUL);
+	ASSERT_TRUE(value->Find("b\n"));
+	EXPECT_EQ(value->Find("b\n")->string, "x\"\xc3\xa9");
+	EXPECT_EQ(value->Find("c")->type, BabaSolver::JsonValue::Type::OBJECT);
+	EXPECT_EQ(value->Find("d"), nullptr);
+
+	EXPECT_FALSE(BabaSolver::ParseJson("{\"a\": 1,}", error));
+	EXPECT_FALSE(BabaSolver::ParseJson("[1] 2", error));
+	EXPECT_FALSE(BabaSolver::ParseJson(std::string(100, '['), error));
+	EXPECT_FALSE(BabaSolver::ParseJson(R"("\uZZZZ")", error));
+	EXPECT_FALSE(BabaSolver::ParseJson(R"("\u12")", error));
+	EXPECT_FALSE(BabaSolver::ParseJson("+1", error));
+	for (const char* number : { "0x10", "-inf", "-nan", "01", "1.", "1e", "-" })
+	{
+		EXPECT_FALSE(BabaSolver::ParseJson(number, error)) << number;
+		EXPECT_NE(error.find("Invalid number"), std::string::npos) << number;
+	}
+	std::optional<BabaSolver::JsonValue> numbers = BabaSolver::ParseJson("[0, -0.5, 1E+2, 10e-1]", error);
+	ASSERT_TRUE(numbers) << error;
+	EXPECT_EQ(numbers->elements[2].number, 100.0);
+	EXPECT_EQ(numbers->elements[3].number, 1.0);
+	std::optional<BabaSolver::JsonValue> escaped = BabaSolver::ParseJson(R"("\u0041\u00e9")", error);
+	ASSERT_TRUE(escaped) << error;
+	EXPECT_EQ(escaped->string, "A\xc3\xa9");
+
+	std::string round_trip = "a\"b\\c\nd\x01";
+	std::optional<BabaSolver::JsonValue> string_value = BabaSolver::ParseJson(BabaSolver::JsonString(round_trip), error);
+	ASSERT_TRUE(string_value);
+	EXPECT_EQ(string_value->string, round_trip);
+}
+
+#ifndef _WIN32
+
+namespace
+{
+	// A client that sends requests and reads responses one line at a time.
+	class TestClient
+	{
+	public:
+		explicit TestClient(const std::string& socket_path)
+		{
+			_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			socket_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+			_connected = connect(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+		}
+
+		~TestClient()
+		{
+			close(_fd);
+		}
+
+		bool Connected() const { return _connected; }
+
+		void Send(const std::string& line)
+		{
+			std::string data = line + "\n";
+			EXPECT_EQ(send(_fd, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+		}
+
+		// Reads responses until one has the given type, and returns it. Returns an empty object if
+		// the connection is closed first.
+		BabaSolver::JsonValue ReadUntil(const std::string& type)
+		{
+			while (true)
+			{
+				std::size_t line_end = _buffer.find('\n');
+				if (line_end == std::string::npos)
+				{
+					char chunk[4096];
+					ssize_t result = recv(_fd, chunk, sizeof(chunk), 0);
+					if (result <= 0)
+						return BabaSolver::JsonValue();
+					_buffer.append(chunk, static_cast<std::size_t>(result));
+					continue;
+				}
+				std::string line = _buffer.substr(0, line_end);
+				_buffer.erase(0, line_end + 1);
+				std::string error;
+				std::optional<BabaSolver::JsonValue> response = BabaSolver::ParseJson(line, error);
+				EXPECT_TRUE(response) << line;
+				if (response && response->Find("type") && response->Find("type")->string == type)
+					return *response;
+			}
+		}
+
+	private:
+		int _fd;
+		bool _connected;
+		std::string _buffer;
+	};
+}  // namespace
+
+static std::string TestSocketPath()
+{
+	return "/tmp/baba_solver_test_" + std::to_string(getpid()) + ".sock";
+}
+
+TEST(ServerTest, SolvesAndStreamsResults)
+{
+	BabaSolver::ServerOptions options;
+	options.thread_count = 2;
+	BabaSolver::Server server(options);
+	std::string error;
+	ASSERT_TRUE(server.Start(TestSocketPath(), error)) << error;
+	TestClient client(TestSocketPath());
+	ASSERT_TRUE(client.Connected());
+
+	std::ostringstream level;
+	BabaSolver::WriteLevel(*BabaSolver::TestLevel(), level);
+	client.Send(R"({"type": "solve", "id": "test", "level": )" + BabaSolver::JsonString(level.str()) + "}");
+	BabaSolver::JsonValue queued = client.ReadUntil("queued");
+	ASSERT_TRUE(queued.Find("id"));
+	EXPECT_EQ(queued.Find("id")->string, "test");
+	BabaSolver::JsonValue result = client.ReadUntil("result");
+	ASSERT_TRUE(result.Find("won"));
+	EXPECT_TRUE(result.Find("won")->boolean);
+	std::optional<std::vector<BabaSolver::Direction>> moves = BabaSolver::ParseMoves(result.Find("moves")->string);
+	ASSERT_TRUE(moves);
+	EXPECT_TRUE(BabaSolver::TestLevel()->ApplyMoves(*moves)->HaveWon());
+
+	client.Send(R"({"type": "solve", "id": "bad", "level_name": "floatiest", "options": {"max_turn_depth": 99}})");
+	BabaSolver::JsonValue error_response = client.ReadUntil("error");
+	ASSERT_TRUE(error_response.Find("message"));
+	EXPECT_NE(error_response.Find("message")->string.find("max_turn_depth"), std::string::npos);
+}
+
+TEST(ServerTest, RejectsInvalidRequests)
+{
+	BabaSolver::ServerOptions options;
+	options.thread_count = 1;
+	BabaSolver::Server server(options);
+	std::string error;
+	ASSERT_TRUE(server.Start(TestSocketPath(), error)) << error;
+	TestClient client(TestSocketPath());
+	ASSERT_TRUE(client.Connected());
+	auto error_message = [&client](const std::string& request)
+		{
+			client.Send(request);
+			BabaSolver::JsonValue response = client.ReadUntil("error");
+			return response.Find("message") ? response.Find("message")->string : std::string();
+		};
+
+	// A level without a key can't be played, and must not take the server down.
+	std::ostringstream level;
+	BabaSolver::WriteLevel(*BabaSolver::FloatiestPlatformsLevel(), level);
+	std::string no_key = level.str();
+	no_key[no_key.find('K', no_key.find("objects:"))] = '.';
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "a", "level": )" + BabaSolver::JsonString(no_key)
+		+ R"(, "options": {"max_turn_depth": 3}})").find("exactly one key"), std::string::npos);
+
+	// Numbers follow the JSON grammar, and numeric options must be integers in range.
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "b", "level_name": "test", "options": {"parallelism_depth": -nan}})")
+		.find("Invalid number"), std::string::npos);
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "b", "level_name": "test", "options": {"max_turn_depth": 0x10}})")
+		.find("Invalid number"), std::string::npos);
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "c", "level_name": "test", "options": {"iteration_count": 1e10}})")
+		.find("iteration_count"), std::string::npos);
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "d", "level_name": "test", "options": {"max_cache_depth": 2.5}})")
+		.find("max_cache_depth"), std::string::npos);
+	EXPECT_NE(error_message(R"({"type": "solve", "id": "e", "level_name": "test", "options": {"max_turn_depth": 4, "parallelism_depth": 5}})")
+		.find("parallelism_depth (5) must be at most max_turn_depth (4)"), std::string::npos);
+
+	// The server still answers after the invalid requests.
+	client.Send(R"({"type": "solve", "id": "f", "level_name": "test", "options": {"max_turn_depth": 3}})");
+	BabaSolver::JsonValue result = client.ReadUntil("result");
+	ASSERT_TRUE(result.Find("won"));
+	EXPECT_TRUE(result.Find("won")->boolean);
+}
+
+TEST(ServerTest, CancelsSearches)
+{
+	BabaSolver::ServerOptions options;
+	options.thread_count = 2;
+	options.concurrent_search_count = 1;
+	BabaSolver::Server server(options);
+	std::string error;
+	ASSERT_TRUE(server.Start(TestSocketPath(), error)) << error;
+	TestClient client(TestSocketPath());
+	ASSERT_TRUE(client.Connected());
+
+	// These searches would take far too long to finish. The second one waits in the queue.
+	std::string slow_options = R"("options": {"max_turn_depth": 25, "estimate_probe_count": 0, "print_every_n_moves": 10000})";
+	client.Send(R"({"type": "solve", "id": "running", "level_name": "floatiest", )" + slow_options + "}");
+	client.ReadUntil("progress");
+	client.Send(R"({"type": "solve", "id": "queued", "level_name": "floatiest", )" + slow_options + "}");
+	EXPECT_EQ(client.ReadUntil("queued").Find("position")->number, 0.0);
+	client.Send(R"({"type": "cancel", "id": "queued"})");
+	BabaSolver::JsonValue queued_result = client.ReadUntil("result");
+	EXPECT_EQ(queued_result.Find("id")->string, "queued");
+	EXPECT_TRUE(queued_result.Find("cancelled")->boolean);
+
+	client.Send(R"({"type": "cancel", "id": "running"})");
+	BabaSolver::JsonValue running_result = client.ReadUntil("result");
+	EXPECT_EQ(running_result.Find("id")->string, "running");
+	EXPECT_TRUE(running_result.Find("cancelled")->boolean);
+	EXPECT_FALSE(running_result.Find("won")->boolean);
+	EXPECT_GT(running_result.Find("moves_simulated")->number, 0.0);
+
+	client.Send(R"({"type": "shutdown"})");
+	server.Wait();
+}
+
+#endif
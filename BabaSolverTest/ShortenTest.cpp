@@ -0,0 +1,64 @@
+// Tests for shortening solutions.
+
+#include "pch.h"
+
+#include <memory>
+#include <vector>
+
+#include "GameState.h"
+#include "Shorten.h"
+
+// Returns true if the positions of the game objects of lhs and rhs are the same.
+static bool SamePosition(const BabaSolver::GameState& lhs, const BabaSolver::GameState& rhs)
+{
+	std::shared_ptr<BabaSolver::GameState> lhs_copy = std::make_shared<BabaSolver::GameState>(lhs);
+	std::shared_ptr<BabaSolver::GameState> rhs_copy = std::make_shared<BabaSolver::GameState>(rhs);
+	lhs_copy->ResetContext();
+	rhs_copy->ResetContext();
+	return BabaSolver::GameStateEqual()(lhs_copy, rhs_copy);
+}
+
+TEST(ShortenTest, ShortensWinningSolutions)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+	// The moves after the win are dropped, and the detour before it is cut out.
+	std::vector<BabaSolver::Direction> moves = *BabaSolver::ParseMoves("UDUDRLL");
+	BabaSolver::ShortenStats stats;
+	std::vector<BabaSolver::Direction> shortened = BabaSolver::ShortenSolution(level, moves, BabaSolver::ShortenOptions(), &stats);
+	EXPECT_EQ(BabaSolver::FormatMoves(shortened), "R");
+	EXPECT_TRUE(BabaSolver::ReplayMoves(level, shortened)->HaveWon());
+	EXPECT_GE(stats.passes, 1);
+	EXPECT_GT(stats.states_searched, 0u);
+}
+
+TEST(ShortenTest, KeepsTheEndStateOfOtherSequences)
+{
+	// A sample best leaf of one iteration at depth 25 (see Performance.txt).
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<BabaSolver::Direction> moves = *BabaSolver::ParseMoves("LLLLLDLLLLLLLLLLLLURRRURD");
+	std::vector<BabaSolver::Direction> shortened = BabaSolver::ShortenSolution(level, moves, BabaSolver::ShortenOptions());
+	EXPECT_LT(shortened.size(), moves.size());
+	EXPECT_TRUE(SamePosition(*BabaSolver::ReplayMoves(level, shortened), *BabaSolver::ReplayMoves(level, moves)));
+
+	// Without shortcuts, only moves that don't change anything can be removed.
+	BabaSolver::ShortenOptions no_shortcuts;
+	no_shortcuts.max_shortcut_moves = 0;
+	std::vector<BabaSolver::Direction> unchanged = BabaSolver::ShortenSolution(level, moves, no_shortcuts);
+	EXPECT_LE(unchanged.size(), moves.size());
+	EXPECT_GE(unchanged.size(), shortened.size());
+	EXPECT_TRUE(SamePosition(*BabaSolver::ReplayMoves(level, unchanged), *BabaSolver::ReplayMoves(level, moves)));
+}
+
+TEST(ShortenTest, ReplaysSequencesLongerThanMaxTurnCount)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::vector<BabaSolver::Direction> moves;
+	for (int i = 0; i < BabaSolver::MAX_TURN_COUNT; ++i)
+	{
+		moves.push_back(BabaSolver::Direction::RIGHT);
+		moves.push_back(BabaSolver::Direction::LEFT);
+	}
+	std::vector<BabaSolver::Direction> shortened = BabaSolver::ShortenSolution(level, moves, BabaSolver::ShortenOptions());
+	EXPECT_LT(shortened.size(), moves.size());
+	EXPECT_TRUE(SamePosition(*BabaSolver::ReplayMoves(level, shortened), *BabaSolver::ReplayMoves(level, moves)));
+}
@@ -0,0 +1,127 @@
+// Tests for the on-disk solution cache.
+
+#include "pch.h"
+
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+#include "SolutionCache.h"
+#include "Solver.h"
+
+#include "TempFile.h"
+
+namespace
+{
+	BabaSolver::SolverOptions TestOptions()
+	{
+		BabaSolver::SolverOptions options;
+		options.iteration_count = 1;
+		options.max_turn_depth = 12;
+		options.parallelism_depth = 2;
+		options.max_cache_depth = 12;
+		options.thread_count = 2;
+		options.estimate_probe_count = 0;
+		return options;
+	}
+}  // namespace
+
+TEST(SolutionCacheTest, StoresAndFindsResults)
+{
+	BabaSolverTest::TempFile file("solution_cache_store.txt");
+	BabaSolver::SolutionCache cache(file.Path());
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+	BabaSolver::SolverOptions options = TestOptions();
+	EXPECT_FALSE(cache.Find(*level, options));
+
+	BabaSolver::CachedSolution best;
+	best.iteration_moves = { *BabaSolver::ParseMoves("UR"), *BabaSolver::ParseMoves("") };
+	ASSERT_TRUE(cache.Store(*level, options, best));
+	std::optional<BabaSolver::CachedSolution> found = cache.Find(*level, options);
+	ASSERT_TRUE(found);
+	EXPECT_FALSE(found->won);
+	EXPECT_EQ(found->iteration_moves, best.iteration_moves);
+
+	// A result that didn't win is only used with the same options, and only for the same level.
+	BabaSolver::SolverOptions deeper_options = options;
+	deeper_options.max_turn_depth = 13;
+	EXPECT_FALSE(cache.Find(*level, deeper_options));
+	EXPECT_FALSE(cache.Find(*BabaSolver::FloatiestPlatformsLevel(), options));
+	// The endgame tablebase can find a win that the search alone didn't.
+	BabaSolver::SolverOptions endgame_options = options;
+	endgame_options.max_endgame_tables = 1;
+	EXPECT_FALSE(cache.Find(*level, endgame_options));
+
+	// A winning result is used with any options.
+	BabaSolver::CachedSolution won;
+	won.won = true;
+	won.iteration_moves = { *BabaSolver::ParseMoves("LLDD") };
+	ASSERT_TRUE(cache.Store(*level, deeper_options, won));
+	found = cache.Find(*level, options);
+	ASSERT_TRUE(found);
+	EXPECT_TRUE(found->won);
+	EXPECT_EQ(found->iteration_moves, won.iteration_moves);
+}
+
+TEST(SolutionCacheTest, ReplaysOnlyValidSolutions)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::Solver(level, TestOptions()).Run();
+	ASSERT_TRUE(end_state->HaveWon());
+
+	BabaSolver::CachedSolution solution;
+	solution.won = true;
+	solution.iteration_moves = { std::vector<BabaSolver::Direction>(end_state->_moves, end_state->_moves + end_state->_turn) };
+	std::vector<std::shared_ptr<BabaSolver::GameState>> end_states = BabaSolver::ReplaySolution(level, solution);
+	ASSERT_EQ(end_states.size(), 1u);
+	EXPECT_TRUE(end_states[0]->HaveWon());
+	EXPECT_EQ(BabaSolver::FormatMoves(*end_states[0]), BabaSolver::FormatMoves(*end_state));
+
+	// A solution that doesn't win, or is too long, is rejected.
+	BabaSolver::CachedSolution wrong = solution;
+	wrong.iteration_moves[0].pop_back();
+	EXPECT_TRUE(BabaSolver::ReplaySolution(level, wrong).empty());
+	wrong.iteration_moves[0].assign(BabaSolver::MAX_TURN_COUNT + 1, BabaSolver::Direction::UP);
+	EXPECT_TRUE(BabaSolver::ReplaySolution(level, wrong).empty());
+}
+
+TEST(SolutionCacheTest, SolverUsesTheCache)
+{
+	BabaSolverTest::TempFile file("solution_cache_solver.txt");
+	BabaSolver::SolverOptions options = TestOptions();
+	options.solution_cache_file = file.Path();
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+
+	BabaSolver::Solver first(level, options);
+	std::shared_ptr<BabaSolver::GameState> first_result = first.Run();
+	ASSERT_TRUE(first_result->HaveWon());
+	EXPECT_EQ(first.Stats().iteration_count, 1);
+
+	// The second search replays the cached moves instead of searching.
+	BabaSolver::Solver second(level, options);
+	std::string solution_moves;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_solution = [&solution_moves](const std::shared_ptr<BabaSolver::GameState>& state)
+		{
+			solution_moves = BabaSolver::FormatMoves(*state);
+		};
+	second.SetCallbacks(callbacks);
+	std::shared_ptr<BabaSolver::GameState> second_result = second.Run();
+	ASSERT_TRUE(second_result->HaveWon());
+	EXPECT_EQ(second.Stats().iteration_count, 0);
+	EXPECT_EQ(solution_moves, BabaSolver::FormatMoves(*first_result));
+
+	// A corrupted cache entry fails the replay, and the level is searched again.
+	{
+		std::ofstream out(file.Path(), std::ios::trunc);
+		char level_hash[17];
+		std::snprintf(level_hash, sizeof(level_hash), "%016llx", static_cast<unsigned long long>(BabaSolver::LevelHash(*level)));
+		out << level_hash << " " << BabaSolver::SolutionCacheKey(options) << " won UUUU\n";
+	}
+	BabaSolver::Solver third(level, options);
+	ASSERT_TRUE(third.Run()->HaveWon());
+	EXPECT_EQ(third.Stats().iteration_count, 1);
+}
@@ -2,8 +2,19 @@
 
 #include "pch.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "GameState.h"
+#include "Shorten.h"
 #include "Solver.h"
+#include "SolverSearch.h"
 
 TEST(SolverTest, FindsSolution)
 {
@@ -13,3 +24,411 @@ TEST(SolverTest, FindsSolution)
 	ASSERT_TRUE(end_state);
 	EXPECT_TRUE(end_state->HaveWon());
 }
+
+TEST(SolverTest, CollectsPerDepthStats)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 6;
+	options.max_cache_depth = 6;
+	BabaSolver::SolverStats stats;
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &stats);
+	ASSERT_TRUE(end_state);
+	EXPECT_EQ(stats.iteration_count, 1);
+	EXPECT_EQ(stats.depths[1].nodes_generated, 4u);
+	for (int depth = 1; depth <= options.max_turn_depth; ++depth)
+	{
+		// Every expanded game state generates exactly four new game states.
+		EXPECT_EQ(stats.depths[depth].nodes_generated, 4 * stats.depths[depth - 1].nodes_expanded);
+	}
+	EXPECT_GT(stats.depths[options.max_turn_depth].leaves, 0u);
+	EXPECT_EQ(stats.depths[options.max_turn_depth].nodes_expanded, 0u);
+	EXPECT_EQ(stats.parallelism_root_count, stats.depths[options.parallelism_depth].Survivors());
+}
+
+TEST(SolverTest, ThreadCountDoesNotChangeResults)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 8;
+	options.thread_count = 1;
+	BabaSolver::SolverStats single_thread_stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &single_thread_stats);
+	options.thread_count = 4;
+	BabaSolver::SolverStats multi_thread_stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &multi_thread_stats);
+	// Each parallelism root is searched independently, so the work done doesn't depend on how the
+	// roots are distributed between threads.
+	EXPECT_EQ(single_thread_stats.Totals().nodes_generated, multi_thread_stats.Totals().nodes_generated);
+	EXPECT_EQ(single_thread_stats.cache_size, multi_thread_stats.cache_size);
+}
+
+TEST(SolverTest, RecordsPhaseTimesOnlyWhenTimersAreEnabled)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 6;
+	options.max_cache_depth = 6;
+	BabaSolver::SolverStats stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &stats);
+	const BabaSolver::PhaseTimes& phase_times = stats.phase_times;
+	BabaSolver::DepthStats totals = stats.Totals();
+	auto calls = [&phase_times](BabaSolver::TimedPhase phase) { return phase_times.calls[static_cast<int>(phase)]; };
+	if (!BabaSolver::TIMERS_ENABLED)
+	{
+		EXPECT_EQ(calls(BabaSolver::TimedPhase::APPLY_MOVE), 0u);
+		return;
+	}
+	EXPECT_EQ(calls(BabaSolver::TimedPhase::APPLY_MOVE), totals.nodes_generated);
+	EXPECT_EQ(calls(BabaSolver::TimedPhase::CALCULATE_SCORE), totals.leaves);
+	// One search loop for the sequential portion and one per parallelism root.
+	EXPECT_EQ(calls(BabaSolver::TimedPhase::SEARCH), stats.parallelism_root_count + 1);
+	EXPECT_GT(phase_times.ticks[static_cast<int>(BabaSolver::TimedPhase::APPLY_MOVE)], 0u);
+}
+
+TEST(SolverTest, WritesTraceFile)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 6;
+	options.max_cache_depth = 6;
+	options.thread_count = 2;
+	options.trace_file = ::testing::TempDir() + "baba_solver_trace.json";
+	BabaSolver::SolverStats stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &stats);
+
+	std::ifstream trace_file(options.trace_file);
+	ASSERT_TRUE(trace_file);
+	std::stringstream buffer;
+	buffer << trace_file.rdbuf();
+	std::string trace = buffer.str();
+	// One span per parallelism root.
+	uint64_t subtree_span_count = 0;
+	for (std::size_t pos = trace.find("\"cat\": \"subtree\""); pos != std::string::npos; pos = trace.find("\"cat\": \"subtree\"", pos + 1))
+	{
+		++subtree_span_count;
+	}
+	EXPECT_EQ(subtree_span_count, stats.parallelism_root_count);
+	EXPECT_NE(trace.find("\"name\": \"Iteration 1\""), std::string::npos);
+	EXPECT_NE(trace.find("\"name\": \"Worker 2\""), std::string::npos);
+	std::remove(options.trace_file.c_str());
+}
+
+TEST(SolverTest, CacheBudgetLimitsCacheSize)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 8;
+	options.thread_count = 2;
+	BabaSolver::SolverStats unlimited_stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &unlimited_stats);
+	EXPECT_GT(unlimited_stats.memory.shared_cache_bytes, 0u);
+	EXPECT_GT(unlimited_stats.memory.max_local_cache_bytes, 0u);
+	EXPECT_GT(unlimited_stats.memory.max_stack_bytes, 0u);
+	EXPECT_EQ(unlimited_stats.memory.uncached_states, 0u);
+
+	options.max_cache_bytes = 64 * 1024;
+	BabaSolver::SolverStats limited_stats;
+	BabaSolver::Solve(BabaSolver::FloatiestPlatformsLevel(), options, &limited_stats);
+	EXPECT_GT(limited_stats.memory.uncached_states, 0u);
+	EXPECT_LE(limited_stats.memory.max_local_cache_bytes, unlimited_stats.memory.max_local_cache_bytes);
+	// Game states that aren't cached are searched again, so the budget can only add work.
+	EXPECT_GE(limited_stats.Totals().nodes_generated, unlimited_stats.Totals().nodes_generated);
+}
+
+TEST(SolverTest, CallsCallbacksWithoutLogging)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 8;
+	options.max_cache_depth = 8;
+	options.print_every_n_moves = 1000;
+	BabaSolver::Solver solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	int progress_count = 0;
+	std::vector<int> best_leaf_scores;
+	int finished_iteration = 0;
+	bool solved = false;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_progress = [&progress_count](const BabaSolver::SolverProgress& progress)
+		{
+			++progress_count;
+			EXPECT_EQ(progress.iteration, 1);
+			EXPECT_GT(progress.moves_done, 0u);
+		};
+	callbacks.on_best_leaf = [&best_leaf_scores](const std::shared_ptr<BabaSolver::GameState>& state, int score)
+		{
+			EXPECT_EQ(score, state->CalculateScore());
+			best_leaf_scores.push_back(score);
+		};
+	callbacks.on_iteration_finished = [&finished_iteration](int iteration, const std::shared_ptr<BabaSolver::GameState>&)
+		{
+			finished_iteration = iteration;
+		};
+	callbacks.on_solution = [&solved](const std::shared_ptr<BabaSolver::GameState>&) { solved = true; };
+	solver.SetCallbacks(callbacks);
+
+	testing::internal::CaptureStdout();
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+	EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+
+	ASSERT_TRUE(end_state);
+	EXPECT_TRUE(solver.IsFinished());
+	EXPECT_GT(progress_count, 0);
+	ASSERT_FALSE(best_leaf_scores.empty());
+	EXPECT_TRUE(std::is_sorted(best_leaf_scores.begin(), best_leaf_scores.end()));
+	EXPECT_EQ(best_leaf_scores.back(), end_state->CalculateScore());
+	EXPECT_EQ(finished_iteration, 1);
+	EXPECT_FALSE(solved);
+	EXPECT_EQ(solver.Stats().iteration_count, 1);
+}
+
+TEST(SolverTest, ReportsSolution)
+{
+	BabaSolver::Solver solver(BabaSolver::TestLevel(), BabaSolver::SolverOptions());
+	std::shared_ptr<BabaSolver::GameState> solution;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_solution = [&solution](const std::shared_ptr<BabaSolver::GameState>& state) { solution = state; };
+	solver.SetCallbacks(callbacks);
+	solver.Start();
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Wait();
+	ASSERT_TRUE(end_state);
+	EXPECT_TRUE(end_state->HaveWon());
+	EXPECT_EQ(solution, end_state);
+	EXPECT_FALSE(solver.WasCancelled());
+}
+
+TEST(SolverTest, LeavesTheGivenStatesUnchanged)
+{
+	std::shared_ptr<BabaSolver::GameState> initial_state = BabaSolver::FloatiestPlatformsLevel()->ApplyMoves(*BabaSolver::ParseMoves("DR"));
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 2;
+	options.max_turn_depth = 2;
+	options.estimate_probe_count = 0;
+	BabaSolver::Solver solver(initial_state, options);
+	std::vector<std::pair<std::shared_ptr<BabaSolver::GameState>, int>> iteration_results;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_iteration_finished = [&iteration_results](int, const std::shared_ptr<BabaSolver::GameState>& state)
+		{
+			iteration_results.emplace_back(state, state->_turn);
+		};
+	solver.SetCallbacks(callbacks);
+	ASSERT_TRUE(solver.Run());
+
+	// The next iteration starts from a copy of the last result, with its move history reset.
+	EXPECT_EQ(initial_state->_turn, 2);
+	ASSERT_EQ(iteration_results.size(), 2u);
+	for (const auto& [state, turn] : iteration_results)
+		EXPECT_EQ(state->_turn, turn);
+}
+
+TEST(SolverTest, CancelStopsTheSearch)
+{
+	// This search would take far too long to finish.
+	BabaSolver::SolverOptions options;
+	options.max_turn_depth = 25;
+	options.print_every_n_moves = 10'000;
+	options.estimate_probe_count = 0;
+	BabaSolver::Solver solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_progress = [&solver](const BabaSolver::SolverProgress&) { solver.Cancel(); };
+	solver.SetCallbacks(callbacks);
+	solver.Start();
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Wait();
+	ASSERT_TRUE(end_state);
+	EXPECT_FALSE(end_state->HaveWon());
+	EXPECT_TRUE(solver.IsFinished());
+	EXPECT_TRUE(solver.WasCancelled());
+	// The other iterations don't start once the search is cancelled.
+	EXPECT_EQ(solver.Stats().iteration_count, 1);
+}
+
+TEST(SolverTest, AnytimeModeFindsTheShortestWin)
+{
+	// Start a few moves away from the win, so that there are wins of several lengths.
+	std::shared_ptr<BabaSolver::GameState> initial_state = BabaSolver::TestLevel()->ApplyMoves(*BabaSolver::ParseMoves("DDRR"));
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 10;
+	options.thread_count = 2;
+	options.estimate_probe_count = 0;
+	std::shared_ptr<BabaSolver::GameState> first_win = BabaSolver::Solver(initial_state, options).Run();
+	ASSERT_TRUE(first_win->HaveWon());
+
+	options.anytime = true;
+	BabaSolver::Solver solver(initial_state, options);
+	std::vector<int> win_turns;
+	BabaSolver::SolverCallbacks callbacks;
+	callbacks.on_shorter_win = [&win_turns](const std::shared_ptr<BabaSolver::GameState>& state)
+		{
+			win_turns.push_back(state->_turn);
+		};
+	solver.SetCallbacks(callbacks);
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+	ASSERT_TRUE(end_state->HaveWon());
+	ASSERT_FALSE(win_turns.empty());
+	EXPECT_TRUE(std::is_sorted(win_turns.rbegin(), win_turns.rend()));
+	EXPECT_EQ(std::adjacent_find(win_turns.begin(), win_turns.end()), win_turns.end());
+	EXPECT_EQ(win_turns.back(), end_state->_turn);
+	EXPECT_LE(end_state->_turn, first_win->_turn);
+
+	// There is no win shorter than the one anytime mode returned.
+	options.anytime = false;
+	options.max_turn_depth = end_state->_turn - 1;
+	EXPECT_FALSE(BabaSolver::Solver(initial_state, options).Run()->HaveWon());
+}
+
+TEST(SolverTest, TimeLimitStopsTheSearch)
+{
+	// This search would take far too long to finish.
+	BabaSolver::SolverOptions options;
+	options.max_turn_depth = 25;
+	options.estimate_probe_count = 0;
+	options.time_limit = std::chrono::milliseconds(200);
+	BabaSolver::Solver solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	auto start_time = std::chrono::steady_clock::now();
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+	ASSERT_TRUE(end_state);
+	EXPECT_LT(std::chrono::steady_clock::now() - start_time, std::chrono::seconds(10));
+	EXPECT_FALSE(solver.WasCancelled());
+	EXPECT_EQ(solver.GetStopReason(), BabaSolver::StopReason::TIME_LIMIT);
+	EXPECT_EQ(solver.Stats().stop_reason, BabaSolver::StopReason::TIME_LIMIT);
+	EXPECT_EQ(solver.Stats().iteration_count, 1);
+}
+
+TEST(SolverTest, TimeLimitReducesTheDepth)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 2;
+	options.max_turn_depth = 25;
+	options.estimate_probe_count = 100;
+	options.time_limit = std::chrono::seconds(2);
+	BabaSolver::Solver solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	ASSERT_TRUE(solver.Run());
+	BabaSolver::SolverStats stats = solver.Stats();
+	EXPECT_GE(stats.reduced_depth_iterations, 1);
+	EXPECT_GT(stats.min_reduced_turn_depth, options.parallelism_depth);
+	EXPECT_LT(stats.min_reduced_turn_depth, options.max_turn_depth);
+}
+
+TEST(SolverTest, MemoryLimitStopsTheSearch)
+{
+	// The process always uses more than one byte, so the search stops right away.
+	BabaSolver::SolverOptions options;
+	options.max_turn_depth = 25;
+	options.estimate_probe_count = 0;
+	options.memory_limit_bytes = 1;
+	BabaSolver::Solver solver(BabaSolver::FloatiestPlatformsLevel(), options);
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+	ASSERT_TRUE(end_state);
+	EXPECT_FALSE(end_state->HaveWon());
+	EXPECT_EQ(solver.GetStopReason(), BabaSolver::StopReason::MEMORY_LIMIT);
+	EXPECT_TRUE(solver.Stats().memory.caches_frozen);
+}
+
+TEST(SolverTest, ReplayPrefixRejectsLosingMoves)
+{
+	// Walking left kills Baba #1.
+	std::string error;
+	EXPECT_FALSE(BabaSolver::ReplayPrefix(BabaSolver::TestLevel(), *BabaSolver::ParseMoves("LLLL"), error));
+	EXPECT_NE(error.find("LLLL"), std::string::npos);
+
+	// Moving right wins, and the game doesn't apply the moves after a win.
+	EXPECT_TRUE(BabaSolver::ReplayPrefix(BabaSolver::TestLevel(), *BabaSolver::ParseMoves("R"), error));
+	EXPECT_FALSE(BabaSolver::ReplayPrefix(BabaSolver::TestLevel(), *BabaSolver::ParseMoves("RL"), error));
+	EXPECT_NE(error.find("after the win at move 1"), std::string::npos);
+}
+
+TEST(SolverTest, SolveFromContinuesAPrefix)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::TestLevel();
+	std::vector<BabaSolver::Direction> prefix = *BabaSolver::ParseMoves("DDRR");
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 9;
+	options.estimate_probe_count = 0;
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::SolveFrom(level, prefix, options, error);
+	ASSERT_TRUE(end_state) << error;
+	ASSERT_TRUE(end_state->HaveWon());
+
+	// The moves of the result are relative to the end of the prefix.
+	std::vector<BabaSolver::Direction> solution = prefix;
+	solution.insert(solution.end(), end_state->_moves, end_state->_moves + end_state->_turn);
+	EXPECT_TRUE(BabaSolver::ReplayMoves(level, solution)->HaveWon());
+
+	// A prefix that already wins is returned without searching.
+	BabaSolver::SolverStats stats;
+	std::shared_ptr<BabaSolver::GameState> won_state = BabaSolver::SolveFrom(level, solution, options, error, &stats);
+	ASSERT_TRUE(won_state) << error;
+	EXPECT_TRUE(won_state->HaveWon());
+	EXPECT_EQ(stats.iteration_count, 0);
+
+	// The error of a rejected prefix goes to the caller instead of stdout.
+	testing::internal::CaptureStdout();
+	EXPECT_FALSE(BabaSolver::SolveFrom(level, *BabaSolver::ParseMoves("LLLL"), options, error));
+	EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+	EXPECT_NE(error.find("LLLL"), std::string::npos);
+}
+
+TEST(SolverTest, ReachStateGoalFindsTheTargetState)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::string error;
+	std::shared_ptr<BabaSolver::GameState> target = BabaSolver::ReplayPrefix(level, *BabaSolver::ParseMoves("RRUU"), error);
+	ASSERT_TRUE(target) << error;
+	BabaSolver::ReachStateGoal goal(*target);
+	ASSERT_FALSE(goal.IsReached(*level));
+
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 6;
+	options.estimate_probe_count = 0;
+	BabaSolver::Solver solver(level, options, goal);
+	std::shared_ptr<BabaSolver::GameState> end_state = solver.Run();
+	ASSERT_TRUE(end_state);
+	EXPECT_TRUE(goal.IsReached(*end_state));
+	EXPECT_LE(end_state->_turn, options.max_turn_depth);
+	EXPECT_TRUE(goal.IsReached(*BabaSolver::ReplayMoves(level, std::vector<BabaSolver::Direction>(end_state->_moves, end_state->_moves + end_state->_turn))));
+}
+
+TEST(SolverTest, CustomHeuristicPicksTheBestLeaf)
+{
+	// A goal that is never reached, so the result is the leaf with the best score: the one where
+	// Baba #1 is the furthest to the right.
+	BabaSolver::PredicateGoal never{ [](const BabaSolver::GameState&) { return false; } };
+	BabaSolver::FunctionHeuristic rightmost{ [](const BabaSolver::GameState& state) { return static_cast<int>(state._baba1.j); } };
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.max_turn_depth = 4;
+	options.max_cache_depth = 4;
+	options.estimate_probe_count = 0;
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	std::shared_ptr<BabaSolver::GameState> end_state = BabaSolver::SolveFor(level, options, never, rightmost);
+	ASSERT_TRUE(end_state);
+	EXPECT_EQ(end_state->_turn, options.max_turn_depth);
+
+	// Check every sequence of moves that the search doesn't prune.
+	const BabaSolver::Direction directions[] = { BabaSolver::Direction::UP, BabaSolver::Direction::RIGHT, BabaSolver::Direction::DOWN,
+		BabaSolver::Direction::LEFT };
+	int best_score = -1;
+	std::vector<std::shared_ptr<BabaSolver::GameState>> states = { level };
+	for (int depth = 0; depth < options.max_turn_depth; ++depth)
+	{
+		std::vector<std::shared_ptr<BabaSolver::GameState>> next_states;
+		for (const std::shared_ptr<BabaSolver::GameState>& state : states)
+		{
+			for (BabaSolver::Direction direction : directions)
+			{
+				std::shared_ptr<BabaSolver::GameState> next_state = state->ApplyMove(direction);
+				if (next_state->CheckIfPossibleToWin())
+					next_states.push_back(next_state);
+			}
+		}
+		states = std::move(next_states);
+	}
+	for (const std::shared_ptr<BabaSolver::GameState>& state : states)
+		best_score = std::max(best_score, rightmost.Score(*state));
+	EXPECT_EQ(rightmost.Score(*end_state), best_score);
+}
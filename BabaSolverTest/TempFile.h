@@ -0,0 +1,35 @@
+// A file in the temp directory for tests that write files, e.g. caches and tables.
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace BabaSolverTest
+{
+	// A file in the temp directory that is deleted at the start and at the end of the test.
+	class TempFile
+	{
+	public:
+		explicit TempFile(const std::string& name) : _path(testing::TempDir() + name)
+		{
+			std::remove(_path.c_str());
+		}
+
+		~TempFile()
+		{
+			std::remove(_path.c_str());
+		}
+
+		TempFile(const TempFile&) = delete;
+		TempFile& operator=(const TempFile&) = delete;
+
+		const std::string& Path() const { return _path; }
+
+	private:
+		std::string _path;
+	};
+
+}  // namespace BabaSolverTest
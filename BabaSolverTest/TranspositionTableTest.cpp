@@ -0,0 +1,88 @@
+// Tests for the memory-mapped transposition table.
+
+#include "pch.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "GameState.h"
+#include "Solver.h"
+#include "TranspositionTable.h"
+
+#include "TempFile.h"
+
+TEST(TranspositionTableTest, RecordsDepthsThatSurviveReopening)
+{
+	BabaSolverTest::TempFile file("transposition_record.bin");
+	std::shared_ptr<BabaSolver::GameState> state = BabaSolver::FloatiestPlatformsLevel();
+	std::shared_ptr<BabaSolver::GameState> other_state = state->ApplyMove(BabaSolver::Direction::RIGHT);
+	std::string error;
+	{
+		std::unique_ptr<BabaSolver::TranspositionTable> table = BabaSolver::TranspositionTable::Open(file.Path(), 1024 * 1024, error);
+		ASSERT_TRUE(table) << error;
+		EXPECT_EQ(table->Capacity(), 4u * 8192);
+		EXPECT_FALSE(table->CannotWinWithin(*state, 1));
+
+		table->RecordCannotWinWithin(*state, 5);
+		EXPECT_TRUE(table->CannotWinWithin(*state, 5));
+		EXPECT_TRUE(table->CannotWinWithin(*state, 3));
+		EXPECT_FALSE(table->CannotWinWithin(*state, 6));
+		EXPECT_FALSE(table->CannotWinWithin(*other_state, 1));
+
+		// A shallower record doesn't replace a deeper one.
+		table->RecordCannotWinWithin(*state, 2);
+		EXPECT_TRUE(table->CannotWinWithin(*state, 5));
+		table->RecordCannotWinWithin(*state, 7);
+		EXPECT_TRUE(table->CannotWinWithin(*state, 7));
+		EXPECT_EQ(table->CountEntries(), 1u);
+	}
+
+	// The turn count isn't part of the key, and the entries are kept in the file. The file keeps
+	// its size even if a different size is asked for.
+	std::unique_ptr<BabaSolver::TranspositionTable> table = BabaSolver::TranspositionTable::Open(file.Path(), 64 * 1024 * 1024, error);
+	ASSERT_TRUE(table) << error;
+	EXPECT_EQ(table->Capacity(), 4u * 8192);
+	std::shared_ptr<BabaSolver::GameState> later_state = std::make_shared<BabaSolver::GameState>(*state);
+	later_state->_turn = 10;
+	EXPECT_TRUE(table->CannotWinWithin(*later_state, 7));
+}
+
+TEST(TranspositionTableTest, RejectsOtherFiles)
+{
+	BabaSolverTest::TempFile file("transposition_other.bin");
+	{
+		std::ofstream out(file.Path());
+		out << "not a transposition table, but long enough to have a header......................";
+	}
+	std::string error;
+	EXPECT_FALSE(BabaSolver::TranspositionTable::Open(file.Path(), 1024 * 1024, error));
+	EXPECT_NE(error.find("not a transposition table"), std::string::npos);
+}
+
+TEST(TranspositionTableTest, SolverFindsTheSameWinsWithTheTable)
+{
+	BabaSolverTest::TempFile file("transposition_solver.bin");
+	// Start a few moves away from the win, so that the shallow searches don't win and record
+	// game states that the deeper searches then skip.
+	std::shared_ptr<BabaSolver::GameState> initial_state = BabaSolver::TestLevel()->ApplyMoves(*BabaSolver::ParseMoves("DDRR"));
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 1;
+	options.parallelism_depth = 2;
+	options.max_cache_depth = 20;
+	options.thread_count = 2;
+	options.estimate_probe_count = 0;
+	options.transposition_table_bytes = 1024 * 1024;
+	uint64_t pruned = 0;
+	for (int depth = 3; depth <= 9; ++depth)
+	{
+		options.max_turn_depth = depth;
+		options.transposition_file.clear();
+		bool won_without_table = BabaSolver::Solver(initial_state, options).Run()->HaveWon();
+		options.transposition_file = file.Path();
+		BabaSolver::Solver solver(initial_state, options);
+		EXPECT_EQ(solver.Run()->HaveWon(), won_without_table) << "max_turn_depth = " << depth;
+		pruned += solver.Stats().Totals().pruned_transposition;
+	}
+	EXPECT_GT(pruned, 0u);
+}
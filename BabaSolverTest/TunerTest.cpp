@@ -0,0 +1,78 @@
+// Tests for TuneOptions().
+
+#include "pch.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "GameState.h"
+#include "Solver.h"
+#include "Tuner.h"
+
+TEST(TunerTest, StopsWhenACalibrationSearchWins)
+{
+	BabaSolver::SolverOptions options;
+	options.thread_count = 1;
+	BabaSolver::TuningResult result = BabaSolver::TuneOptions(BabaSolver::TestLevel(), options, std::chrono::seconds(10), 0);
+	EXPECT_TRUE(result.won);
+	ASSERT_EQ(result.calibrations.size(), 1u);
+	EXPECT_EQ(result.options.max_turn_depth, result.calibrations[0].max_turn_depth);
+	EXPECT_TRUE(BabaSolver::Solve(BabaSolver::TestLevel(), result.options)->HaveWon());
+}
+
+TEST(TunerTest, FitsBudget)
+{
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 2;
+	options.thread_count = 1;
+	constexpr uint64_t memory_budget_bytes = 16 * 1024 * 1024;
+	std::chrono::seconds time_budget(2);
+	BabaSolver::TuningResult result = BabaSolver::TuneOptions(BabaSolver::FloatiestPlatformsLevel(), options, time_budget, memory_budget_bytes);
+	EXPECT_FALSE(result.won);
+	// The cached calibration searches, then the last one again without caching its last depths.
+	ASSERT_GE(result.calibrations.size(), 2u);
+	EXPECT_LT(result.calibrations.back().max_cache_depth, result.calibrations.back().max_turn_depth);
+	for (const BabaSolver::CalibrationResult& calibration : result.calibrations)
+	{
+		EXPECT_LE(calibration.max_local_cache_bytes, memory_budget_bytes);
+	}
+
+	EXPECT_LT(result.options.parallelism_depth, result.options.max_turn_depth);
+	EXPECT_LE(result.options.max_cache_depth, result.options.max_turn_depth);
+	EXPECT_EQ(result.options.iteration_count, options.iteration_count);
+	EXPECT_EQ(result.options.max_cache_bytes, memory_budget_bytes);
+	EXPECT_LE(result.estimated_duration, time_budget / options.iteration_count);
+	EXPECT_LE(result.estimated_memory_bytes, memory_budget_bytes);
+}
+
+TEST(TunerTest, PicksTheDeepestSearchThatFits)
+{
+	std::shared_ptr<BabaSolver::GameState> level = BabaSolver::FloatiestPlatformsLevel();
+	BabaSolver::SolverOptions options;
+	options.iteration_count = 2;
+	options.thread_count = 1;
+	// Made-up measurements, so that the picked options don't depend on the speed of this computer.
+	BabaSolver::CalibrationMeasurements measurements;
+	measurements.cached_nanoseconds_per_node = 400.0;
+	measurements.uncached_nanoseconds_per_node = 100.0;
+	measurements.cache_bytes_per_node_per_root = 100.0;
+	std::chrono::seconds time_budget(2);
+	BabaSolver::TuningResult result = BabaSolver::PickTunedOptions(level, options, measurements, time_budget, 0);
+	// Deeper than the first calibration search, which takes a small part of the budget.
+	EXPECT_GT(result.options.max_turn_depth, 8);
+	EXPECT_LE(result.estimated_duration, time_budget / options.iteration_count);
+	EXPECT_LT(result.options.parallelism_depth, result.options.max_turn_depth);
+	EXPECT_LE(result.options.max_cache_depth, result.options.max_turn_depth);
+
+	// Moves 16 times as fast allow a deeper search, and a memory budget doesn't allow a deeper one.
+	BabaSolver::CalibrationMeasurements faster = measurements;
+	faster.cached_nanoseconds_per_node /= 16;
+	faster.uncached_nanoseconds_per_node /= 16;
+	BabaSolver::TuningResult faster_result = BabaSolver::PickTunedOptions(level, options, faster, time_budget, 0);
+	EXPECT_GE(faster_result.options.max_turn_depth, result.options.max_turn_depth + 1);
+	constexpr uint64_t memory_budget_bytes = 1024 * 1024;
+	BabaSolver::TuningResult small_memory_result = BabaSolver::PickTunedOptions(level, options, measurements, time_budget, memory_budget_bytes);
+	EXPECT_LE(small_memory_result.options.max_turn_depth, result.options.max_turn_depth);
+	EXPECT_LE(small_memory_result.estimated_memory_bytes, memory_budget_bytes);
+}
@@ -0,0 +1,46 @@
+# Builds a profile-guided-optimized BabaSolver. Run by the "pgo" target of CMakeLists.txt with:
+#   cmake -DSOURCE_DIR=... -DBINARY_DIR=... -DCXX_COMPILER=... -DCXX_COMPILER_ID=... -DLTO=...
+#         -DMARCH=... -DTRAINING_ARGS=... -P Pgo.cmake
+#
+# 1. Builds an instrumented solver in ${BINARY_DIR}/generate.
+# 2. Runs it with TRAINING_ARGS, which writes the profile to ${BINARY_DIR}/profiles.
+# 3. Builds the optimized solver with the profile in ${BINARY_DIR}/use, and copies it to
+#    ${BINARY_DIR}/BabaSolver.
+
+set(profile_dir "${BINARY_DIR}/profiles")
+file(REMOVE_RECURSE "${profile_dir}")
+
+function(run_step description)
+	message(STATUS "PGO: ${description}")
+	execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "PGO: failed to ${description} (${result})")
+	endif()
+endfunction()
+
+function(build_solver pgo_mode build_dir)
+	run_step("configure the ${pgo_mode} build"
+		"${CMAKE_COMMAND}" -S "${SOURCE_DIR}" -B "${build_dir}"
+		-DCMAKE_BUILD_TYPE=Release
+		"-DCMAKE_CXX_COMPILER=${CXX_COMPILER}"
+		"-DBABA_SOLVER_LTO=${LTO}"
+		"-DBABA_SOLVER_MARCH=${MARCH}"
+		"-DBABA_SOLVER_PGO=${pgo_mode}"
+		"-DBABA_SOLVER_PGO_DIR=${profile_dir}"
+		-DBABA_SOLVER_BUILD_TESTS=OFF
+		-DBABA_SOLVER_BUILD_BENCHMARK=OFF)
+	run_step("build the ${pgo_mode} build" "${CMAKE_COMMAND}" --build "${build_dir}" --target BabaSolver --parallel)
+endfunction()
+
+build_solver(GENERATE "${BINARY_DIR}/generate")
+run_step("train the instrumented solver" "${BINARY_DIR}/generate/BabaSolver" ${TRAINING_ARGS})
+if(CXX_COMPILER_ID MATCHES "Clang")
+	# Clang writes raw profiles that have to be merged before they can be used.
+	get_filename_component(compiler_dir "${CXX_COMPILER}" DIRECTORY)
+	find_program(LLVM_PROFDATA NAMES llvm-profdata HINTS "${compiler_dir}" REQUIRED)
+	file(GLOB raw_profiles "${profile_dir}/*.profraw")
+	run_step("merge the profiles" "${LLVM_PROFDATA}" merge "-output=${profile_dir}/default.profdata" ${raw_profiles})
+endif()
+build_solver(USE "${BINARY_DIR}/use")
+file(COPY "${BINARY_DIR}/use/BabaSolver" DESTINATION "${BINARY_DIR}")
+message(STATUS "PGO: wrote ${BINARY_DIR}/BabaSolver")